@@ -9,6 +9,7 @@ import { AppComponent } from "./app.component";
 
 import { ImageProcessingService } from "./model/math/image-processing.service";
 import { ProgressService } from "./model/math/progress.service";
+import { ResultCacheService } from "./model/math/result-cache.service";
 
 import { MathJaxDirective } from "./model/other/math-jax.directive";
 import { AboutComponent } from "./view/about/about.component";
@@ -52,7 +53,7 @@ const appRoutes: Routes = [
         ),
         NgbModule,
     ],
-    providers: [ImageProcessingService, ProgressService],
+    providers: [ImageProcessingService, ProgressService, ResultCacheService],
     bootstrap: [AppComponent],
 })
 export class AppModule {
@@ -1,12 +1,55 @@
 import {Injectable} from "@angular/core";
 
+import {QuantizedPixels} from "../other/quantized-pixels";
+import {Region} from "../other/region";
+import {ResultCacheService} from "./result-cache.service";
+
 @Injectable()
 export class ImageProcessingService {
 
+    /**
+     * The Gabor convolution in progress. Its control block holds [steps done, steps total, cancel flag], where the steps
+     * are the transform of the input and the orientations, and is backed by shared memory if the page is cross-origin
+     * isolated, otherwise it is null. If the wasm memory of the worker is shared as well, the worker replaces it by the
+     * block the C code updates while it is running.
+     */
+    private gaborConvolution2Job: {worker: Worker, control: Int32Array, progressive: boolean, kept: boolean} = null;
+
+    /**
+     * Counts the Gabor convolutions, so that a result cache lookup of a cancelled convolution is ignored
+     */
+    private gaborConvolution2Id: number = 0;
+
+    /**
+     * Worker that keeps the image of the Gabor convolutions with an image id between them, along with its spectrum,
+     * so that a change of the params neither posts nor transforms the image again. It is replaced if it fails.
+     * @type {Worker}
+     */
+    private imageWorker: Worker = null;
+
+    /**
+     * The control block the C code of the image worker updates, if its wasm memory is shared, otherwise null
+     * @type {Int32Array}
+     */
+    private imageWorkerControl: Int32Array = null;
+
+    /**
+     * The image of the image worker with its id, the hash of its pixels for the result cache and whether the worker
+     * has received it
+     */
+    private keptImage: {id: number, f: Float32Array, hash: string, posted: boolean} = null;
+
+    /**
+     * The local storage key of the strategies the C code measured for the shapes of earlier Gabor convolutions
+     * @type {string}
+     */
+    private wisdomKey: string = "gabor-wisdom";
+
     /**
      * Constructor.
+     * @param {ResultCacheService} resultCacheService
      */
-    constructor() {}
+    constructor(private resultCacheService: ResultCacheService) {}
 
     /**
      * Gets the normalized Gabor filter.
@@ -48,15 +91,28 @@ export class ImageProcessingService {
     }
 
     /**
-     * Does a Gabor convolution, that is an input image is convoluted by a Gabor filter with given params.
+     * Does a Gabor convolution, that is an input image is convoluted by a Gabor filter with given params. A Gabor
+     * convolution that is still in progress is cancelled. Results are cached, so that repeated convolutions of the same
+     * image with the same params do not need a worker.
      * @param {Float32Array} f input image data in grayscale
      * @param {number} xi parameter of Gabor filter
      * @param {number} sigma parameter of Gabor filter
      * @param {number} lambda parameter of Gabor filter
      * @param {number} theta parameter of Gabor filter
      * @param {number} amount parameter of Gabor filter
-     * @param {(fConv: Float32Array, event: MessageEvent) => void} successCallback fired on success
+     * @param {(fConv: Float32Array | QuantizedPixels, event: MessageEvent) => void} successCallback fired on success
      * @param {(event: ErrorEvent) => void} errorCallback fired on error
+     * @param {(fPartial: Float32Array | QuantizedPixels, progress: number, event: MessageEvent) => void} progressCallback
+     * if given, the convolution runs in progressive mode and this is fired with a low resolution preview first and then
+     * with the running sum over the orientations calculated so far, progress being the fraction of orientations done
+     * @param {number} bits if 8 or 16, the results are normalized and quantized to levels of that many bits in the
+     * worker, which is a fraction of the data of float values
+     * @param {number} tolerance if given, the orientations are approximated by a steerable basis of as few filters as
+     * keep the relative error below it, which is much faster for many orientations, and no partial results are posted
+     * @param {number} imageId if given, the image is kept under this id by a persistent worker, which keeps its
+     * spectrum as well, so that following convolutions of the same id with other params only calculate the filters and
+     * the inverse transforms. f may then be null if the image is kept already, see hasImage. The convolution is then
+     * cancelled between two orientations instead of terminating the worker.
      */
     async gaborConvolution2(f: Float32Array,
                            xi: number,
@@ -64,8 +120,233 @@ export class ImageProcessingService {
                            lambda: number,
                            theta: number,
                            amount: number,
-                           successCallback: (fConv: Float32Array, event: MessageEvent) => void,
-                           errorCallback: (event: ErrorEvent) => void) {
+                           successCallback: (fConv: Float32Array | QuantizedPixels, event: MessageEvent) => void,
+                           errorCallback: (event: ErrorEvent) => void,
+                           progressCallback?: (fPartial: Float32Array | QuantizedPixels, progress: number, event: MessageEvent) => void,
+                           bits?: number,
+                           tolerance?: number,
+                           imageId?: number) {
+
+        // Cancel the previous convolution
+        this.cancelGaborConvolution2();
+        const id: number = this.gaborConvolution2Id;
+
+        // Keep a new image, whose pixels are hashed once
+        if (imageId !== undefined && !this.hasImage(imageId)) {
+            if (f === null) {
+                errorCallback(new ErrorEvent("error", {message: "Image " + imageId + " is not kept."}));
+                return;
+            }
+            this.keptImage = {id: imageId, f: f, hash: ResultCacheService.hashPixels(f), posted: false};
+        }
+        const image = imageId !== undefined ? this.keptImage : null;
+
+        // Look up the result cache
+        const key: string = image !== null ?
+            ResultCacheService.gaborConvolution2HashKey(image.hash, Math.sqrt(image.f.length), xi, sigma, lambda, theta, amount, bits, tolerance) :
+            ResultCacheService.gaborConvolution2Key(f, xi, sigma, lambda, theta, amount, bits, tolerance);
+        const cached: Float32Array | QuantizedPixels = await this.resultCacheService.get(key);
+        if (id !== this.gaborConvolution2Id) return;
+        if (cached !== undefined) {
+            successCallback(cached, null);
+            return;
+        }
+
+        // Create a new worker, unless the image is kept
+        const backgroundWorker: Worker = image !== null ? this.getImageWorker() : new Worker("assets/js/gaborConvolution2.js");
+        const control: Int32Array = image !== null && this.imageWorkerControl !== null ? this.imageWorkerControl :
+            typeof SharedArrayBuffer !== "undefined" && (<any> self).crossOriginIsolated ?
+            new Int32Array(new SharedArrayBuffer(3 * Int32Array.BYTES_PER_ELEMENT)) : null;
+        this.gaborConvolution2Job = {
+            worker: backgroundWorker,
+            control: control,
+            progressive: progressCallback !== undefined,
+            kept: image !== null
+        };
+
+        // The message of the convolution, with the image only if the worker does not have it yet
+        const message: any = {
+            f: image === null ? f : image.posted ? undefined : image.f,
+            imageId: image !== null ? image.id : undefined,
+            job: id,
+            xi: xi,
+            sigma: sigma,
+            lambda: lambda,
+            theta: theta,
+            amount: amount,
+            progressive: this.gaborConvolution2Job.progressive,
+            bits: bits,
+            tolerance: tolerance,
+            control: control,
+            wisdom: this.loadWisdom()
+        };
+
+        // The success and progress callback, the image worker also posts the messages of earlier and cancelled
+        // convolutions
+        backgroundWorker.onmessage = (event: MessageEvent) => {
+            if (event.data.control) {
+                if (backgroundWorker === this.imageWorker) this.imageWorkerControl = event.data.control;
+                const job = this.gaborConvolution2Job;
+                if (job !== null && job.worker === backgroundWorker) job.control = event.data.control;
+                return;
+            }
+            if (image !== null && (event.data.job !== id || id !== this.gaborConvolution2Id)) return;
+            if (event.data.missing) {
+                backgroundWorker.postMessage({...message, f: image.f});
+                return;
+            }
+            if (event.data.preview || event.data.partial) {
+                if (progressCallback) progressCallback(event.data.preview || event.data.partial, event.data.progress, event);
+                return;
+            }
+            this.terminateGaborConvolution2(backgroundWorker);
+            if (event.data.error) {
+                errorCallback(new ErrorEvent("error", {message: event.data.error}));
+                return;
+            }
+            if (event.data.wisdom) this.saveWisdom(event.data.wisdom);
+            if (event.data.fConv) {
+                this.resultCacheService.put(key, event.data.fConv);
+                successCallback(event.data.fConv, event);
+            }
+        };
+
+        // The error callback, after which the image is posted to a new image worker
+        backgroundWorker.onerror = (event: ErrorEvent) => {
+            if (backgroundWorker === this.imageWorker) this.releaseImageWorker();
+            this.terminateGaborConvolution2(backgroundWorker);
+            errorCallback(event);
+        };
+
+        // Post the data
+        backgroundWorker.postMessage(message);
+        if (image !== null) image.posted = true;
+
+    }
+
+    /**
+     * Checks if the image of an id is kept, so that a Gabor convolution of it needs no pixels.
+     * @param {number} imageId
+     * @returns {boolean}
+     */
+    hasImage(imageId: number): boolean {
+        return this.keptImage !== null && this.keptImage.id === imageId;
+    }
+
+    /**
+     * Releases the kept image and terminates its worker.
+     */
+    releaseImage() {
+        this.cancelGaborConvolution2();
+        this.releaseImageWorker();
+        this.keptImage = null;
+    }
+
+    /**
+     * Does a Gabor convolution of a batch of images of the same size with the same params. The images are spread over
+     * one worker per processor core, each of which calculates the spectra of the filters once for all of its images.
+     * @param {Float32Array[]} images input images data in grayscale, all of the same size
+     * @param {number} xi parameter of Gabor filter
+     * @param {number} sigma parameter of Gabor filter
+     * @param {number} lambda parameter of Gabor filter
+     * @param {number} theta parameter of Gabor filter
+     * @param {number} amount parameter of Gabor filter
+     * @param {(fConvs: Float32Array) => void} successCallback fired when all images are done with the results one after
+     * the other
+     * @param {(event: ErrorEvent) => void} errorCallback fired on error, after which no other callback is fired
+     * @param {(index: number, fConv: Float32Array) => void} imageCallback if given, fired with the result of each image
+     * as soon as it is done
+     * @returns {Promise<void>}
+     */
+    async gaborConvolution2Batch(images: Float32Array[],
+                                 xi: number,
+                                 sigma: number,
+                                 lambda: number,
+                                 theta: number,
+                                 amount: number,
+                                 successCallback: (fConvs: Float32Array) => void,
+                                 errorCallback: (event: ErrorEvent) => void,
+                                 imageCallback?: (index: number, fConv: Float32Array) => void) {
+
+        if (images.length === 0) {
+            successCallback(new Float32Array(0));
+            return;
+        }
+
+        const size: number = images[0].length;
+        const fConvs: Float32Array = new Float32Array(images.length * size);
+        const workerCount: number = Math.min(navigator.hardwareConcurrency || 1, images.length);
+        const chunkSize: number = Math.ceil(images.length / workerCount);
+        const workers: Worker[] = [];
+        let done: number = 0;
+
+        for (let first = 0; first < images.length; first += chunkSize) {
+
+            // Create a new worker
+            const backgroundWorker: Worker = new Worker("assets/js/gaborConvolution2.js");
+            workers.push(backgroundWorker);
+
+            // The image and success callback
+            backgroundWorker.onmessage = (event: MessageEvent) => {
+                if (event.data.done) {
+                    backgroundWorker.terminate();
+                    return;
+                }
+                if (event.data.error) {
+                    workers.forEach((worker: Worker) => worker.terminate());
+                    errorCallback(new ErrorEvent("error", {message: event.data.error}));
+                    return;
+                }
+                fConvs.set(event.data.fConv, event.data.index * size);
+                if (imageCallback) imageCallback(event.data.index, event.data.fConv);
+                if (++done === images.length) successCallback(fConvs);
+            };
+
+            // The error callback
+            backgroundWorker.onerror = (event: ErrorEvent) => {
+                workers.forEach((worker: Worker) => worker.terminate());
+                errorCallback(event);
+            };
+
+            // Post the data
+            backgroundWorker.postMessage({
+                images: images.slice(first, first + chunkSize),
+                firstIndex: first,
+                xi: xi,
+                sigma: sigma,
+                lambda: lambda,
+                theta: theta,
+                amount: amount
+            });
+
+        }
+
+    }
+
+    /**
+     * Does a Gabor convolution like gaborConvolution2, but only in a region of the input image. Small regions are
+     * calculated directly with the filter truncated, so that the cost scales with the region instead of the image.
+     * @param {Float32Array} f input image data in grayscale
+     * @param {number} xi parameter of Gabor filter
+     * @param {number} sigma parameter of Gabor filter
+     * @param {number} lambda parameter of Gabor filter
+     * @param {number} theta parameter of Gabor filter
+     * @param {number} amount parameter of Gabor filter
+     * @param {Region} region the region of the input image to calculate
+     * @param {(fConv: Float32Array, event: MessageEvent) => void} successCallback fired on success with the values of
+     * the region, row by row
+     * @param {(event: ErrorEvent) => void} errorCallback fired on error
+     * @returns {Promise<void>}
+     */
+    async gaborConvolution2Region(f: Float32Array,
+                                  xi: number,
+                                  sigma: number,
+                                  lambda: number,
+                                  theta: number,
+                                  amount: number,
+                                  region: Region,
+                                  successCallback: (fConv: Float32Array, event: MessageEvent) => void,
+                                  errorCallback: (event: ErrorEvent) => void) {
 
         // Create a new worker
         const backgroundWorker: Worker = new Worker("assets/js/gaborConvolution2.js");
@@ -83,8 +364,112 @@ export class ImageProcessingService {
         };
 
         // Post the data
-        backgroundWorker.postMessage({f: f, xi: xi, sigma: sigma, lambda: lambda, theta: theta, amount: amount});
+        backgroundWorker.postMessage({f: f, xi: xi, sigma: sigma, lambda: lambda, theta: theta, amount: amount, region: region});
+
+    }
 
+    /**
+     * Gets the progress of the Gabor convolution in progress from the shared control block, that is the fraction of
+     * steps done. Returns null if there is no such convolution or if the memory cannot be shared.
+     * @returns {number}
+     */
+    gaborConvolution2Progress(): number {
+        const control: Int32Array = this.gaborConvolution2Job !== null ? this.gaborConvolution2Job.control : null;
+        if (control === null || Atomics.load(control, 1) === 0) return null;
+        return Atomics.load(control, 0) / Atomics.load(control, 1);
+    }
+
+    /**
+     * Cancels the Gabor convolution in progress, if any. In progressive mode the worker stops after the current
+     * orientation, otherwise it is terminated right away.
+     */
+    cancelGaborConvolution2() {
+
+        this.gaborConvolution2Id++;
+
+        const job = this.gaborConvolution2Job;
+        if (job === null) return;
+        this.gaborConvolution2Job = null;
+
+        // The image worker stops at its next safe point or when it receives the next convolution
+        if (job.kept) {
+            if (job.control !== null) Atomics.store(job.control, 2, 1);
+            job.worker.postMessage({cancel: true});
+            return;
+        }
+
+        if (!job.progressive) {
+            job.worker.terminate();
+            return;
+        }
+
+        if (job.control !== null) {
+            Atomics.store(job.control, 2, 1);
+        }
+        job.worker.postMessage({cancel: true});
+        job.worker.onmessage = (event: MessageEvent) => {
+            if (event.data.cancelled || event.data.fConv || event.data.error) job.worker.terminate();
+        };
+        job.worker.onerror = () => job.worker.terminate();
+
+    }
+
+    /**
+     * Gets the image worker, which is created on first use.
+     * @returns {Worker}
+     */
+    private getImageWorker(): Worker {
+        if (this.imageWorker === null) {
+            this.imageWorker = new Worker("assets/js/gaborConvolution2.js");
+            if (this.keptImage !== null) this.keptImage.posted = false;
+        }
+        return this.imageWorker;
+    }
+
+    /**
+     * Terminates the image worker, if any. The kept image is posted again to the next one.
+     */
+    private releaseImageWorker() {
+        if (this.imageWorker === null) return;
+        this.imageWorker.terminate();
+        this.imageWorker = null;
+        this.imageWorkerControl = null;
+        if (this.keptImage !== null) this.keptImage.posted = false;
+    }
+
+    /**
+     * Terminates the worker of a Gabor convolution, unless it is the image worker.
+     * @param {Worker} backgroundWorker
+     */
+    private terminateGaborConvolution2(backgroundWorker: Worker) {
+        if (backgroundWorker !== this.imageWorker) backgroundWorker.terminate();
+        if (this.gaborConvolution2Job !== null && this.gaborConvolution2Job.worker === backgroundWorker) {
+            this.gaborConvolution2Job = null;
+        }
+    }
+
+    /**
+     * Loads the strategies measured for earlier Gabor convolutions, so that a new worker does not measure them again.
+     * @returns {string}
+     */
+    private loadWisdom(): string {
+        try {
+            return localStorage.getItem(this.wisdomKey);
+        } catch (e) {
+            return null;
+        }
+    }
+
+    /**
+     * Saves the strategies measured by a worker.
+     * @param {string} wisdom
+     */
+    private saveWisdom(wisdom: string) {
+        try {
+            localStorage.setItem(this.wisdomKey, wisdom);
+        } catch (e) {
+            console.error(e);
+        }
     }
 
 }
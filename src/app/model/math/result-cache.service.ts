@@ -0,0 +1,231 @@
+import {Injectable} from "@angular/core";
+
+import {QuantizedPixels} from "../other/quantized-pixels";
+
+@Injectable()
+export class ResultCacheService {
+
+    /**
+     * The maximum total size of all cached results in bytes
+     * @type {number}
+     */
+    limit: number = 256 * 1024 * 1024;
+
+    /**
+     * The database, opened on first use
+     * @type {Promise<IDBDatabase>}
+     */
+    private database: Promise<IDBDatabase> = null;
+
+    /**
+     * Calculates a fast 64-bit hash of pixel values as 16 hexadecimal digits. Two 32-bit multiplicative lanes run over
+     * the bits of the values, which is the same hash as _hashPixels in the C code.
+     * @param {Float32Array} pixels
+     * @returns {string}
+     */
+    static hashPixels(pixels: Float32Array): string {
+
+        const words: Uint32Array = new Uint32Array(pixels.buffer, pixels.byteOffset, pixels.length);
+        let h1: number = 0x811c9dc5;
+        let h2: number = 0x9747b28c ^ pixels.length;
+
+        for (let i = 0, len = words.length; i < len; i++) {
+            const w: number = words[i];
+            h1 = Math.imul(h1 ^ w, 0x01000193);
+            h2 = Math.imul(h2 ^ w, 0x5bd1e995);
+            h2 ^= h2 >>> 15;
+        }
+
+        return (h1 >>> 0).toString(16).padStart(8, "0") + (h2 >>> 0).toString(16).padStart(8, "0");
+
+    }
+
+    /**
+     * Gets the cache key of a Gabor convolution from the hash of the input image and the params.
+     * @param {Float32Array} f input image data in grayscale
+     * @param {number} xi parameter of Gabor filter
+     * @param {number} sigma parameter of Gabor filter
+     * @param {number} lambda parameter of Gabor filter
+     * @param {number} theta parameter of Gabor filter
+     * @param {number} amount parameter of Gabor filter
+     * @param {number} bits quantization of the result
+     * @param {number} tolerance error of the steerable basis, if any
+     * @returns {string}
+     */
+    static gaborConvolution2Key(f: Float32Array,
+                                xi: number,
+                                sigma: number,
+                                lambda: number,
+                                theta: number,
+                                amount: number,
+                                bits: number,
+                                tolerance?: number): string {
+        return ResultCacheService.gaborConvolution2HashKey(ResultCacheService.hashPixels(f), Math.sqrt(f.length), xi, sigma,
+            lambda, theta, amount, bits, tolerance);
+    }
+
+    /**
+     * Gets the cache key of a Gabor convolution like gaborConvolution2Key, but from the hash of the input image of size
+     * n*n, so that an image that is kept need not be hashed again.
+     * @param {string} hash hash of the input image, see hashPixels
+     * @param {number} n size of the input image
+     * @param {number} xi parameter of Gabor filter
+     * @param {number} sigma parameter of Gabor filter
+     * @param {number} lambda parameter of Gabor filter
+     * @param {number} theta parameter of Gabor filter
+     * @param {number} amount parameter of Gabor filter
+     * @param {number} bits quantization of the result
+     * @param {number} tolerance error of the steerable basis, if any
+     * @returns {string}
+     */
+    static gaborConvolution2HashKey(hash: string,
+                                    n: number,
+                                    xi: number,
+                                    sigma: number,
+                                    lambda: number,
+                                    theta: number,
+                                    amount: number,
+                                    bits: number,
+                                    tolerance?: number): string {
+        const key: any[] = ["fgc2", hash, n, xi, sigma, lambda, theta, amount, bits || 0];
+        if (tolerance > 0) key.push("steerable", tolerance);
+        return key.join("-");
+    }
+
+    /**
+     * Constructor.
+     */
+    constructor() {}
+
+    /**
+     * Gets a cached result and marks it as recently used. Resolves to undefined on a miss or if IndexedDB is not
+     * available.
+     * @param {string} key
+     * @returns {Promise<Float32Array | QuantizedPixels>}
+     */
+    async get(key: string): Promise<Float32Array | QuantizedPixels> {
+
+        try {
+            const database: IDBDatabase = await this.open();
+            const transaction: IDBTransaction = database.transaction(["results", "entries"], "readwrite");
+            const entry: any = await this.request(transaction.objectStore("results").get(key));
+            if (entry === undefined) return undefined;
+
+            transaction.objectStore("entries").put({key: key, bytes: this.bytes(entry.result), accessed: Date.now()});
+            return entry.result;
+        } catch (e) {
+            console.error(e);
+            return undefined;
+        }
+
+    }
+
+    /**
+     * Caches a result and evicts the least recently used results if the cache exceeds its limit.
+     * @param {string} key
+     * @param {Float32Array | QuantizedPixels} result
+     * @returns {Promise<void>}
+     */
+    async put(key: string, result: Float32Array | QuantizedPixels): Promise<void> {
+
+        const bytes: number = this.bytes(result);
+        if (bytes > this.limit) return;
+
+        try {
+            const database: IDBDatabase = await this.open();
+            const transaction: IDBTransaction = database.transaction(["results", "entries"], "readwrite");
+            transaction.objectStore("results").put({key: key, result: result});
+            transaction.objectStore("entries").put({key: key, bytes: bytes, accessed: Date.now()});
+            await this.complete(transaction);
+            await this.evict(database);
+        } catch (e) {
+            console.error(e);
+        }
+
+    }
+
+    /**
+     * Deletes the least recently used results until the cache is within its limit.
+     * @param {IDBDatabase} database
+     * @returns {Promise<void>}
+     */
+    private async evict(database: IDBDatabase): Promise<void> {
+
+        const transaction: IDBTransaction = database.transaction(["results", "entries"], "readwrite");
+        const entries: any[] = await this.request(transaction.objectStore("entries").getAll());
+
+        let total: number = entries.reduce((sum: number, entry: any) => sum + entry.bytes, 0);
+        entries.sort((a: any, b: any) => a.accessed - b.accessed);
+
+        for (let i = 0; i < entries.length && total > this.limit; i++) {
+            transaction.objectStore("results").delete(entries[i].key);
+            transaction.objectStore("entries").delete(entries[i].key);
+            total -= entries[i].bytes;
+        }
+
+        await this.complete(transaction);
+
+    }
+
+    /**
+     * Opens the database. The results and their metadata are kept in separate stores, so that the eviction does not
+     * need to read the results.
+     * @returns {Promise<IDBDatabase>}
+     */
+    private open(): Promise<IDBDatabase> {
+
+        if (this.database === null) {
+            this.database = new Promise<IDBDatabase>((resolve, reject) => {
+                if (typeof indexedDB === "undefined") {
+                    reject("IndexedDB is not available.");
+                    return;
+                }
+                const request: IDBOpenDBRequest = indexedDB.open("gabor-results", 1);
+                request.onupgradeneeded = () => {
+                    request.result.createObjectStore("results", {keyPath: "key"});
+                    request.result.createObjectStore("entries", {keyPath: "key"});
+                };
+                request.onsuccess = () => resolve(request.result);
+                request.onerror = () => reject(request.error);
+            });
+        }
+
+        return this.database;
+
+    }
+
+    /**
+     * Wraps an IndexedDB request into a promise.
+     * @param {IDBRequest} request
+     * @returns {Promise<any>}
+     */
+    private request(request: IDBRequest): Promise<any> {
+        return new Promise<any>((resolve, reject) => {
+            request.onsuccess = () => resolve(request.result);
+            request.onerror = () => reject(request.error);
+        });
+    }
+
+    /**
+     * Wraps the completion of an IndexedDB transaction into a promise.
+     * @param {IDBTransaction} transaction
+     * @returns {Promise<void>}
+     */
+    private complete(transaction: IDBTransaction): Promise<void> {
+        return new Promise<void>((resolve, reject) => {
+            transaction.oncomplete = () => resolve();
+            transaction.onerror = () => reject(transaction.error);
+            transaction.onabort = () => reject(transaction.error);
+        });
+    }
+
+    /**
+     * Gets the size of a result in bytes.
+     * @param {Float32Array | QuantizedPixels} result
+     * @returns {number}
+     */
+    private bytes(result: Float32Array | QuantizedPixels): number {
+        return result instanceof Float32Array ? result.byteLength : result.levels.byteLength;
+    }
+
+}
@@ -1,8 +1,11 @@
 import {ElementRef} from "@angular/core";
-import {Observable} from "rxjs";
+import {Observable, of, Subscriber} from "rxjs";
+import {map} from "rxjs/operators";
 
 import * as FileSaver from "file-saver";
 
+import {QuantizedPixels} from "./quantized-pixels";
+
 export class CanvasImage {
 
     /**
@@ -10,6 +13,46 @@ export class CanvasImage {
      */
     public context: CanvasRenderingContext2D;
 
+    /**
+     * Worker that converts and renders the pixels off the main thread
+     * @type {Worker}
+     */
+    private worker: Worker = null;
+
+    /**
+     * The pending requests to the worker by their id
+     * @type {Map<number, Subscriber<any>>}
+     */
+    private workerRequests: Map<number, Subscriber<any>> = new Map<number, Subscriber<any>>();
+
+    /**
+     * The id of the last request to the worker
+     * @type {number}
+     */
+    private workerRequestId: number = 0;
+
+    /**
+     * The last image id given out
+     * @type {number}
+     */
+    private static lastImageId: number = 0;
+
+    /**
+     * Identifies the content of the canvas, a new id is given out whenever the content is replaced
+     * @type {number}
+     * @private
+     */
+    private _imageId: number = ++CanvasImage.lastImageId;
+
+    /**
+     * Get the image id, which stays the same as long as the content of the canvas does, so that it can be used to
+     * keep the pixels of the image elsewhere
+     * @returns {number}
+     */
+    get imageId(): number {
+        return this._imageId;
+    }
+
     /**
      * Canvas size
      * @type {number}
@@ -32,6 +75,7 @@ export class CanvasImage {
     set size(size: number) {
         if (size > 0 && size <= 4096 && Math.log2(size) % 1 === 0) {
             this._size = size;
+            this.changeImageId();
         } else {
             console.error(JSON.stringify(size) + " is not a valid size for the canvas.");
         }
@@ -71,6 +115,7 @@ export class CanvasImage {
                         this.context.drawImage(image, 0, 0, this.size, this.size);
                     }
 
+                    this.changeImageId();
                     observer.next(true);
                     observer.complete();
 
@@ -85,9 +130,67 @@ export class CanvasImage {
     }
 
     /**
-     * Converts any image to gray scale.
+     * Converts any image to gray scale. The conversion is done in the worker if possible.
+     * @returns {Observable<boolean>}
+     */
+    toGrayScale(): Observable<boolean> {
+
+        if (!this.isWorkerSupported()) {
+            this.toGrayScaleOnMainThread();
+            return of(true);
+        }
+
+        return this.requestWorker({operation: "toGrayScale"}, true).pipe(
+            map((data: any) => this.drawBitmap(data.bitmap))
+        );
+
+    }
+
+    /**
+     * Gets the gray value of all pixels. The conversion is done in the worker if possible.
+     * @returns {Observable<Float32Array>}
+     */
+    getGrayScalePixels(): Observable<Float32Array> {
+
+        if (!this.isWorkerSupported()) {
+            return of(this.getGrayScalePixelsOnMainThread());
+        }
+
+        return this.requestWorker({operation: "getGrayScalePixels"}, true).pipe(
+            map((data: any) => <Float32Array> data.pixels)
+        );
+
+    }
+
+    /**
+     * Sets all pixels and draws grayscale depending on the pixel values. The pixels are rendered in the worker if
+     * possible, quantized pixels are rendered from their levels directly.
+     * @param {Float32Array | QuantizedPixels} pixels
+     * @param {boolean} adjustScale
+     * @returns {Observable<boolean>}
+     */
+    setGrayScalePixels(pixels: Float32Array | QuantizedPixels, adjustScale?: boolean): Observable<boolean> {
+
+        const length: number = pixels instanceof Float32Array ? pixels.length : pixels.levels.length;
+        if (length !== this.context.canvas.width * this.context.canvas.height) {
+            return of(false);
+        }
+        this.changeImageId();
+
+        if (!this.isWorkerSupported()) {
+            return of(this.setGrayScalePixelsOnMainThread(this.dequantize(pixels), adjustScale));
+        }
+
+        return this.requestWorker({operation: "setGrayScalePixels", pixels: pixels, adjustScale: adjustScale === true}).pipe(
+            map((data: any) => this.drawBitmap(data.bitmap))
+        );
+
+    }
+
+    /**
+     * Draws axes in the canvas.
      */
-    toGrayScale() {
+    drawAxes() {
 
         const width = this.context.canvas.width;
         const height = this.context.canvas.height;
@@ -95,64 +198,182 @@ export class CanvasImage {
 
         for (let y = 0; y < height; y++) {
             for (let x = 0; x < width; x++) {
+
+                if (width / 2 !== x && height / 2 !== y) continue;
+
                 const i: number = (y * 4) * width + x * 4;
-                const average: number = (imageData.data[i] + imageData.data[i + 1] + imageData.data[i + 2]) / 3;
-                imageData.data[i] = average;
-                imageData.data[i + 1] = average;
-                imageData.data[i + 2] = average;
+
+                imageData.data[i] = 0;
+                imageData.data[i + 1] = 0;
+                imageData.data[i + 2] = 0;
+
             }
         }
 
         if (width > 0 && height > 0) {
             this.context.putImageData(imageData, 0, 0, 0, 0, imageData.width, imageData.height);
+            this.changeImageId();
         }
 
     }
 
     /**
-     * Gets all pixels.
-     * @returns {Uint8ClampedArray}
+     * Sets all pixels and draws in color depending on the pixel values. The pixels are rendered in the worker if
+     * possible.
+     * min = blue, max = red
+     * @param {Float32Array} pixels
+     * @returns {Observable<boolean>}
      */
-    getGrayScalePixels(): Uint8ClampedArray {
+    setColorScalePixels(pixels: Float32Array): Observable<boolean> {
 
-        const width = this.context.canvas.width;
-        const height = this.context.canvas.height;
-        const imageData = this.context.getImageData(0, 0, width, height);
+        if (pixels.length !== this.context.canvas.width * this.context.canvas.height) {
+            return of(false);
+        }
+        this.changeImageId();
+
+        if (!this.isWorkerSupported()) {
+            return of(this.setColorScalePixelsOnMainThread(pixels));
+        }
 
-        return imageData.data.filter((value: number, i: number) => {
-            return i % 4 === 0;
-        });
+        return this.requestWorker({operation: "setColorScalePixels", pixels: pixels}).pipe(
+            map((data: any) => this.drawBitmap(data.bitmap))
+        );
 
     }
 
     /**
-     * Sets all pixels and draws grayscale depending on the pixel values.
-     * @param {Uint8ClampedArray} pixels
-     * @param {boolean} adjustScale
+     * Sets text at a given position.
+     * @param {string} text
+     * @param {number[]} position
+     * @param {number} fontSize
+     */
+    setText(text: string, position: number [], fontSize: number) {
+        this.context.shadowColor = "#000";
+        this.context.shadowOffsetX = 0;
+        this.context.shadowOffsetY = 0;
+        this.context.shadowBlur = fontSize / 10;
+        this.context.fillStyle = "#FFF";
+        this.context.font = ( fontSize * this.size / 1024) + "px Arial";
+        this.context.fillText(text, position[0] * this.size / 1024, position[1] * this.size / 1024);
+        this.changeImageId();
+    }
+
+    /**
+     * Terminates the worker of the canvas image.
+     */
+    destroy() {
+        if (this.worker !== null) {
+            this.worker.terminate();
+            this.worker = null;
+        }
+        this.workerRequests.clear();
+    }
+
+    /**
+     * Downloads the whole canvas as an image.
+     */
+    download() {
+        (<HTMLCanvasElement> this.canvasElement.nativeElement).toBlob(
+            (blob: Blob) => {
+                FileSaver.saveAs(blob, "image.jpg");
+            }, "image/jpeg");
+    }
+
+    /**
+     * Gives out a new image id, since the content of the canvas is replaced. The gray scale conversion keeps the id,
+     * since the gray values stay the same.
+     */
+    private changeImageId() {
+        this._imageId = ++CanvasImage.lastImageId;
+    }
+
+    /**
+     * Determines whether the pixels can be converted and rendered in a worker.
+     * @returns {boolean}
+     */
+    private isWorkerSupported(): boolean {
+        return typeof Worker !== "undefined" && typeof (<any> self).OffscreenCanvas !== "undefined" &&
+            typeof createImageBitmap !== "undefined";
+    }
+
+    /**
+     * Sends a request to the worker, which is created on the first request. If withBitmap is set, a bitmap of the
+     * current canvas is sent along.
+     * @param message
+     * @param {boolean} withBitmap
+     * @returns {Observable<any>}
+     */
+    private requestWorker(message: any, withBitmap?: boolean): Observable<any> {
+
+        return new Observable<any>(
+            (observer) => {
+
+                if (this.worker === null) {
+                    this.worker = new Worker("assets/js/canvasImage.js");
+                    this.worker.onmessage = (event: MessageEvent) => {
+                        const requestObserver: Subscriber<any> = this.workerRequests.get(event.data.id);
+                        this.workerRequests.delete(event.data.id);
+                        if (requestObserver === undefined) return;
+                        if (event.data.error !== undefined) {
+                            requestObserver.error(event.data.error);
+                        } else {
+                            requestObserver.next(event.data);
+                            requestObserver.complete();
+                        }
+                    };
+                }
+
+                const id: number = ++this.workerRequestId;
+                const width: number = this.context.canvas.width;
+                const height: number = this.context.canvas.height;
+                this.workerRequests.set(id, observer);
+
+                if (withBitmap) {
+                    createImageBitmap(this.context.canvas).then(
+                        (bitmap: ImageBitmap) => {
+                            this.worker.postMessage({...message, id: id, width: width, height: height, bitmap: bitmap}, [bitmap]);
+                        },
+                        (error: any) => {
+                            this.workerRequests.delete(id);
+                            observer.error(error);
+                        }
+                    );
+                } else {
+                    this.worker.postMessage({...message, id: id, width: width, height: height});
+                }
+
+            }
+        );
+
+    }
+
+    /**
+     * Draws a bitmap rendered by the worker to the canvas.
+     * @param {ImageBitmap} bitmap
      * @returns {boolean}
      */
-    setGrayScalePixels(pixels: Uint8ClampedArray, adjustScale?: boolean): boolean {
+    private drawBitmap(bitmap: ImageBitmap): boolean {
+        this.context.drawImage(bitmap, 0, 0);
+        bitmap.close();
+        return true;
+    }
+
+    /**
+     * Converts any image to gray scale on the main thread.
+     */
+    private toGrayScaleOnMainThread() {
 
         const width = this.context.canvas.width;
         const height = this.context.canvas.height;
         const imageData = this.context.getImageData(0, 0, width, height);
 
-        if (pixels.length !== width * height) {
-            return false;
-        }
-
-        const minMax: number[] = this.findMinMax(pixels);
-        const diff: number = minMax[1] - minMax[0];
-        const scale: number = diff > 0 && adjustScale ? 256.0 / diff : 1;
-
-        let j: number = 0;
         for (let y = 0; y < height; y++) {
             for (let x = 0; x < width; x++) {
                 const i: number = (y * 4) * width + x * 4;
-                imageData.data[i] = scale * ( pixels[j] - minMax[0] );
-                imageData.data[i + 1] = imageData.data[i];
-                imageData.data[i + 2] = imageData.data[i];
-                j++;
+                const average: number = (imageData.data[i] + imageData.data[i + 1] + imageData.data[i + 2]) / 3;
+                imageData.data[i] = average;
+                imageData.data[i + 1] = average;
+                imageData.data[i + 2] = average;
             }
         }
 
@@ -160,30 +381,51 @@ export class CanvasImage {
             this.context.putImageData(imageData, 0, 0, 0, 0, imageData.width, imageData.height);
         }
 
-        return true;
-
     }
 
     /**
-     * Draws axes in the canvas.
+     * Gets the gray value of all pixels on the main thread.
+     * @returns {Float32Array}
      */
-    drawAxes() {
+    private getGrayScalePixelsOnMainThread(): Float32Array {
 
         const width = this.context.canvas.width;
         const height = this.context.canvas.height;
         const imageData = this.context.getImageData(0, 0, width, height);
+        const pixels: Float32Array = new Float32Array(width * height);
 
-        for (let y = 0; y < height; y++) {
-            for (let x = 0; x < width; x++) {
+        for (let i = 0, len = pixels.length; i < len; i++) {
+            pixels[i] = (imageData.data[4 * i] + imageData.data[4 * i + 1] + imageData.data[4 * i + 2]) / 3;
+        }
 
-                if (width / 2 !== x && height / 2 !== y) continue;
+        return pixels;
 
-                const i: number = (y * 4) * width + x * 4;
+    }
 
-                imageData.data[i] = 0;
-                imageData.data[i + 1] = 0;
-                imageData.data[i + 2] = 0;
+    /**
+     * Sets all pixels and draws grayscale depending on the pixel values on the main thread.
+     * @param {Float32Array} pixels
+     * @param {boolean} adjustScale
+     * @returns {boolean}
+     */
+    private setGrayScalePixelsOnMainThread(pixels: Float32Array, adjustScale?: boolean): boolean {
+
+        const width = this.context.canvas.width;
+        const height = this.context.canvas.height;
+        const imageData = this.context.getImageData(0, 0, width, height);
+
+        const minMax: number[] = this.findMinMax(pixels);
+        const diff: number = minMax[1] - minMax[0];
+        const scale: number = diff > 0 && adjustScale ? 256.0 / diff : 1;
 
+        let j: number = 0;
+        for (let y = 0; y < height; y++) {
+            for (let x = 0; x < width; x++) {
+                const i: number = (y * 4) * width + x * 4;
+                imageData.data[i] = scale * ( pixels[j] - minMax[0] );
+                imageData.data[i + 1] = imageData.data[i];
+                imageData.data[i + 2] = imageData.data[i];
+                j++;
             }
         }
 
@@ -191,24 +433,21 @@ export class CanvasImage {
             this.context.putImageData(imageData, 0, 0, 0, 0, imageData.width, imageData.height);
         }
 
+        return true;
+
     }
 
     /**
-     * Sets all pixels and draws in color depending on the pixel values.
-     * min = blue, max = red
-     * @param {Uint8ClampedArray} pixels
+     * Sets all pixels and draws in color depending on the pixel values on the main thread.
+     * @param {Float32Array} pixels
      * @returns {boolean}
      */
-    setColorScalePixels(pixels: Uint8ClampedArray): boolean {
+    private setColorScalePixelsOnMainThread(pixels: Float32Array): boolean {
 
         const width = this.context.canvas.width;
         const height = this.context.canvas.height;
         const imageData = this.context.getImageData(0, 0, width, height);
 
-        if (pixels.length !== width * height) {
-            return false;
-        }
-
         const minMax: number[] = this.findMinMax(pixels);
         const z0: number = minMax[0];
         const z1: number = z0 + (minMax[1] - minMax[0]) / 3;
@@ -248,37 +487,30 @@ export class CanvasImage {
     }
 
     /**
-     * Sets text at a given position.
-     * @param {string} text
-     * @param {number[]} position
-     * @param {number} fontSize
+     * Gets the values of pixels that may be quantized.
+     * @param {Float32Array | QuantizedPixels} pixels
+     * @returns {Float32Array}
      */
-    setText(text: string, position: number [], fontSize: number) {
-        this.context.shadowColor = "#000";
-        this.context.shadowOffsetX = 0;
-        this.context.shadowOffsetY = 0;
-        this.context.shadowBlur = fontSize / 10;
-        this.context.fillStyle = "#FFF";
-        this.context.font = ( fontSize * this.size / 1024) + "px Arial";
-        this.context.fillText(text, position[0] * this.size / 1024, position[1] * this.size / 1024);
-    }
+    private dequantize(pixels: Float32Array | QuantizedPixels): Float32Array {
+
+        if (pixels instanceof Float32Array) return pixels;
+
+        const step: number = (pixels.max - pixels.min) / (Math.pow(2, pixels.bits) - 1);
+        const values: Float32Array = new Float32Array(pixels.levels.length);
+        for (let i = 0, len = values.length; i < len; i++) {
+            values[i] = pixels.min + step * pixels.levels[i];
+        }
+
+        return values;
 
-    /**
-     * Downloads the whole canvas as an image.
-     */
-    download() {
-        (<HTMLCanvasElement> this.canvasElement.nativeElement).toBlob(
-            (blob: Blob) => {
-                FileSaver.saveAs(blob, "image.jpg");
-            }, "image/jpeg");
     }
 
     /**
      * Gets the minimum and maximum value of an array.
-     * @param {Uint8ClampedArray} pixels
+     * @param {Float32Array} pixels
      * @returns {number[]}
      */
-    private findMinMax(pixels: Uint8ClampedArray): number[] {
+    private findMinMax(pixels: Float32Array): number[] {
 
         let min: number = pixels[0], max: number = pixels[0];
 
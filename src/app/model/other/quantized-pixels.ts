@@ -0,0 +1,26 @@
+/**
+ * Pixel values quantized to 8 or 16 bit levels, where level k stands for the value min + k * (max - min) / (2^bits - 1).
+ */
+export interface QuantizedPixels {
+
+    /**
+     * The levels of all pixels
+     */
+    levels: Uint8Array | Uint16Array;
+
+    /**
+     * The number of bits per level, 8 or 16
+     */
+    bits: number;
+
+    /**
+     * The value of the lowest level
+     */
+    min: number;
+
+    /**
+     * The value of the highest level
+     */
+    max: number;
+
+}
@@ -0,0 +1,26 @@
+/**
+ * A rectangular region of an image in pixels.
+ */
+export interface Region {
+
+    /**
+     * The column of the top left pixel
+     */
+    x: number;
+
+    /**
+     * The row of the top left pixel
+     */
+    y: number;
+
+    /**
+     * The number of columns
+     */
+    width: number;
+
+    /**
+     * The number of rows
+     */
+    height: number;
+
+}
@@ -1,6 +1,5 @@
 import {AfterViewInit, Component, ElementRef, OnDestroy, OnInit, ViewChild} from "@angular/core";
 import {Event, Router} from "@angular/router";
-import {interval, Subscription} from "rxjs";
 
 import {NgbModal, NgbModalRef} from "@ng-bootstrap/ng-bootstrap";
 
@@ -8,6 +7,7 @@ import {ImageProcessingService} from "../../model/math/image-processing.service"
 import {ProgressService} from "../../model/math/progress.service";
 
 import {CanvasImage} from "../../model/other/canvas-image";
+import {QuantizedPixels} from "../../model/other/quantized-pixels";
 import {FilterComponent} from "../filter/filter.component";
 
 @Component({
@@ -133,10 +133,10 @@ export class DemoComponent implements OnInit, AfterViewInit, OnDestroy {
     @ViewChild("filterModal") filterModal: NgbModalRef;
 
     /**
-     * An estimate of the average calculation time based on 1024 image
+     * The animation frame that polls the progress of the convolution, or 0 if none is requested
      * @type {number}
      */
-    private calculationDurationEstimates: number = 3000;
+    private progressFrame: number = 0;
 
 
     //////////////////
@@ -177,7 +177,11 @@ export class DemoComponent implements OnInit, AfterViewInit, OnDestroy {
      * NgOnDestroy.
      */
     ngOnDestroy() {
+        this.imageProcessingService.releaseImage();
+        this.inputCanvasImage.destroy();
+        this.outputCanvasImage.destroy();
         this.progressService.percentage = 0;
+        cancelAnimationFrame(this.progressFrame);
     }
 
 
@@ -264,7 +268,12 @@ export class DemoComponent implements OnInit, AfterViewInit, OnDestroy {
 
         canvasImage.setImageSource(url).subscribe(
             (success: boolean) => {
-                canvasImage.toGrayScale();
+                canvasImage.toGrayScale().subscribe(
+                    (grayScaleSuccess: boolean) => {},
+                    (error: any) => {
+                        console.error(error);
+                    }
+                );
             },
             (error: any) => {
                 console.error(error);
@@ -298,22 +307,41 @@ export class DemoComponent implements OnInit, AfterViewInit, OnDestroy {
 
 
     /**
-     * Calculates the convolution using the methods from C/WebAssembly code.
+     * Calculates the convolution using the methods from C/WebAssembly code. A low resolution preview and the running
+     * sum over the orientations are shown while the calculation is in progress, and a convolution that is still in
+     * progress is cancelled. The input image is kept along with its spectrum as long as it does not change, so that it
+     * is neither read from the canvas nor transformed again for other params.
      */
     convoluteImage() {
 
         // Reset progress
         this.progressService.percentage = 5;
+        this.pollProgress();
 
-        // Get image pixels of input image
-        const pixels: Float32Array = new Float32Array(this.inputCanvasImage.getGrayScalePixels());
+        // The input image is kept already
+        const imageId: number = this.inputCanvasImage.imageId;
+        if (this.imageProcessingService.hasImage(imageId)) {
+            this.convolutePixels(null, imageId);
+            return;
+        }
 
-        // Estimate the calculation time
-        const l: number = this.calculationDurationEstimates;
-        const subscription: Subscription = interval(this.amount * l * pixels.length / ( 1024 * 1024 ) / 45).subscribe(
-            _ => { this.progressService.percentage += 2; }
+        // Get image pixels of input image
+        this.inputCanvasImage.getGrayScalePixels().subscribe(
+            (pixels: Float32Array) => this.convolutePixels(pixels, imageId),
+            (error: any) => {
+                console.error(error);
+                this.progressService.percentage = 100;
+            }
         );
 
+    }
+
+    /**
+     * Calculates the convolution of the pixels of the input image, which may be null if the image of the id is kept.
+     * @param {Float32Array} pixels
+     * @param {number} imageId
+     */
+    private convolutePixels(pixels: Float32Array, imageId: number) {
         this.imageProcessingService.gaborConvolution2(
             pixels,
             this.xi,
@@ -321,19 +349,40 @@ export class DemoComponent implements OnInit, AfterViewInit, OnDestroy {
             this.lambda,
             (-2 * Math.PI * this.theta / 360),
             this.amount,
-            (fConv: Float32Array, event: MessageEvent) => {
-                // console.log(event.data.fConv);
-                subscription.unsubscribe();
-                this.outputCanvasImage.setGrayScalePixels(<any> fConv);
+            (fConv: Float32Array | QuantizedPixels, event: MessageEvent) => {
+                this.outputCanvasImage.setGrayScalePixels(fConv).subscribe();
                 this.progressService.percentage = 100;
             },
             (event: ErrorEvent) => {
                 console.error(event);
-                subscription.unsubscribe();
                 this.progressService.percentage = 100;
-            }
+            },
+            (fPartial: Float32Array | QuantizedPixels, progress: number, event: MessageEvent) => {
+                this.outputCanvasImage.setGrayScalePixels(fPartial).subscribe();
+                if (this.imageProcessingService.gaborConvolution2Progress() === null) {
+                    this.progressService.percentage = Math.max(this.progressService.percentage, 5 + 90 * progress);
+                }
+            },
+            8,
+            undefined,
+            imageId
         );
+    }
+
 
+    /**
+     * Reads the progress of the convolution from its shared control block on every animation frame while the
+     * convolution is in progress. Without shared memory, the progress comes with the partial results instead.
+     */
+    private pollProgress() {
+        cancelAnimationFrame(this.progressFrame);
+        this.progressFrame = 0;
+        if (!this.progressService.isInProgress()) return;
+        const progress: number = this.imageProcessingService.gaborConvolution2Progress();
+        if (progress !== null) {
+            this.progressService.percentage = Math.max(this.progressService.percentage, 5 + 90 * progress);
+        }
+        this.progressFrame = requestAnimationFrame(() => this.pollProgress());
     }
 
 
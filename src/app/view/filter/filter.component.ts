@@ -1,4 +1,4 @@
-import {AfterViewInit, Component, ElementRef, OnInit, ViewChild} from "@angular/core";
+import {AfterViewInit, Component, ElementRef, OnDestroy, OnInit, ViewChild} from "@angular/core";
 
 import {NgbActiveModal} from "@ng-bootstrap/ng-bootstrap";
 
@@ -11,7 +11,7 @@ import {CanvasImage} from "../../model/other/canvas-image";
     templateUrl: "./filter.component.html",
     styleUrls: ["./filter.component.scss"]
 })
-export class FilterComponent implements OnInit, AfterViewInit {
+export class FilterComponent implements OnInit, AfterViewInit, OnDestroy {
 
     ///////////////////
     // FILTER PARAMS //
@@ -108,6 +108,14 @@ export class FilterComponent implements OnInit, AfterViewInit {
 
     }
 
+    /**
+     * NgOnDestroy.
+     */
+    ngOnDestroy() {
+        this.filterRealCanvasImage.destroy();
+        this.filterImagCanvasImage.destroy();
+    }
+
     /**
      * Calculates the filter and saves it to the canvas.
      */
@@ -120,8 +128,8 @@ export class FilterComponent implements OnInit, AfterViewInit {
             this.lambda,
             (-2 * Math.PI * this.theta / 360),
             (gReal: Float32Array, gImag: Float32Array, event: MessageEvent) => {
-                this.filterRealCanvasImage.setColorScalePixels(<any> gReal);
-                this.filterImagCanvasImage.setColorScalePixels(<any> gImag);
+                this.filterRealCanvasImage.setColorScalePixels(gReal).subscribe();
+                this.filterImagCanvasImage.setColorScalePixels(gImag).subscribe();
             },
             (event: ErrorEvent) => {
                 console.error(event);
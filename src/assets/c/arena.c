@@ -0,0 +1,92 @@
+#include <stdlib.h>
+#include "arena.h"
+#include "error.h"
+
+#define ARENA_ALIGNMENT 16
+
+/**
+ * Gets the number of bytes a buffer of given size occupies in an arena.
+ */
+size_t _arenaSize(size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~((size_t) ARENA_ALIGNMENT - 1);
+}
+
+/**
+ * Makes sure the arena holds at least the given capacity. The memory is only
+ * reallocated if the current capacity is too small, so repeated calls of the
+ * same size never touch the allocator. Returns 0 on success.
+ */
+int _arenaReserve(Arena *arena, size_t capacity) {
+
+    capacity = _arenaSize(capacity);
+
+    if (arena->data != NULL && arena->capacity >= capacity) {
+        return 0;
+    }
+
+    free(arena->data);
+    arena->data = malloc(capacity);
+    arena->capacity = arena->data != NULL ? capacity : 0;
+    arena->offset = 0;
+
+    if (arena->data == NULL) {
+        _error("Error in arena: Could not reserve %zu bytes.\n", capacity);
+        return 1;
+    }
+
+    return 0;
+
+}
+
+/**
+ * Allocates an aligned buffer from the arena. The arena never grows here:
+ * every entry point must first _arenaReserve the bytes its _xxxArenaSize
+ * function gives, so that the allocations below it cannot fail and their
+ * results are not checked. Returns NULL if the buffer does not fit anyway.
+ */
+void *_arenaAlloc(Arena *arena, size_t size) {
+
+    size = _arenaSize(size);
+
+    if (arena->offset + size > arena->capacity) {
+        _error("Error in arena: Out of memory (%zu of %zu bytes used, %zu requested).\n",
+            arena->offset, arena->capacity, size);
+        return NULL;
+    }
+
+    void *p = arena->data + arena->offset;
+    arena->offset += size;
+    return p;
+
+}
+
+/**
+ * Gets the current position of the arena, to be released to later.
+ */
+size_t _arenaMark(Arena *arena) {
+    return arena->offset;
+}
+
+/**
+ * Releases all buffers allocated after the given mark.
+ */
+void _arenaRelease(Arena *arena, size_t mark) {
+    arena->offset = mark;
+}
+
+/**
+ * Releases all buffers of the arena but keeps its memory.
+ */
+void _arenaReset(Arena *arena) {
+    arena->offset = 0;
+}
+
+/**
+ * Frees the memory of the arena.
+ */
+void _arenaDestroy(Arena *arena) {
+    free(arena->data);
+    arena->data = NULL;
+    arena->capacity = 0;
+    arena->offset = 0;
+}
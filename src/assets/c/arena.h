@@ -0,0 +1,25 @@
+#include <stddef.h>
+
+#ifndef ARENA_H
+#define ARENA_H
+
+/**
+ * A bump allocator for transient buffers. The memory is reserved once and
+ * handed out linearly; instead of freeing single buffers, the arena is
+ * released back to a mark or reset as a whole.
+ */
+typedef struct Arena {
+    char *data;
+    size_t capacity;
+    size_t offset;
+} Arena;
+
+size_t _arenaSize(size_t size);
+int _arenaReserve(Arena *arena, size_t capacity);
+void *_arenaAlloc(Arena *arena, size_t size);
+size_t _arenaMark(Arena *arena);
+void _arenaRelease(Arena *arena, size_t mark);
+void _arenaReset(Arena *arena);
+void _arenaDestroy(Arena *arena);
+
+#endif
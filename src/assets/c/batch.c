@@ -0,0 +1,163 @@
+#include <stdlib.h>
+#include <complex.h>
+#include <pthread.h>
+#include "arena.h"
+#include "batch.h"
+#include "control.h"
+#include "error.h"
+#include "gabor.h"
+#include "tuner.h"
+
+/**
+ * The state of a batch shared by the threads of the pool.
+ */
+typedef struct Batch {
+    Plan *plan;
+    float *images;
+    float *results;
+    int count;
+    int n;
+    float xi;
+    float sigma;
+    float lambda;
+    float theta;
+    int amount;
+    float complex *y2Hats;
+    BatchCallback callback;
+    void *data;
+    Control *control;
+    int next;
+    pthread_mutex_t lock;
+} Batch;
+
+/**
+ * Gets the arena bytes a thread needs for one image of a batch, besides its
+ * result.
+ */
+static size_t _batchImageArenaSize(Plan *plan) {
+    return plan->strategy == STRATEGY_FFT ? _fgc2SpectraArenaSize(plan->n) : _fgc2PlannedArenaSize(plan);
+}
+
+/**
+ * Takes the index of the next image to calculate. Returns -1 if all images
+ * have been taken or the batch is cancelled.
+ */
+static int _batchNext(Batch *batch) {
+
+    pthread_mutex_lock(&batch->lock);
+    int index = batch->next < batch->count && !_controlCancelled(batch->control) ? batch->next++ : -1;
+    pthread_mutex_unlock(&batch->lock);
+
+    return index;
+
+}
+
+/**
+ * Calculates images of a batch until all images have been taken. Each thread
+ * has its own arena, so that the threads never share a transient buffer.
+ */
+static void *_batchWorker(void *argument) {
+
+    Batch *batch = argument;
+    int n = batch->n;
+    size_t size = (size_t) n * n;
+
+    // Without an output tensor, the result of an image lives in the arena until the callback returns
+    Arena arena = {0};
+    size_t resultSize = batch->results == NULL ? _arenaSize(size * sizeof(float)) : 0;
+    if (_arenaReserve(&arena, resultSize + _batchImageArenaSize(batch->plan))) return NULL;
+    float *scratch = batch->results == NULL ? _arenaAlloc(&arena, size * sizeof(float)) : NULL;
+
+    int index;
+    while ((index = _batchNext(batch)) >= 0) {
+
+        float *y1 = &batch->images[index * size];
+        float *yConvSum = batch->results != NULL ? &batch->results[index * size] : scratch;
+
+        if (batch->y2Hats != NULL) {
+            _fgc2Spectra(y1, batch->y2Hats, yConvSum, n, batch->amount, NULL, &arena);
+        } else {
+            _fgc2Planned(batch->plan, y1, yConvSum, n, batch->xi, batch->sigma, batch->lambda, batch->theta, batch->amount, NULL, NULL, &arena);
+        }
+
+        if (batch->callback != NULL) batch->callback(index, yConvSum, batch->data);
+        _controlStep(batch->control);
+
+    }
+
+    _arenaDestroy(&arena);
+
+    return NULL;
+
+}
+
+/**
+ * Calculates the 2D fast Gabor convolution of count images of size n*n, saved
+ * one after the other into images, with the same filter params. With the
+ * Fourier method, the spectra of the amount filters are calculated once in the
+ * given arena and shared by all images. The images are spread over a pool of
+ * threads, including the calling one; if threads cannot be created, the
+ * calling thread calculates the remaining images alone. The results are saved
+ * one after the other into results, if not NULL, and passed to the callback,
+ * if not NULL. The images are the steps of the control, if given; once it is
+ * cancelled, no more images are taken. Returns 0 on success.
+ */
+int _fgc2Batch(Plan *plan, float *images, float *results, int count, int n, float xi, float sigma, float lambda, float theta, int amount, int threads, BatchCallback callback, void *data, Control *control, Arena *arena) {
+
+    if (results == NULL && callback == NULL) {
+        _error("Error in batch: Either results or a callback must be given.\n");
+        return 1;
+    }
+
+    size_t mark = _arenaMark(arena);
+    Batch batch = {plan, images, results, count, n, xi, sigma, lambda, theta, amount, NULL, callback, data, control, 0};
+    pthread_mutex_init(&batch.lock, NULL);
+    _controlBegin(control, count);
+
+    // Calculate the spectra of the filters once
+    if (plan->strategy == STRATEGY_FFT) {
+        batch.y2Hats = _arenaAlloc(arena, (size_t) amount * n * n * sizeof(float complex));
+        if (batch.y2Hats == NULL) {
+            pthread_mutex_destroy(&batch.lock);
+            return 1;
+        }
+        for (int j = 0; j < amount; j++) {
+            _fgc2FilterSpectrum(&batch.y2Hats[(size_t) j * n * n], n, xi, sigma, lambda, theta, j, amount, arena);
+        }
+    }
+
+    // Start the pool, no more threads than images
+    threads = threads < count ? threads : count;
+    pthread_t *pool = malloc((threads > 1 ? threads - 1 : 1) * sizeof(pthread_t));
+    int started = 0;
+    while (started < threads - 1 && pthread_create(&pool[started], NULL, _batchWorker, &batch) == 0) {
+        started++;
+    }
+
+    _batchWorker(&batch);
+
+    for (int t = 0; t < started; t++) {
+        pthread_join(pool[t], NULL);
+    }
+    free(pool);
+
+    pthread_mutex_destroy(&batch.lock);
+    _arenaRelease(arena, mark);
+
+    // Images are only left if the batch is cancelled or no thread could reserve its arena
+    return batch.next < count;
+
+}
+
+/**
+ * Gets the bytes needed by _fgc2Batch in the given arena, that is the spectra
+ * of the filters. Each thread reserves its own arena.
+ */
+size_t _fgc2BatchArenaSize(Plan *plan) {
+
+    if (plan->strategy != STRATEGY_FFT) return 0;
+
+    size_t n = plan->n;
+    return _arenaSize(plan->amount * n * n * sizeof(float complex)) + _fgc2FilterSpectrumArenaSize(plan->n);
+
+}
@@ -0,0 +1,20 @@
+#include <stddef.h>
+#include "arena.h"
+#include "control.h"
+#include "tuner.h"
+
+#ifndef BATCH_H
+#define BATCH_H
+
+/**
+ * Called with the result of image index of a batch. It is called from the
+ * thread that calculated the image, so calls for different images may run
+ * at the same time.
+ */
+typedef void (*BatchCallback)(int index, float *yConvSum, void *data);
+
+int _fgc2Batch(Plan *plan, float *images, float *results, int count, int n, float xi, float sigma, float lambda, float theta, int amount, int threads, BatchCallback callback, void *data, Control *control, Arena *arena);
+
+size_t _fgc2BatchArenaSize(Plan *plan);
+
+#endif
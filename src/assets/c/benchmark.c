@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <complex.h>
+#include <math.h>
+#include <time.h>
+#include "arena.h"
+#include "codelets.h"
+#include "fourier.h"
+
+/**
+ * Gets the current time in ms.
+ */
+static double _now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1e3 + time.tv_nsec / 1e6;
+}
+
+/**
+ * Calculates the 1D fast Fourier transform of an array like _fft1 did before
+ * the arena and the codelets, with the buffers of each split allocated and
+ * every twiddle factor calculated by cexp.
+ */
+static void _fft1Reference(float complex *y, float complex *yHat, int n) {
+
+    if (n == 2) {
+        yHat[0] = y[0]+y[1];
+        yHat[1] = y[0]-y[1];
+        return;
+    }
+
+    n = n/2;
+    float complex *yEven = malloc(n * sizeof(float complex));
+    float complex *yOdd = malloc(n * sizeof(float complex));
+    for (int i = 0; i < n; i++) {
+        yEven[i] = y[2*i];
+        yOdd[i] = y[2*i+1];
+    }
+
+    float complex *c = malloc(n * sizeof(float complex));
+    _fft1Reference(yEven, c, n);
+    free(yEven);
+
+    float complex *d = malloc(n * sizeof(float complex));
+    _fft1Reference(yOdd, d, n);
+    free(yOdd);
+
+    float pi = acos(-1.0);
+    for (int i = 0; i < n; i++) {
+        d[i] = cexp(-1.0*I*pi*i/n)*d[i];
+    }
+
+    for (int i = 0; i < n; i++) {
+        yHat[i] = c[i]+d[i];
+        yHat[i+n] = c[i]-d[i];
+    }
+    free(c);
+    free(d);
+
+}
+
+/**
+ * Measures the best time of some rounds of transforms of size n with the given
+ * leaf in ns per transform, or of _fft1Reference if leaf is 0. Each round
+ * transforms about a million values.
+ */
+static double _measure(float complex *y, float complex *yHat, int n, int leaf, Arena *arena) {
+
+    int repeats = (1 << 20) / n;
+    double best = INFINITY;
+    for (int round = 0; round < 5; round++) {
+        double start = _now();
+        for (int r = 0; r < repeats; r++) {
+            if (leaf == 0) _fft1Reference(y, yHat, n);
+            else _fft1Leaf(y, yHat, n, leaf, arena);
+        }
+        double time = (_now() - start) / repeats * 1e6;
+        best = time < best ? time : best;
+    }
+    return best;
+
+}
+
+/**
+ * Compares the 1D fast Fourier transform as it was before the arena and the
+ * codelets, the transform split down to single values on the arena with the
+ * twiddle recurrence, and the transform on the codelets, for the sizes 2 up to
+ * the given one (default 1024). The speedup is that of the codelets over the
+ * transform before, and the deviation the largest difference of their results
+ * relative to the largest value.
+ */
+int main(int argc, char **argv) {
+
+    int maxSize = argc > 1 ? atoi(argv[1]) : 1024;
+    if (maxSize < 2) {
+        printf("Usage: %s [size]\n", argv[0]);
+        return 1;
+    }
+
+    Arena arena = {0};
+    if (_arenaReserve(&arena, _fft1ArenaSize(maxSize))) return 1;
+    float complex *y = malloc(maxSize * sizeof(float complex));
+    float complex *yHat = malloc(maxSize * sizeof(float complex));
+    float complex *yHatLeaf = malloc(maxSize * sizeof(float complex));
+    srand(1);
+    for (int i = 0; i < maxSize; i++) {
+        y[i] = (float) rand() / RAND_MAX - 0.5 + I * ((float) rand() / RAND_MAX - 0.5);
+    }
+
+    printf("%6s %12s %12s %12s %8s %10s\n", "n", "before ns", "split ns", "codelet ns", "speedup", "deviation");
+    for (int n = 2; n <= maxSize; n *= 2) {
+
+        _fft1Reference(y, yHat, n);
+        _fft1Leaf(y, yHatLeaf, n, FFT_CODELET_MAX, &arena);
+        float deviation = 0, max = 0;
+        for (int i = 0; i < n; i++) {
+            deviation = fmaxf(deviation, cabsf(yHat[i] - yHatLeaf[i]));
+            max = fmaxf(max, cabsf(yHat[i]));
+        }
+
+        double before = _measure(y, yHat, n, 0, &arena);
+        double split = _measure(y, yHat, n, 1, &arena);
+        double codelet = _measure(y, yHat, n, FFT_CODELET_MAX, &arena);
+        printf("%6d %12.1f %12.1f %12.1f %7.1fx %10.1e\n", n, before, split, codelet, before / codelet, deviation / max);
+
+    }
+
+    free(y);
+    free(yHat);
+    free(yHatLeaf);
+    _arenaDestroy(&arena);
+
+    return 0;
+
+}
@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <utime.h>
+#include "cache.h"
+#include "error.h"
+
+/**
+ * Calculates a fast 64-bit hash of pixel values as 16 hexadecimal digits. Two
+ * 32-bit multiplicative lanes run over the bits of the values, which is the
+ * same hash as ResultCacheService.hashPixels in the web application.
+ */
+void _hashPixels(float *pixels, int size, char *hash) {
+
+    uint32_t h1 = 0x811c9dc5u;
+    uint32_t h2 = 0x9747b28cu ^ (uint32_t) size;
+
+    for (int i = 0; i < size; i++) {
+        uint32_t w;
+        memcpy(&w, &pixels[i], sizeof(uint32_t));
+        h1 = (h1 ^ w) * 0x01000193u;
+        h2 = (h2 ^ w) * 0x5bd1e995u;
+        h2 ^= h2 >> 15;
+    }
+
+    snprintf(hash, 17, "%08x%08x", h1, h2);
+
+}
+
+/**
+ * Gets the cache key of a fgc2 result from the hash of the input pixels and
+ * the params.
+ */
+void _fgc2CacheKey(char *key, size_t length, char *hash, int n, float xi, float sigma, float lambda, float theta, int amount) {
+    snprintf(key, length, "fgc2-%s-%d-%.9g-%.9g-%.9g-%.9g-%d", hash, n, xi, sigma, lambda, theta, amount);
+}
+
+/**
+ * An entry of the cache directory, as seen by _cacheScan.
+ */
+typedef struct CacheEntry {
+    char name[256];
+    time_t time;
+    off_t size;
+} CacheEntry;
+
+/**
+ * Lists the entries of the cache directory into a new array of entries, if
+ * given, and sums up their sizes. Returns the amount of entries, or -1 if the
+ * directory cannot be read.
+ */
+static int _cacheScan(ResultCache *cache, CacheEntry **entries, size_t *total) {
+
+    DIR *dir = opendir(cache->directory);
+    if (dir == NULL) return -1;
+
+    int count = 0, capacity = 64;
+    CacheEntry *list = entries != NULL ? malloc(capacity * sizeof(CacheEntry)) : NULL;
+    *total = 0;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        if (length < 4 || strcmp(entry->d_name + length - 4, ".bin") != 0) continue;
+
+        char path[1024];
+        struct stat info;
+        snprintf(path, sizeof(path), "%s/%s", cache->directory, entry->d_name);
+        if (stat(path, &info) != 0) continue;
+        *total += info.st_size;
+
+        if (list == NULL) continue;
+        if (count == capacity) {
+            capacity *= 2;
+            list = realloc(list, capacity * sizeof(CacheEntry));
+        }
+        snprintf(list[count].name, sizeof(list[count].name), "%s", entry->d_name);
+        list[count].time = info.st_mtime;
+        list[count].size = info.st_size;
+        count++;
+    }
+    closedir(dir);
+
+    if (entries != NULL) *entries = list;
+    return count;
+
+}
+
+/**
+ * Compares two entries by the time they were last used.
+ */
+static int _compareEntries(const void *a, const void *b) {
+    time_t timeA = ((const CacheEntry *) a)->time;
+    time_t timeB = ((const CacheEntry *) b)->time;
+    return (timeA > timeB) - (timeA < timeB);
+}
+
+/**
+ * Deletes the least recently used entries until the cache is within 7/8 of
+ * its limit, so that the next stores do not evict again right away. The
+ * directory is scanned and sorted once, which also brings the running total
+ * up to date with the stores of other processes.
+ */
+static void _cacheEvict(ResultCache *cache) {
+
+    CacheEntry *entries;
+    size_t total;
+    int count = _cacheScan(cache, &entries, &total);
+    if (count < 0) return;
+
+    qsort(entries, count, sizeof(CacheEntry), _compareEntries);
+
+    size_t target = cache->limit - cache->limit / 8;
+    for (int i = 0; i < count && total > target; i++) {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", cache->directory, entries[i].name);
+        if (remove(path) == 0) total -= entries[i].size;
+    }
+
+    free(entries);
+    cache->total = total;
+
+}
+
+/**
+ * Opens a cache in the given directory, which is created if necessary. The
+ * size of the entries is read once and kept up to date by _cacheStore.
+ * Returns 0 on success.
+ */
+int _cacheOpen(ResultCache *cache, const char *directory, size_t limit) {
+
+    if (strlen(directory) >= sizeof(cache->directory)) {
+        _error("Error in cache: Directory name is too long.\n");
+        return 1;
+    }
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+        _error("Error in cache: Could not create directory %s.\n", directory);
+        return 1;
+    }
+
+    strcpy(cache->directory, directory);
+    cache->limit = limit;
+    if (_cacheScan(cache, NULL, &cache->total) < 0) {
+        _error("Error in cache: Could not read directory %s.\n", directory);
+        return 1;
+    }
+    if (cache->total > cache->limit) _cacheEvict(cache);
+
+    return 0;
+
+}
+
+/**
+ * Gets the path of a cache entry.
+ */
+static void _cachePath(ResultCache *cache, const char *key, char *path, size_t length) {
+    snprintf(path, length, "%s/%s.bin", cache->directory, key);
+}
+
+/**
+ * Loads a result of given size from the cache and marks it as recently used.
+ * Returns 0 on a hit.
+ */
+int _cacheLoad(ResultCache *cache, const char *key, void *data, size_t size) {
+
+    char path[1024];
+    _cachePath(cache, key, path, sizeof(path));
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return 1;
+
+    size_t read = fread(data, 1, size, file);
+    int more = fgetc(file) != EOF;
+    fclose(file);
+
+    if (read != size || more) return 1;
+
+    utime(path, NULL);
+    return 0;
+
+}
+
+/**
+ * Stores a result in the cache and evicts old entries once the running total
+ * crosses the limit. The result is written to a temporary file first, so that
+ * concurrent readers never see partial entries. Stores to the same cache must
+ * not run concurrently. Returns 0 on success.
+ */
+int _cacheStore(ResultCache *cache, const char *key, void *data, size_t size) {
+
+    if (size > cache->limit) return 1;
+
+    char path[1024], temporaryPath[1100];
+    _cachePath(cache, key, path, sizeof(path));
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.%ld.tmp", path, (long) getpid());
+
+    FILE *file = fopen(temporaryPath, "wb");
+    if (file == NULL) {
+        _error("Error in cache: Could not write %s.\n", temporaryPath);
+        return 1;
+    }
+    size_t written = fwrite(data, 1, size, file);
+    fclose(file);
+
+    // An entry that is replaced no longer counts
+    struct stat info;
+    size_t replaced = stat(path, &info) == 0 ? (size_t) info.st_size : 0;
+
+    if (written != size || rename(temporaryPath, path) != 0) {
+        remove(temporaryPath);
+        _error("Error in cache: Could not write %s.\n", path);
+        return 1;
+    }
+
+    cache->total = cache->total - (replaced < cache->total ? replaced : cache->total) + size;
+    if (cache->total > cache->limit) _cacheEvict(cache);
+    return 0;
+
+}
@@ -0,0 +1,24 @@
+#include <stddef.h>
+
+#ifndef CACHE_H
+#define CACHE_H
+
+/**
+ * A size-bounded cache of results on disk. Each result is a file in the
+ * directory, named by its key, and the least recently used files are deleted
+ * once the total size exceeds the limit. The total is read when the cache is
+ * opened and kept up to date by the stores.
+ */
+typedef struct ResultCache {
+    char directory[512];
+    size_t limit;
+    size_t total;
+} ResultCache;
+
+void _hashPixels(float *pixels, int size, char *hash);
+void _fgc2CacheKey(char *key, size_t length, char *hash, int n, float xi, float sigma, float lambda, float theta, int amount);
+int _cacheOpen(ResultCache *cache, const char *directory, size_t limit);
+int _cacheLoad(ResultCache *cache, const char *key, void *data, size_t size);
+int _cacheStore(ResultCache *cache, const char *key, void *data, size_t size);
+
+#endif
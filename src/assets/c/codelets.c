@@ -0,0 +1,811 @@
+// Generated by codelets.js, do not edit.
+
+#include <complex.h>
+#include "codelets.h"
+
+/**
+ * Calculates the 1D fast Fourier transform of an array of 2 values. y and yHat may be the same.
+ */
+static void _fft1Codelet2(const float complex *y, float complex *yHat) {
+
+    const float *x = (const float *) y;
+    float *xHat = (float *) yHat;
+
+    const float t0 = x[0] + x[2];
+    const float t1 = x[1] + x[3];
+    const float t2 = x[0] - x[2];
+    const float t3 = x[1] - x[3];
+
+    xHat[0] = t0;
+    xHat[1] = t1;
+    xHat[2] = t2;
+    xHat[3] = t3;
+
+}
+
+/**
+ * Calculates the 1D fast Fourier transform of an array of 4 values. y and yHat may be the same.
+ */
+static void _fft1Codelet4(const float complex *y, float complex *yHat) {
+
+    const float *x = (const float *) y;
+    float *xHat = (float *) yHat;
+
+    const float t0 = x[0] + x[4];
+    const float t1 = x[1] + x[5];
+    const float t2 = x[0] - x[4];
+    const float t3 = x[1] - x[5];
+    const float t4 = x[2] + x[6];
+    const float t5 = x[3] + x[7];
+    const float t6 = x[2] - x[6];
+    const float t7 = x[3] - x[7];
+    const float t8 = t0 + t4;
+    const float t9 = t1 + t5;
+    const float t10 = t0 - t4;
+    const float t11 = t1 - t5;
+    const float t12 = t2 + t7;
+    const float t13 = t3 - t6;
+    const float t14 = t2 - t7;
+    const float t15 = t3 + t6;
+
+    xHat[0] = t8;
+    xHat[1] = t9;
+    xHat[2] = t12;
+    xHat[3] = t13;
+    xHat[4] = t10;
+    xHat[5] = t11;
+    xHat[6] = t14;
+    xHat[7] = t15;
+
+}
+
+/**
+ * Calculates the 1D fast Fourier transform of an array of 8 values. y and yHat may be the same.
+ */
+static void _fft1Codelet8(const float complex *y, float complex *yHat) {
+
+    const float *x = (const float *) y;
+    float *xHat = (float *) yHat;
+
+    const float t0 = x[0] + x[8];
+    const float t1 = x[1] + x[9];
+    const float t2 = x[0] - x[8];
+    const float t3 = x[1] - x[9];
+    const float t4 = x[4] + x[12];
+    const float t5 = x[5] + x[13];
+    const float t6 = x[4] - x[12];
+    const float t7 = x[5] - x[13];
+    const float t8 = t0 + t4;
+    const float t9 = t1 + t5;
+    const float t10 = t0 - t4;
+    const float t11 = t1 - t5;
+    const float t12 = t2 + t7;
+    const float t13 = t3 - t6;
+    const float t14 = t2 - t7;
+    const float t15 = t3 + t6;
+    const float t16 = x[2] + x[10];
+    const float t17 = x[3] + x[11];
+    const float t18 = x[2] - x[10];
+    const float t19 = x[3] - x[11];
+    const float t20 = x[6] + x[14];
+    const float t21 = x[7] + x[15];
+    const float t22 = x[6] - x[14];
+    const float t23 = x[7] - x[15];
+    const float t24 = t16 + t20;
+    const float t25 = t17 + t21;
+    const float t26 = t16 - t20;
+    const float t27 = t17 - t21;
+    const float t28 = t18 + t23;
+    const float t29 = t19 - t22;
+    const float t30 = t18 - t23;
+    const float t31 = t19 + t22;
+    const float t32 = t8 + t24;
+    const float t33 = t9 + t25;
+    const float t34 = t8 - t24;
+    const float t35 = t9 - t25;
+    const float t36 = 0.707106781f * (t28 + t29);
+    const float t37 = 0.707106781f * (t29 - t28);
+    const float t38 = t12 + t36;
+    const float t39 = t13 + t37;
+    const float t40 = t12 - t36;
+    const float t41 = t13 - t37;
+    const float t42 = t10 + t27;
+    const float t43 = t11 - t26;
+    const float t44 = t10 - t27;
+    const float t45 = t11 + t26;
+    const float t46 = 0.707106781f * (t31 - t30);
+    const float t47 = -0.707106781f * (t30 + t31);
+    const float t48 = t14 + t46;
+    const float t49 = t15 + t47;
+    const float t50 = t14 - t46;
+    const float t51 = t15 - t47;
+
+    xHat[0] = t32;
+    xHat[1] = t33;
+    xHat[2] = t38;
+    xHat[3] = t39;
+    xHat[4] = t42;
+    xHat[5] = t43;
+    xHat[6] = t48;
+    xHat[7] = t49;
+    xHat[8] = t34;
+    xHat[9] = t35;
+    xHat[10] = t40;
+    xHat[11] = t41;
+    xHat[12] = t44;
+    xHat[13] = t45;
+    xHat[14] = t50;
+    xHat[15] = t51;
+
+}
+
+/**
+ * Calculates the 1D fast Fourier transform of an array of 16 values. y and yHat may be the same.
+ */
+static void _fft1Codelet16(const float complex *y, float complex *yHat) {
+
+    const float *x = (const float *) y;
+    float *xHat = (float *) yHat;
+
+    const float t0 = x[0] + x[16];
+    const float t1 = x[1] + x[17];
+    const float t2 = x[0] - x[16];
+    const float t3 = x[1] - x[17];
+    const float t4 = x[8] + x[24];
+    const float t5 = x[9] + x[25];
+    const float t6 = x[8] - x[24];
+    const float t7 = x[9] - x[25];
+    const float t8 = t0 + t4;
+    const float t9 = t1 + t5;
+    const float t10 = t0 - t4;
+    const float t11 = t1 - t5;
+    const float t12 = t2 + t7;
+    const float t13 = t3 - t6;
+    const float t14 = t2 - t7;
+    const float t15 = t3 + t6;
+    const float t16 = x[4] + x[20];
+    const float t17 = x[5] + x[21];
+    const float t18 = x[4] - x[20];
+    const float t19 = x[5] - x[21];
+    const float t20 = x[12] + x[28];
+    const float t21 = x[13] + x[29];
+    const float t22 = x[12] - x[28];
+    const float t23 = x[13] - x[29];
+    const float t24 = t16 + t20;
+    const float t25 = t17 + t21;
+    const float t26 = t16 - t20;
+    const float t27 = t17 - t21;
+    const float t28 = t18 + t23;
+    const float t29 = t19 - t22;
+    const float t30 = t18 - t23;
+    const float t31 = t19 + t22;
+    const float t32 = t8 + t24;
+    const float t33 = t9 + t25;
+    const float t34 = t8 - t24;
+    const float t35 = t9 - t25;
+    const float t36 = 0.707106781f * (t28 + t29);
+    const float t37 = 0.707106781f * (t29 - t28);
+    const float t38 = t12 + t36;
+    const float t39 = t13 + t37;
+    const float t40 = t12 - t36;
+    const float t41 = t13 - t37;
+    const float t42 = t10 + t27;
+    const float t43 = t11 - t26;
+    const float t44 = t10 - t27;
+    const float t45 = t11 + t26;
+    const float t46 = 0.707106781f * (t31 - t30);
+    const float t47 = -0.707106781f * (t30 + t31);
+    const float t48 = t14 + t46;
+    const float t49 = t15 + t47;
+    const float t50 = t14 - t46;
+    const float t51 = t15 - t47;
+    const float t52 = x[2] + x[18];
+    const float t53 = x[3] + x[19];
+    const float t54 = x[2] - x[18];
+    const float t55 = x[3] - x[19];
+    const float t56 = x[10] + x[26];
+    const float t57 = x[11] + x[27];
+    const float t58 = x[10] - x[26];
+    const float t59 = x[11] - x[27];
+    const float t60 = t52 + t56;
+    const float t61 = t53 + t57;
+    const float t62 = t52 - t56;
+    const float t63 = t53 - t57;
+    const float t64 = t54 + t59;
+    const float t65 = t55 - t58;
+    const float t66 = t54 - t59;
+    const float t67 = t55 + t58;
+    const float t68 = x[6] + x[22];
+    const float t69 = x[7] + x[23];
+    const float t70 = x[6] - x[22];
+    const float t71 = x[7] - x[23];
+    const float t72 = x[14] + x[30];
+    const float t73 = x[15] + x[31];
+    const float t74 = x[14] - x[30];
+    const float t75 = x[15] - x[31];
+    const float t76 = t68 + t72;
+    const float t77 = t69 + t73;
+    const float t78 = t68 - t72;
+    const float t79 = t69 - t73;
+    const float t80 = t70 + t75;
+    const float t81 = t71 - t74;
+    const float t82 = t70 - t75;
+    const float t83 = t71 + t74;
+    const float t84 = t60 + t76;
+    const float t85 = t61 + t77;
+    const float t86 = t60 - t76;
+    const float t87 = t61 - t77;
+    const float t88 = 0.707106781f * (t80 + t81);
+    const float t89 = 0.707106781f * (t81 - t80);
+    const float t90 = t64 + t88;
+    const float t91 = t65 + t89;
+    const float t92 = t64 - t88;
+    const float t93 = t65 - t89;
+    const float t94 = t62 + t79;
+    const float t95 = t63 - t78;
+    const float t96 = t62 - t79;
+    const float t97 = t63 + t78;
+    const float t98 = 0.707106781f * (t83 - t82);
+    const float t99 = -0.707106781f * (t82 + t83);
+    const float t100 = t66 + t98;
+    const float t101 = t67 + t99;
+    const float t102 = t66 - t98;
+    const float t103 = t67 - t99;
+    const float t104 = t32 + t84;
+    const float t105 = t33 + t85;
+    const float t106 = t32 - t84;
+    const float t107 = t33 - t85;
+    const float t108 = t90 * 0.923879533f + t91 * 0.382683432f;
+    const float t109 = t91 * 0.923879533f - t90 * 0.382683432f;
+    const float t110 = t38 + t108;
+    const float t111 = t39 + t109;
+    const float t112 = t38 - t108;
+    const float t113 = t39 - t109;
+    const float t114 = 0.707106781f * (t94 + t95);
+    const float t115 = 0.707106781f * (t95 - t94);
+    const float t116 = t42 + t114;
+    const float t117 = t43 + t115;
+    const float t118 = t42 - t114;
+    const float t119 = t43 - t115;
+    const float t120 = t100 * 0.382683432f + t101 * 0.923879533f;
+    const float t121 = t101 * 0.382683432f - t100 * 0.923879533f;
+    const float t122 = t48 + t120;
+    const float t123 = t49 + t121;
+    const float t124 = t48 - t120;
+    const float t125 = t49 - t121;
+    const float t126 = t34 + t87;
+    const float t127 = t35 - t86;
+    const float t128 = t34 - t87;
+    const float t129 = t35 + t86;
+    const float t130 = t92 * -0.382683432f + t93 * 0.923879533f;
+    const float t131 = t93 * -0.382683432f - t92 * 0.923879533f;
+    const float t132 = t40 + t130;
+    const float t133 = t41 + t131;
+    const float t134 = t40 - t130;
+    const float t135 = t41 - t131;
+    const float t136 = 0.707106781f * (t97 - t96);
+    const float t137 = -0.707106781f * (t96 + t97);
+    const float t138 = t44 + t136;
+    const float t139 = t45 + t137;
+    const float t140 = t44 - t136;
+    const float t141 = t45 - t137;
+    const float t142 = t102 * -0.923879533f + t103 * 0.382683432f;
+    const float t143 = t103 * -0.923879533f - t102 * 0.382683432f;
+    const float t144 = t50 + t142;
+    const float t145 = t51 + t143;
+    const float t146 = t50 - t142;
+    const float t147 = t51 - t143;
+
+    xHat[0] = t104;
+    xHat[1] = t105;
+    xHat[2] = t110;
+    xHat[3] = t111;
+    xHat[4] = t116;
+    xHat[5] = t117;
+    xHat[6] = t122;
+    xHat[7] = t123;
+    xHat[8] = t126;
+    xHat[9] = t127;
+    xHat[10] = t132;
+    xHat[11] = t133;
+    xHat[12] = t138;
+    xHat[13] = t139;
+    xHat[14] = t144;
+    xHat[15] = t145;
+    xHat[16] = t106;
+    xHat[17] = t107;
+    xHat[18] = t112;
+    xHat[19] = t113;
+    xHat[20] = t118;
+    xHat[21] = t119;
+    xHat[22] = t124;
+    xHat[23] = t125;
+    xHat[24] = t128;
+    xHat[25] = t129;
+    xHat[26] = t134;
+    xHat[27] = t135;
+    xHat[28] = t140;
+    xHat[29] = t141;
+    xHat[30] = t146;
+    xHat[31] = t147;
+
+}
+
+/**
+ * Calculates the 1D fast Fourier transform of an array of 32 values. y and yHat may be the same.
+ */
+static void _fft1Codelet32(const float complex *y, float complex *yHat) {
+
+    const float *x = (const float *) y;
+    float *xHat = (float *) yHat;
+
+    const float t0 = x[0] + x[32];
+    const float t1 = x[1] + x[33];
+    const float t2 = x[0] - x[32];
+    const float t3 = x[1] - x[33];
+    const float t4 = x[16] + x[48];
+    const float t5 = x[17] + x[49];
+    const float t6 = x[16] - x[48];
+    const float t7 = x[17] - x[49];
+    const float t8 = t0 + t4;
+    const float t9 = t1 + t5;
+    const float t10 = t0 - t4;
+    const float t11 = t1 - t5;
+    const float t12 = t2 + t7;
+    const float t13 = t3 - t6;
+    const float t14 = t2 - t7;
+    const float t15 = t3 + t6;
+    const float t16 = x[8] + x[40];
+    const float t17 = x[9] + x[41];
+    const float t18 = x[8] - x[40];
+    const float t19 = x[9] - x[41];
+    const float t20 = x[24] + x[56];
+    const float t21 = x[25] + x[57];
+    const float t22 = x[24] - x[56];
+    const float t23 = x[25] - x[57];
+    const float t24 = t16 + t20;
+    const float t25 = t17 + t21;
+    const float t26 = t16 - t20;
+    const float t27 = t17 - t21;
+    const float t28 = t18 + t23;
+    const float t29 = t19 - t22;
+    const float t30 = t18 - t23;
+    const float t31 = t19 + t22;
+    const float t32 = t8 + t24;
+    const float t33 = t9 + t25;
+    const float t34 = t8 - t24;
+    const float t35 = t9 - t25;
+    const float t36 = 0.707106781f * (t28 + t29);
+    const float t37 = 0.707106781f * (t29 - t28);
+    const float t38 = t12 + t36;
+    const float t39 = t13 + t37;
+    const float t40 = t12 - t36;
+    const float t41 = t13 - t37;
+    const float t42 = t10 + t27;
+    const float t43 = t11 - t26;
+    const float t44 = t10 - t27;
+    const float t45 = t11 + t26;
+    const float t46 = 0.707106781f * (t31 - t30);
+    const float t47 = -0.707106781f * (t30 + t31);
+    const float t48 = t14 + t46;
+    const float t49 = t15 + t47;
+    const float t50 = t14 - t46;
+    const float t51 = t15 - t47;
+    const float t52 = x[4] + x[36];
+    const float t53 = x[5] + x[37];
+    const float t54 = x[4] - x[36];
+    const float t55 = x[5] - x[37];
+    const float t56 = x[20] + x[52];
+    const float t57 = x[21] + x[53];
+    const float t58 = x[20] - x[52];
+    const float t59 = x[21] - x[53];
+    const float t60 = t52 + t56;
+    const float t61 = t53 + t57;
+    const float t62 = t52 - t56;
+    const float t63 = t53 - t57;
+    const float t64 = t54 + t59;
+    const float t65 = t55 - t58;
+    const float t66 = t54 - t59;
+    const float t67 = t55 + t58;
+    const float t68 = x[12] + x[44];
+    const float t69 = x[13] + x[45];
+    const float t70 = x[12] - x[44];
+    const float t71 = x[13] - x[45];
+    const float t72 = x[28] + x[60];
+    const float t73 = x[29] + x[61];
+    const float t74 = x[28] - x[60];
+    const float t75 = x[29] - x[61];
+    const float t76 = t68 + t72;
+    const float t77 = t69 + t73;
+    const float t78 = t68 - t72;
+    const float t79 = t69 - t73;
+    const float t80 = t70 + t75;
+    const float t81 = t71 - t74;
+    const float t82 = t70 - t75;
+    const float t83 = t71 + t74;
+    const float t84 = t60 + t76;
+    const float t85 = t61 + t77;
+    const float t86 = t60 - t76;
+    const float t87 = t61 - t77;
+    const float t88 = 0.707106781f * (t80 + t81);
+    const float t89 = 0.707106781f * (t81 - t80);
+    const float t90 = t64 + t88;
+    const float t91 = t65 + t89;
+    const float t92 = t64 - t88;
+    const float t93 = t65 - t89;
+    const float t94 = t62 + t79;
+    const float t95 = t63 - t78;
+    const float t96 = t62 - t79;
+    const float t97 = t63 + t78;
+    const float t98 = 0.707106781f * (t83 - t82);
+    const float t99 = -0.707106781f * (t82 + t83);
+    const float t100 = t66 + t98;
+    const float t101 = t67 + t99;
+    const float t102 = t66 - t98;
+    const float t103 = t67 - t99;
+    const float t104 = t32 + t84;
+    const float t105 = t33 + t85;
+    const float t106 = t32 - t84;
+    const float t107 = t33 - t85;
+    const float t108 = t90 * 0.923879533f + t91 * 0.382683432f;
+    const float t109 = t91 * 0.923879533f - t90 * 0.382683432f;
+    const float t110 = t38 + t108;
+    const float t111 = t39 + t109;
+    const float t112 = t38 - t108;
+    const float t113 = t39 - t109;
+    const float t114 = 0.707106781f * (t94 + t95);
+    const float t115 = 0.707106781f * (t95 - t94);
+    const float t116 = t42 + t114;
+    const float t117 = t43 + t115;
+    const float t118 = t42 - t114;
+    const float t119 = t43 - t115;
+    const float t120 = t100 * 0.382683432f + t101 * 0.923879533f;
+    const float t121 = t101 * 0.382683432f - t100 * 0.923879533f;
+    const float t122 = t48 + t120;
+    const float t123 = t49 + t121;
+    const float t124 = t48 - t120;
+    const float t125 = t49 - t121;
+    const float t126 = t34 + t87;
+    const float t127 = t35 - t86;
+    const float t128 = t34 - t87;
+    const float t129 = t35 + t86;
+    const float t130 = t92 * -0.382683432f + t93 * 0.923879533f;
+    const float t131 = t93 * -0.382683432f - t92 * 0.923879533f;
+    const float t132 = t40 + t130;
+    const float t133 = t41 + t131;
+    const float t134 = t40 - t130;
+    const float t135 = t41 - t131;
+    const float t136 = 0.707106781f * (t97 - t96);
+    const float t137 = -0.707106781f * (t96 + t97);
+    const float t138 = t44 + t136;
+    const float t139 = t45 + t137;
+    const float t140 = t44 - t136;
+    const float t141 = t45 - t137;
+    const float t142 = t102 * -0.923879533f + t103 * 0.382683432f;
+    const float t143 = t103 * -0.923879533f - t102 * 0.382683432f;
+    const float t144 = t50 + t142;
+    const float t145 = t51 + t143;
+    const float t146 = t50 - t142;
+    const float t147 = t51 - t143;
+    const float t148 = x[2] + x[34];
+    const float t149 = x[3] + x[35];
+    const float t150 = x[2] - x[34];
+    const float t151 = x[3] - x[35];
+    const float t152 = x[18] + x[50];
+    const float t153 = x[19] + x[51];
+    const float t154 = x[18] - x[50];
+    const float t155 = x[19] - x[51];
+    const float t156 = t148 + t152;
+    const float t157 = t149 + t153;
+    const float t158 = t148 - t152;
+    const float t159 = t149 - t153;
+    const float t160 = t150 + t155;
+    const float t161 = t151 - t154;
+    const float t162 = t150 - t155;
+    const float t163 = t151 + t154;
+    const float t164 = x[10] + x[42];
+    const float t165 = x[11] + x[43];
+    const float t166 = x[10] - x[42];
+    const float t167 = x[11] - x[43];
+    const float t168 = x[26] + x[58];
+    const float t169 = x[27] + x[59];
+    const float t170 = x[26] - x[58];
+    const float t171 = x[27] - x[59];
+    const float t172 = t164 + t168;
+    const float t173 = t165 + t169;
+    const float t174 = t164 - t168;
+    const float t175 = t165 - t169;
+    const float t176 = t166 + t171;
+    const float t177 = t167 - t170;
+    const float t178 = t166 - t171;
+    const float t179 = t167 + t170;
+    const float t180 = t156 + t172;
+    const float t181 = t157 + t173;
+    const float t182 = t156 - t172;
+    const float t183 = t157 - t173;
+    const float t184 = 0.707106781f * (t176 + t177);
+    const float t185 = 0.707106781f * (t177 - t176);
+    const float t186 = t160 + t184;
+    const float t187 = t161 + t185;
+    const float t188 = t160 - t184;
+    const float t189 = t161 - t185;
+    const float t190 = t158 + t175;
+    const float t191 = t159 - t174;
+    const float t192 = t158 - t175;
+    const float t193 = t159 + t174;
+    const float t194 = 0.707106781f * (t179 - t178);
+    const float t195 = -0.707106781f * (t178 + t179);
+    const float t196 = t162 + t194;
+    const float t197 = t163 + t195;
+    const float t198 = t162 - t194;
+    const float t199 = t163 - t195;
+    const float t200 = x[6] + x[38];
+    const float t201 = x[7] + x[39];
+    const float t202 = x[6] - x[38];
+    const float t203 = x[7] - x[39];
+    const float t204 = x[22] + x[54];
+    const float t205 = x[23] + x[55];
+    const float t206 = x[22] - x[54];
+    const float t207 = x[23] - x[55];
+    const float t208 = t200 + t204;
+    const float t209 = t201 + t205;
+    const float t210 = t200 - t204;
+    const float t211 = t201 - t205;
+    const float t212 = t202 + t207;
+    const float t213 = t203 - t206;
+    const float t214 = t202 - t207;
+    const float t215 = t203 + t206;
+    const float t216 = x[14] + x[46];
+    const float t217 = x[15] + x[47];
+    const float t218 = x[14] - x[46];
+    const float t219 = x[15] - x[47];
+    const float t220 = x[30] + x[62];
+    const float t221 = x[31] + x[63];
+    const float t222 = x[30] - x[62];
+    const float t223 = x[31] - x[63];
+    const float t224 = t216 + t220;
+    const float t225 = t217 + t221;
+    const float t226 = t216 - t220;
+    const float t227 = t217 - t221;
+    const float t228 = t218 + t223;
+    const float t229 = t219 - t222;
+    const float t230 = t218 - t223;
+    const float t231 = t219 + t222;
+    const float t232 = t208 + t224;
+    const float t233 = t209 + t225;
+    const float t234 = t208 - t224;
+    const float t235 = t209 - t225;
+    const float t236 = 0.707106781f * (t228 + t229);
+    const float t237 = 0.707106781f * (t229 - t228);
+    const float t238 = t212 + t236;
+    const float t239 = t213 + t237;
+    const float t240 = t212 - t236;
+    const float t241 = t213 - t237;
+    const float t242 = t210 + t227;
+    const float t243 = t211 - t226;
+    const float t244 = t210 - t227;
+    const float t245 = t211 + t226;
+    const float t246 = 0.707106781f * (t231 - t230);
+    const float t247 = -0.707106781f * (t230 + t231);
+    const float t248 = t214 + t246;
+    const float t249 = t215 + t247;
+    const float t250 = t214 - t246;
+    const float t251 = t215 - t247;
+    const float t252 = t180 + t232;
+    const float t253 = t181 + t233;
+    const float t254 = t180 - t232;
+    const float t255 = t181 - t233;
+    const float t256 = t238 * 0.923879533f + t239 * 0.382683432f;
+    const float t257 = t239 * 0.923879533f - t238 * 0.382683432f;
+    const float t258 = t186 + t256;
+    const float t259 = t187 + t257;
+    const float t260 = t186 - t256;
+    const float t261 = t187 - t257;
+    const float t262 = 0.707106781f * (t242 + t243);
+    const float t263 = 0.707106781f * (t243 - t242);
+    const float t264 = t190 + t262;
+    const float t265 = t191 + t263;
+    const float t266 = t190 - t262;
+    const float t267 = t191 - t263;
+    const float t268 = t248 * 0.382683432f + t249 * 0.923879533f;
+    const float t269 = t249 * 0.382683432f - t248 * 0.923879533f;
+    const float t270 = t196 + t268;
+    const float t271 = t197 + t269;
+    const float t272 = t196 - t268;
+    const float t273 = t197 - t269;
+    const float t274 = t182 + t235;
+    const float t275 = t183 - t234;
+    const float t276 = t182 - t235;
+    const float t277 = t183 + t234;
+    const float t278 = t240 * -0.382683432f + t241 * 0.923879533f;
+    const float t279 = t241 * -0.382683432f - t240 * 0.923879533f;
+    const float t280 = t188 + t278;
+    const float t281 = t189 + t279;
+    const float t282 = t188 - t278;
+    const float t283 = t189 - t279;
+    const float t284 = 0.707106781f * (t245 - t244);
+    const float t285 = -0.707106781f * (t244 + t245);
+    const float t286 = t192 + t284;
+    const float t287 = t193 + t285;
+    const float t288 = t192 - t284;
+    const float t289 = t193 - t285;
+    const float t290 = t250 * -0.923879533f + t251 * 0.382683432f;
+    const float t291 = t251 * -0.923879533f - t250 * 0.382683432f;
+    const float t292 = t198 + t290;
+    const float t293 = t199 + t291;
+    const float t294 = t198 - t290;
+    const float t295 = t199 - t291;
+    const float t296 = t104 + t252;
+    const float t297 = t105 + t253;
+    const float t298 = t104 - t252;
+    const float t299 = t105 - t253;
+    const float t300 = t258 * 0.980785280f + t259 * 0.195090322f;
+    const float t301 = t259 * 0.980785280f - t258 * 0.195090322f;
+    const float t302 = t110 + t300;
+    const float t303 = t111 + t301;
+    const float t304 = t110 - t300;
+    const float t305 = t111 - t301;
+    const float t306 = t264 * 0.923879533f + t265 * 0.382683432f;
+    const float t307 = t265 * 0.923879533f - t264 * 0.382683432f;
+    const float t308 = t116 + t306;
+    const float t309 = t117 + t307;
+    const float t310 = t116 - t306;
+    const float t311 = t117 - t307;
+    const float t312 = t270 * 0.831469612f + t271 * 0.555570233f;
+    const float t313 = t271 * 0.831469612f - t270 * 0.555570233f;
+    const float t314 = t122 + t312;
+    const float t315 = t123 + t313;
+    const float t316 = t122 - t312;
+    const float t317 = t123 - t313;
+    const float t318 = 0.707106781f * (t274 + t275);
+    const float t319 = 0.707106781f * (t275 - t274);
+    const float t320 = t126 + t318;
+    const float t321 = t127 + t319;
+    const float t322 = t126 - t318;
+    const float t323 = t127 - t319;
+    const float t324 = t280 * 0.555570233f + t281 * 0.831469612f;
+    const float t325 = t281 * 0.555570233f - t280 * 0.831469612f;
+    const float t326 = t132 + t324;
+    const float t327 = t133 + t325;
+    const float t328 = t132 - t324;
+    const float t329 = t133 - t325;
+    const float t330 = t286 * 0.382683432f + t287 * 0.923879533f;
+    const float t331 = t287 * 0.382683432f - t286 * 0.923879533f;
+    const float t332 = t138 + t330;
+    const float t333 = t139 + t331;
+    const float t334 = t138 - t330;
+    const float t335 = t139 - t331;
+    const float t336 = t292 * 0.195090322f + t293 * 0.980785280f;
+    const float t337 = t293 * 0.195090322f - t292 * 0.980785280f;
+    const float t338 = t144 + t336;
+    const float t339 = t145 + t337;
+    const float t340 = t144 - t336;
+    const float t341 = t145 - t337;
+    const float t342 = t106 + t255;
+    const float t343 = t107 - t254;
+    const float t344 = t106 - t255;
+    const float t345 = t107 + t254;
+    const float t346 = t260 * -0.195090322f + t261 * 0.980785280f;
+    const float t347 = t261 * -0.195090322f - t260 * 0.980785280f;
+    const float t348 = t112 + t346;
+    const float t349 = t113 + t347;
+    const float t350 = t112 - t346;
+    const float t351 = t113 - t347;
+    const float t352 = t266 * -0.382683432f + t267 * 0.923879533f;
+    const float t353 = t267 * -0.382683432f - t266 * 0.923879533f;
+    const float t354 = t118 + t352;
+    const float t355 = t119 + t353;
+    const float t356 = t118 - t352;
+    const float t357 = t119 - t353;
+    const float t358 = t272 * -0.555570233f + t273 * 0.831469612f;
+    const float t359 = t273 * -0.555570233f - t272 * 0.831469612f;
+    const float t360 = t124 + t358;
+    const float t361 = t125 + t359;
+    const float t362 = t124 - t358;
+    const float t363 = t125 - t359;
+    const float t364 = 0.707106781f * (t277 - t276);
+    const float t365 = -0.707106781f * (t276 + t277);
+    const float t366 = t128 + t364;
+    const float t367 = t129 + t365;
+    const float t368 = t128 - t364;
+    const float t369 = t129 - t365;
+    const float t370 = t282 * -0.831469612f + t283 * 0.555570233f;
+    const float t371 = t283 * -0.831469612f - t282 * 0.555570233f;
+    const float t372 = t134 + t370;
+    const float t373 = t135 + t371;
+    const float t374 = t134 - t370;
+    const float t375 = t135 - t371;
+    const float t376 = t288 * -0.923879533f + t289 * 0.382683432f;
+    const float t377 = t289 * -0.923879533f - t288 * 0.382683432f;
+    const float t378 = t140 + t376;
+    const float t379 = t141 + t377;
+    const float t380 = t140 - t376;
+    const float t381 = t141 - t377;
+    const float t382 = t294 * -0.980785280f + t295 * 0.195090322f;
+    const float t383 = t295 * -0.980785280f - t294 * 0.195090322f;
+    const float t384 = t146 + t382;
+    const float t385 = t147 + t383;
+    const float t386 = t146 - t382;
+    const float t387 = t147 - t383;
+
+    xHat[0] = t296;
+    xHat[1] = t297;
+    xHat[2] = t302;
+    xHat[3] = t303;
+    xHat[4] = t308;
+    xHat[5] = t309;
+    xHat[6] = t314;
+    xHat[7] = t315;
+    xHat[8] = t320;
+    xHat[9] = t321;
+    xHat[10] = t326;
+    xHat[11] = t327;
+    xHat[12] = t332;
+    xHat[13] = t333;
+    xHat[14] = t338;
+    xHat[15] = t339;
+    xHat[16] = t342;
+    xHat[17] = t343;
+    xHat[18] = t348;
+    xHat[19] = t349;
+    xHat[20] = t354;
+    xHat[21] = t355;
+    xHat[22] = t360;
+    xHat[23] = t361;
+    xHat[24] = t366;
+    xHat[25] = t367;
+    xHat[26] = t372;
+    xHat[27] = t373;
+    xHat[28] = t378;
+    xHat[29] = t379;
+    xHat[30] = t384;
+    xHat[31] = t385;
+    xHat[32] = t298;
+    xHat[33] = t299;
+    xHat[34] = t304;
+    xHat[35] = t305;
+    xHat[36] = t310;
+    xHat[37] = t311;
+    xHat[38] = t316;
+    xHat[39] = t317;
+    xHat[40] = t322;
+    xHat[41] = t323;
+    xHat[42] = t328;
+    xHat[43] = t329;
+    xHat[44] = t334;
+    xHat[45] = t335;
+    xHat[46] = t340;
+    xHat[47] = t341;
+    xHat[48] = t344;
+    xHat[49] = t345;
+    xHat[50] = t350;
+    xHat[51] = t351;
+    xHat[52] = t356;
+    xHat[53] = t357;
+    xHat[54] = t362;
+    xHat[55] = t363;
+    xHat[56] = t368;
+    xHat[57] = t369;
+    xHat[58] = t374;
+    xHat[59] = t375;
+    xHat[60] = t380;
+    xHat[61] = t381;
+    xHat[62] = t386;
+    xHat[63] = t387;
+
+}
+
+/**
+ * Calculates the 1D fast Fourier transform of an array of n values by the
+ * codelet of that size. Returns 0 on success or 1 if there is none.
+ */
+int _fft1Codelet(const float complex *y, float complex *yHat, int n) {
+    switch (n) {
+        case 2: _fft1Codelet2(y, yHat); return 0;
+        case 4: _fft1Codelet4(y, yHat); return 0;
+        case 8: _fft1Codelet8(y, yHat); return 0;
+        case 16: _fft1Codelet16(y, yHat); return 0;
+        case 32: _fft1Codelet32(y, yHat); return 0;
+        default: return 1;
+    }
+}
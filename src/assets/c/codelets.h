@@ -0,0 +1,11 @@
+#include <complex.h>
+
+#ifndef CODELETS_H
+#define CODELETS_H
+
+// The largest size of the generated codelets, see codelets.js
+#define FFT_CODELET_MAX 32
+
+int _fft1Codelet(const float complex *y, float complex *yHat, int n);
+
+#endif
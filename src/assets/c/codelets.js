@@ -0,0 +1,132 @@
+"use strict";
+
+// Usage: node codelets.js > codelets.c
+// Generates the straight-line codelets of the 1D fast Fourier transform for the sizes 2 to FFT_CODELET_MAX of
+// codelets.h. Each codelet is a fully unrolled decimation in time on real and imaginary values, with the twiddle
+// factors as constants and the trivial ones, i.e. 1, -i and the odd powers of e^(-i pi/4), multiplied out.
+
+const sizes = [2, 4, 8, 16, 32];
+
+/**
+ * Formats a constant as float literal that rounds to the same float.
+ */
+const constant = function(value) {
+    return value.toPrecision(9) + "f";
+}
+
+/**
+ * Emits the butterflies of a transform of the given values, which are pairs of names of real and imaginary parts,
+ * into lines, and returns the names of the transformed values.
+ */
+const transform = function(values, lines, counter) {
+
+    const n = values.length;
+    if (n === 1) return values;
+
+    const even = transform(values.filter(function(value, i) { return i % 2 === 0; }), lines, counter);
+    const odd = transform(values.filter(function(value, i) { return i % 2 === 1; }), lines, counter);
+    const name = function() {
+        return "t" + counter.next++;
+    }
+    const define = function(expression) {
+        const variable = name();
+        lines.push("    const float " + variable + " = " + expression + ";");
+        return variable;
+    }
+
+    const result = new Array(n);
+    for (let k = 0; k < n/2; k++) {
+
+        // Multiply the odd value by e^(-2 pi i k/n)
+        const [re, im] = odd[k];
+        // Multiplying by -i swaps the parts and negates the imaginary one, which is folded into the butterfly
+        let twiddled;
+        let negated = false;
+        if (k === 0) {
+            twiddled = [re, im];
+        } else if (4*k === n) {
+            twiddled = [im, re];
+            negated = true;
+        } else if (8*k === n) {
+            const c = constant(Math.SQRT1_2);
+            twiddled = [define(c + " * (" + re + " + " + im + ")"), define(c + " * (" + im + " - " + re + ")")];
+        } else if (8*k === 3*n) {
+            const c = constant(Math.SQRT1_2);
+            twiddled = [define(c + " * (" + im + " - " + re + ")"), define("-" + c + " * (" + re + " + " + im + ")")];
+        } else {
+            const cos = constant(Math.cos(2*Math.PI*k/n));
+            const sin = constant(Math.sin(2*Math.PI*k/n));
+            twiddled = [define(re + " * " + cos + " + " + im + " * " + sin), define(im + " * " + cos + " - " + re + " * " + sin)];
+        }
+
+        const plus = negated ? " - " : " + ";
+        const minus = negated ? " + " : " - ";
+        result[k] = [define(even[k][0] + " + " + twiddled[0]), define(even[k][1] + plus + twiddled[1])];
+        result[k + n/2] = [define(even[k][0] + " - " + twiddled[0]), define(even[k][1] + minus + twiddled[1])];
+
+    }
+
+    return result;
+
+}
+
+/**
+ * Generates the codelet of size n.
+ */
+const codelet = function(n) {
+
+    const values = [];
+    for (let i = 0; i < n; i++) {
+        values.push(["x[" + 2*i + "]", "x[" + (2*i+1) + "]"]);
+    }
+    const lines = [];
+    const result = transform(values, lines, {next: 0});
+
+    const output = [
+        "/**",
+        " * Calculates the 1D fast Fourier transform of an array of " + n + " values. y and yHat may be the same.",
+        " */",
+        "static void _fft1Codelet" + n + "(const float complex *y, float complex *yHat) {",
+        "",
+        "    const float *x = (const float *) y;",
+        "    float *xHat = (float *) yHat;",
+        ""
+    ].concat(lines, [""]);
+    for (let k = 0; k < n; k++) {
+        output.push("    xHat[" + 2*k + "] = " + result[k][0] + ";");
+        output.push("    xHat[" + (2*k+1) + "] = " + result[k][1] + ";");
+    }
+    output.push("", "}", "");
+    return output.join("\n");
+
+}
+
+const source = [
+    "// Generated by codelets.js, do not edit.",
+    "",
+    "#include <complex.h>",
+    "#include \"codelets.h\"",
+    ""
+];
+for (const n of sizes) {
+    source.push(codelet(n));
+}
+source.push(
+    "/**",
+    " * Calculates the 1D fast Fourier transform of an array of n values by the",
+    " * codelet of that size. Returns 0 on success or 1 if there is none.",
+    " */",
+    "int _fft1Codelet(const float complex *y, float complex *yHat, int n) {",
+    "    switch (n) {"
+);
+for (const n of sizes) {
+    source.push("        case " + n + ": _fft1Codelet" + n + "(y, yHat); return 0;");
+}
+source.push(
+    "        default: return 1;",
+    "    }",
+    "}",
+    ""
+);
+
+process.stdout.write(source.join("\n"));
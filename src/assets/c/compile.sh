@@ -1,6 +1,57 @@
 #!/bin/bash
 
+# Usage: ./compile.sh          builds the variants of main.js and main.wasm with
+#                              Emscripten
+#        ./compile.sh native   builds the native batch program gabor
+#        ./compile.sh benchmark
+#                              builds the native program benchmark, which
+#                              compares the FFT codelets with the FFT before
+#        ./compile.sh library  builds the static library libgabor.a for
+#                              embedding the calculations, see context.h
+#
+# codelets.c is generated by node codelets.js > codelets.c.
+
+if [ "$1" == "native" ]; then
+    cc -O3 -pthread -o gabor native.c video.c pipeline.c queue.c stream.c transform.c batch.c cache.c image.c tuner.c steerable.c recursive.c codelets.c fourier.c gabor.c control.c arena.c pixels.c error.c -lm
+    exit $?
+fi
+
+if [ "$1" == "library" ]; then
+    LIBRARY_FILES=(context.c video.c batch.c transform.c tuner.c steerable.c recursive.c codelets.c fourier.c gabor.c control.c arena.c pixels.c error.c)
+    cc -O3 -pthread -fPIC -c "${LIBRARY_FILES[@]}" || exit $?
+    ar rcs libgabor.a "${LIBRARY_FILES[@]/%.c/.o}"
+    exit $?
+fi
+
+if [ "$1" == "benchmark" ]; then
+    cc -O3 -o benchmark benchmark.c codelets.c fourier.c arena.c error.c -lm
+    exit $?
+fi
+
 # cd /opt/emsdk/
 # source ./emsdk_env.sh
 
-emcc -O3 -s WASM=1 -s "EXPORTED_RUNTIME_METHODS=['ccall']" -s ALLOW_MEMORY_GROWTH=1 -s "EXPORTED_FUNCTIONS=['_malloc', '_free']" -o main.js main.c fourier.c gabor.c
+# Initial size of the linear memory in bytes. The transient buffers of a call
+# live in a single arena, so reserving enough memory up front means that
+# steady-state calls never grow the memory. fgc2 needs about 40 n^2 bytes plus
+# its input and output, e.g. INITIAL_MEMORY=100663296 ./compile.sh covers 1024^2.
+INITIAL_MEMORY=${INITIAL_MEMORY:-16777216}
+
+# The threads of a batch allocate their own arenas, which grows the memory from
+# another thread. The views of the memory used by the workers are only updated
+# when it grows on their own thread, so the threaded build reserves more.
+THREADS_INITIAL_MEMORY=${THREADS_INITIAL_MEMORY:-268435456}
+
+FLAGS=(-O3 -flto -s WASM=1 -s "EXPORTED_RUNTIME_METHODS=['ccall']" -s ALLOW_MEMORY_GROWTH=1 -s "EXPORTED_FUNCTIONS=['_malloc', '_free']")
+FILES=(main.c batch.c transform.c tuner.c steerable.c recursive.c codelets.c fourier.c gabor.c control.c arena.c pixels.c error.c)
+
+# Builds of the same code, from the most compatible to the fastest one. The
+# workers load the fastest one the client supports, see ../js/wasmVariant.js.
+#   main              baseline for every client with WebAssembly
+#   main-simd         simd128 instructions for the pixel kernels and loops
+#   main-simd-threads simd128 and a pool of threads for batches, which needs
+#                     SharedArrayBuffer and thus a cross-origin isolated page
+emcc "${FLAGS[@]}" -s INITIAL_MEMORY=$INITIAL_MEMORY -o main.js "${FILES[@]}" || exit $?
+emcc "${FLAGS[@]}" -msimd128 -s INITIAL_MEMORY=$INITIAL_MEMORY -o main-simd.js "${FILES[@]}" || exit $?
+emcc "${FLAGS[@]}" -msimd128 -pthread -s PTHREAD_POOL_SIZE=navigator.hardwareConcurrency \
+    -s INITIAL_MEMORY=$THREADS_INITIAL_MEMORY -o main-simd-threads.js "${FILES[@]}" || exit $?
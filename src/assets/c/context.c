@@ -0,0 +1,377 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <complex.h>
+#include <pthread.h>
+#include "arena.h"
+#include "context.h"
+#include "control.h"
+#include "error.h"
+#include "gabor.h"
+#include "tuner.h"
+
+/**
+ * A thread of a context with the state it keeps between requests: its arena,
+ * the plans it measured or imported, and the spectra of the filters of its
+ * last request with the Fourier method, if they fit into the cache bytes.
+ */
+struct ContextWorker {
+    Context *context;
+    pthread_t thread;
+    Arena arena;
+    Wisdom wisdom;
+    size_t cacheBytes;
+    float complex *y2Hats;
+    int n;
+    float xi;
+    float sigma;
+    float lambda;
+    float theta;
+    int amount;
+};
+
+/**
+ * Allocates the slots of a ring of at least the given capacity, rounded up to
+ * a power of 2. Slot i starts free for position i. Returns 0 on success.
+ */
+static int _ringOpen(Ring *ring, int capacity) {
+
+    size_t size = 2;
+    while (size < (size_t) capacity) size *= 2;
+
+    ring->slots = aligned_alloc(sizeof(RingSlot), size * sizeof(RingSlot));
+    if (ring->slots == NULL) return 1;
+
+    for (size_t i = 0; i < size; i++) {
+        ring->slots[i] = (RingSlot) {i, NULL};
+    }
+    ring->mask = size - 1;
+    ring->head = 0;
+    ring->tail = 0;
+
+    return 0;
+
+}
+
+/**
+ * Pushes a request. A slot is free for position p once its sequence is p; the
+ * producer that claims p by advancing the head sets it to p + 1, which hands
+ * the slot to the consumer of p. Returns 1 if the ring is full.
+ */
+static int _ringPush(Ring *ring, Request *request) {
+
+    size_t position = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+
+    while (1) {
+        RingSlot *slot = &ring->slots[position & ring->mask];
+        intptr_t difference = (intptr_t) __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - (intptr_t) position;
+        if (difference == 0) {
+            if (__atomic_compare_exchange_n(&ring->head, &position, position + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                slot->request = request;
+                __atomic_store_n(&slot->sequence, position + 1, __ATOMIC_RELEASE);
+                return 0;
+            }
+        } else if (difference < 0) {
+            return 1;
+        } else {
+            position = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        }
+    }
+
+}
+
+/**
+ * Pops a request, the counterpart of _ringPush: the consumer that claims
+ * position p by advancing the tail sets the sequence of its slot to the next
+ * position the slot is free for. Returns NULL if the ring is empty.
+ */
+static Request *_ringPop(Ring *ring) {
+
+    size_t position = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+
+    while (1) {
+        RingSlot *slot = &ring->slots[position & ring->mask];
+        intptr_t difference = (intptr_t) __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - (intptr_t) (position + 1);
+        if (difference == 0) {
+            if (__atomic_compare_exchange_n(&ring->tail, &position, position + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                Request *request = slot->request;
+                __atomic_store_n(&slot->sequence, position + ring->mask + 1, __ATOMIC_RELEASE);
+                return request;
+            }
+        } else if (difference < 0) {
+            return NULL;
+        } else {
+            position = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+}
+
+/**
+ * Keeps the first error message of a request, without the line break.
+ */
+static void _requestError(const char *message, void *data) {
+
+    Request *request = data;
+    if (request->error[0] != '\0') return;
+
+    snprintf(request->error, sizeof(request->error), "%s", message);
+    size_t length = strlen(request->error);
+    if (length > 0 && request->error[length-1] == '\n') request->error[length-1] = '\0';
+
+}
+
+/**
+ * Gets the spectra of the filters of a request from the cache of the worker,
+ * calculating them if its last request had other filters. Returns 1 if they
+ * do not fit into the cache bytes.
+ */
+static int _workerSpectra(ContextWorker *worker, Request *request) {
+
+    int n = request->n;
+    if (worker->y2Hats != NULL && worker->n == n && worker->xi == request->xi && worker->sigma == request->sigma &&
+        worker->lambda == request->lambda && worker->theta == request->theta && worker->amount == request->amount) {
+        return 0;
+    }
+
+    free(worker->y2Hats);
+    worker->y2Hats = NULL;
+
+    size_t size = (size_t) request->amount * n * n * sizeof(float complex);
+    if (size > worker->cacheBytes) return 1;
+    worker->y2Hats = malloc(size);
+    if (worker->y2Hats == NULL || _arenaReserve(&worker->arena, _fgc2FilterSpectrumArenaSize(n))) return 1;
+
+    for (int j = 0; j < request->amount; j++) {
+        _fgc2FilterSpectrum(&worker->y2Hats[(size_t) j * n * n], n, request->xi, request->sigma, request->lambda, request->theta, j, request->amount, &worker->arena);
+    }
+    worker->n = n;
+    worker->xi = request->xi;
+    worker->sigma = request->sigma;
+    worker->lambda = request->lambda;
+    worker->theta = request->theta;
+    worker->amount = request->amount;
+
+    return 0;
+
+}
+
+/**
+ * Calculates a request with the plan of its shape, which the worker measures
+ * on the first request of a shape. Returns 0 on success.
+ */
+static int _workerCalculate(ContextWorker *worker, Request *request) {
+
+    Arena *arena = &worker->arena;
+    int n = request->n;
+
+    if (_arenaReserve(arena, _fgc2TuneArenaSize(n, request->xi, request->sigma))) return 1;
+    Plan plan = _fgc2Tune(&worker->wisdom, request->f, n, request->xi, request->sigma, request->lambda, request->theta, request->amount, arena);
+
+    if (plan.strategy == STRATEGY_FFT && _workerSpectra(worker, request) == 0) {
+        if (_arenaReserve(arena, _fgc2SpectraArenaSize(n))) return 1;
+        _controlBegin(&request->control, 1);
+        _fgc2Spectra(request->f, worker->y2Hats, request->fConv, n, request->amount, NULL, arena);
+        _controlStep(&request->control);
+    } else {
+        if (_arenaReserve(arena, _fgc2PlannedArenaSize(&plan))) return 1;
+        _fgc2Planned(&plan, request->f, request->fConv, n, request->xi, request->sigma, request->lambda, request->theta, request->amount, NULL, &request->control, arena);
+    }
+
+    _arenaReset(arena);
+
+    return _controlCancelled(&request->control);
+
+}
+
+/**
+ * Ends a request: the callback runs first, then the waiting caller is woken.
+ */
+static void _requestFinish(Request *request, int failed) {
+
+    if (request->callback != NULL) request->callback(request, request->data);
+
+    pthread_mutex_lock(&request->lock);
+    __atomic_store_n(&request->status, failed ? REQUEST_FAILED : REQUEST_DONE, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&request->done);
+    pthread_mutex_unlock(&request->lock);
+
+}
+
+/**
+ * Takes the next request of the ring, parking the worker while the ring is
+ * empty. Returns NULL once the context is closing and the ring is drained.
+ */
+static Request *_workerNext(ContextWorker *worker) {
+
+    Context *context = worker->context;
+    Request *request = _ringPop(&context->ring);
+    if (request != NULL) return request;
+
+    // A producer checks for sleeping workers after its push, so either it sees this one or this one sees its request
+    pthread_mutex_lock(&context->lock);
+    __atomic_add_fetch(&context->sleeping, 1, __ATOMIC_SEQ_CST);
+    while ((request = _ringPop(&context->ring)) == NULL && !context->closing) {
+        pthread_cond_wait(&context->wake, &context->lock);
+    }
+    __atomic_sub_fetch(&context->sleeping, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&context->lock);
+
+    return request;
+
+}
+
+/**
+ * Calculates requests until the context is closed. The errors of a request
+ * are kept in the request instead of being printed.
+ */
+static void *_workerRun(void *argument) {
+
+    ContextWorker *worker = argument;
+
+    Request *request;
+    while ((request = _workerNext(worker)) != NULL) {
+        _errorHandle(_requestError, request);
+        int failed = _controlCancelled(&request->control) || _workerCalculate(worker, request);
+        _errorHandle(NULL, NULL);
+        _requestFinish(request, failed);
+    }
+
+    return NULL;
+
+}
+
+/**
+ * Opens a context of the given amount of threads, whose ring holds at least
+ * capacity requests. Each worker keeps the spectra of its last filters if
+ * they need at most cacheBytes, and starts with the plans of the wisdom text,
+ * if not NULL. The context is independent of any other, so that a process may
+ * open one per core or share one between many callers. Returns 0 on success.
+ */
+int _contextOpen(Context *context, int threads, int capacity, size_t cacheBytes, const char *wisdom) {
+
+    *context = (Context) {0};
+    if (threads < 1 || capacity < 1) return 1;
+
+    context->workers = calloc(threads, sizeof(ContextWorker));
+    if (context->workers == NULL || _ringOpen(&context->ring, capacity)) {
+        free(context->workers);
+        return 1;
+    }
+    pthread_mutex_init(&context->lock, NULL);
+    pthread_cond_init(&context->wake, NULL);
+
+    for (int t = 0; t < threads; t++) {
+        ContextWorker *worker = &context->workers[t];
+        worker->context = context;
+        worker->cacheBytes = cacheBytes;
+        if (wisdom != NULL) _wisdomImport(&worker->wisdom, wisdom);
+        if (pthread_create(&worker->thread, NULL, _workerRun, worker) != 0) break;
+        context->threads++;
+    }
+
+    if (context->threads == 0) {
+        _contextClose(context);
+        return 1;
+    }
+
+    return 0;
+
+}
+
+/**
+ * Submits a request without blocking. The request is calculated by the next
+ * free worker, and the caller waits for it with _contextWait. Returns 0 if it
+ * is queued, CONTEXT_FULL if the ring is full, so that the caller may wait for
+ * an earlier request and submit it again, or CONTEXT_INVALID with the reason
+ * in its error if its params are invalid; requests that are not queued must
+ * not be waited for.
+ */
+int _contextSubmit(Context *context, Request *request) {
+
+    request->status = REQUEST_PENDING;
+    request->error[0] = '\0';
+
+    int n = request->n;
+    if (request->f == NULL || request->fConv == NULL || n < 2 || (n & (n-1)) || request->amount < 1 || !(request->sigma > 0)) {
+        snprintf(request->error, sizeof(request->error), "Error in context: Request must be of size n = 2^k with at least one orientation.");
+        return CONTEXT_INVALID;
+    }
+
+    pthread_mutex_init(&request->lock, NULL);
+    pthread_cond_init(&request->done, NULL);
+
+    if (_ringPush(&context->ring, request)) {
+        pthread_mutex_destroy(&request->lock);
+        pthread_cond_destroy(&request->done);
+        return CONTEXT_FULL;
+    }
+
+    // Only idle workers need the lock to be woken
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&context->sleeping, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&context->lock);
+        pthread_cond_signal(&context->wake);
+        pthread_mutex_unlock(&context->lock);
+    }
+
+    return 0;
+
+}
+
+/**
+ * Gets the status of a queued request without blocking.
+ */
+int _contextPoll(Request *request) {
+    return __atomic_load_n(&request->status, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Waits for a queued request, which must be waited for exactly once, also if
+ * it has a callback. Returns 0 if it is done, or 1 if it has failed or was
+ * cancelled, with the first error message in its error, if any.
+ */
+int _contextWait(Request *request) {
+
+    pthread_mutex_lock(&request->lock);
+    while (request->status == REQUEST_PENDING) {
+        pthread_cond_wait(&request->done, &request->lock);
+    }
+    pthread_mutex_unlock(&request->lock);
+
+    pthread_mutex_destroy(&request->lock);
+    pthread_cond_destroy(&request->done);
+
+    return request->status != REQUEST_DONE;
+
+}
+
+/**
+ * Closes a context once the queued requests are calculated and frees it.
+ * Requests to be dropped instead are to be cancelled before. No request may be
+ * submitted meanwhile.
+ */
+void _contextClose(Context *context) {
+
+    if (context->workers == NULL) return;
+
+    pthread_mutex_lock(&context->lock);
+    context->closing = 1;
+    pthread_cond_broadcast(&context->wake);
+    pthread_mutex_unlock(&context->lock);
+
+    for (int t = 0; t < context->threads; t++) {
+        ContextWorker *worker = &context->workers[t];
+        pthread_join(worker->thread, NULL);
+        _arenaDestroy(&worker->arena);
+        free(worker->y2Hats);
+    }
+
+    pthread_mutex_destroy(&context->lock);
+    pthread_cond_destroy(&context->wake);
+    free(context->ring.slots);
+    free(context->workers);
+    *context = (Context) {0};
+
+}
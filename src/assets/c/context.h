@@ -0,0 +1,103 @@
+#include <stddef.h>
+#include <pthread.h>
+#include "control.h"
+
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REQUEST_PENDING 0
+#define REQUEST_DONE 1
+#define REQUEST_FAILED 2
+
+#define CONTEXT_FULL 1
+#define CONTEXT_INVALID 2
+
+typedef struct Request Request;
+
+/**
+ * Called on the worker thread once a request is calculated or has failed,
+ * before _contextWait returns for it.
+ */
+typedef void (*RequestCallback)(Request *request, void *data);
+
+/**
+ * A 2D fast Gabor convolution of f into fConv, both n*n, submitted to a
+ * context. The request is its own future: its status turns from pending to
+ * done or failed, and the caller waits for it with _contextWait. The control
+ * counts the orientations and cancels the request, also while it is queued.
+ * The caller owns the request and its buffers, which must stay valid until
+ * _contextWait returns. The fields after data are set by _contextSubmit.
+ */
+struct Request {
+    float *f;
+    float *fConv;
+    int n;
+    float xi;
+    float sigma;
+    float lambda;
+    float theta;
+    int amount;
+    RequestCallback callback;
+    void *data;
+    Control control;
+    int status;
+    char error[128];
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+};
+
+/**
+ * A slot of the ring of a context. Its sequence tells whether it is free for
+ * the producer or holds a request for the consumer of a given position, see
+ * _ringPush. Each slot has a cache line of its own.
+ */
+typedef struct RingSlot {
+    size_t sequence;
+    Request *request;
+} __attribute__((aligned(64))) RingSlot;
+
+/**
+ * A bounded queue of requests for any number of producers and consumers,
+ * which claim positions by compare-and-swap instead of taking a lock. The
+ * positions only grow and are mapped onto the slots by the mask.
+ */
+typedef struct Ring {
+    RingSlot *slots;
+    size_t mask;
+    size_t head __attribute__((aligned(64)));
+    size_t tail __attribute__((aligned(64)));
+} Ring;
+
+typedef struct ContextWorker ContextWorker;
+
+/**
+ * A pool of threads calculating the requests of a ring. Each worker owns its
+ * arena, its plans and the spectra of its last filters, so that the contexts
+ * and the workers of a context share no state besides the ring. The lock is
+ * only taken to park workers that found the ring empty and to wake them.
+ */
+typedef struct Context {
+    Ring ring;
+    ContextWorker *workers;
+    int threads;
+    int sleeping;
+    int closing;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+} Context;
+
+int _contextOpen(Context *context, int threads, int capacity, size_t cacheBytes, const char *wisdom);
+int _contextSubmit(Context *context, Request *request);
+int _contextPoll(Request *request);
+int _contextWait(Request *request);
+void _contextClose(Context *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,29 @@
+#include <stddef.h>
+#include "control.h"
+
+/**
+ * Starts a calculation of total steps. The cancel flag is kept, so that a
+ * calculation that was cancelled before it began stops at its first step.
+ */
+void _controlBegin(Control *control, int total) {
+    if (control == NULL) return;
+    __atomic_store_n(&control->total, total, __ATOMIC_RELEASE);
+    __atomic_store_n(&control->done, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * Counts one step as done, which is a safe point to stop. Returns 1 if the
+ * calculation is cancelled.
+ */
+int _controlStep(Control *control) {
+    if (control == NULL) return 0;
+    __atomic_add_fetch(&control->done, 1, __ATOMIC_ACQ_REL);
+    return _controlCancelled(control);
+}
+
+/**
+ * Checks if the calculation is cancelled.
+ */
+int _controlCancelled(Control *control) {
+    return control != NULL && __atomic_load_n(&control->cancel, __ATOMIC_ACQUIRE) != 0;
+}
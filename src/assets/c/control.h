@@ -0,0 +1,21 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+/**
+ * The control block of a calculation, which the caller may share with other
+ * threads: the calculation counts the steps done out of the total, and stops
+ * at the next safe point once cancel is set. The layout matches an
+ * Int32Array of [done, total, cancel], so that JavaScript can read and write
+ * it in shared memory without messaging. All functions accept NULL.
+ */
+typedef struct Control {
+    int done;
+    int total;
+    int cancel;
+} Control;
+
+void _controlBegin(Control *control, int total);
+int _controlStep(Control *control);
+int _controlCancelled(Control *control);
+
+#endif
@@ -0,0 +1,40 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include "error.h"
+
+/**
+ * Handler of the error messages of each thread, or NULL for stdout.
+ */
+static _Thread_local ErrorHandler threadHandler = NULL;
+static _Thread_local void *threadData = NULL;
+
+/**
+ * Reports an error like printf. The message goes to the handler of the
+ * calling thread, if any, or to stdout otherwise.
+ */
+void _error(const char *format, ...) {
+
+    va_list arguments;
+    va_start(arguments, format);
+
+    if (threadHandler == NULL) {
+        vprintf(format, arguments);
+    } else {
+        char message[256];
+        vsnprintf(message, sizeof(message), format, arguments);
+        threadHandler(message, threadData);
+    }
+
+    va_end(arguments);
+
+}
+
+/**
+ * Sets the handler of the error messages of the calling thread, or NULL to
+ * print them to stdout again. Other threads are not affected, so that a
+ * library that embeds the calculations can keep their errors apart.
+ */
+void _errorHandle(ErrorHandler handler, void *data) {
+    threadHandler = handler;
+    threadData = data;
+}
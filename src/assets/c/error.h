@@ -0,0 +1,13 @@
+#ifndef ERROR_H
+#define ERROR_H
+
+/**
+ * Receives the error messages of a thread instead of stdout, see
+ * _errorHandle. The message is only valid during the call.
+ */
+typedef void (*ErrorHandler)(const char *message, void *data);
+
+void _error(const char *format, ...);
+void _errorHandle(ErrorHandler handler, void *data);
+
+#endif
@@ -2,6 +2,8 @@
 #import <stdlib.h>
 #include <complex.h>
 #include <math.h>
+#include "codelets.h"
+#include "error.h"
 #include "fourier.h"
 
 /**
@@ -41,13 +43,24 @@ void _setRow(float complex *y, float complex *row, int i, int n) {
 }
 
 /**
- * Calculates the 1D fast Fourier transform of an array.
+ * Calculates the 1D fast Fourier transform of an array. Sizes up to
+ * FFT_CODELET_MAX are calculated by a codelet, larger ones are split until the
+ * halves are.
  */
-void _fft1(float complex *y, float complex *yHat, int n) {
+void _fft1(float complex *y, float complex *yHat, int n, Arena *arena) {
+    _fft1Leaf(y, yHat, n, FFT_CODELET_MAX, arena);
+}
+
+/**
+ * Calculates the 1D fast Fourier transform of an array by splitting it into
+ * halves until they are of size leaf or less, which are calculated by a
+ * codelet. With a leaf of 1, it is split down to single values instead.
+ */
+void _fft1Leaf(float complex *y, float complex *yHat, int n, int leaf, Arena *arena) {
 
     // Check if number is > 1 and power of 2
     if (n < 2 || (n & (n-1))) {
-        printf("Error in FFT: Input vector must be of size n.\n");
+        _error("Error in FFT: Input vector must be of size n.\n");
         return;
     }
 
@@ -58,30 +71,35 @@ void _fft1(float complex *y, float complex *yHat, int n) {
         return;
     }
 
+    // Use the unrolled transform for small sizes
+    if (n <= leaf && _fft1Codelet(y, yHat, n) == 0) return;
+
     // Halve the value of n
     n = n/2;
 
     // Setup even and odd arrays
-    float complex *yEven = malloc(n * sizeof(float complex));
-    float complex *yOdd = malloc(n * sizeof(float complex));
+    size_t mark = _arenaMark(arena);
+    float complex *yEven = _arenaAlloc(arena, n * sizeof(float complex));
+    float complex *yOdd = _arenaAlloc(arena, n * sizeof(float complex));
     for (int i = 0; i < n; i++) {
         yEven[i] = y[2*i];
         yOdd[i] = y[2*i+1];
     }
 
     // Calculate c, d
-    float complex *c = malloc(n * sizeof(float complex));
-    _fft1(yEven, c, n);
-    free(yEven);
+    float complex *c = _arenaAlloc(arena, n * sizeof(float complex));
+    _fft1Leaf(yEven, c, n, leaf, arena);
 
-    float complex *d = malloc(n * sizeof(float complex));
-    _fft1(yOdd, d, n);
-    free(yOdd);
+    float complex *d = _arenaAlloc(arena, n * sizeof(float complex));
+    _fft1Leaf(yOdd, d, n, leaf, arena);
 
-    // Correct d value
-    float pi = acos(-1.0);
+    // Correct d value, with the twiddle factors by recurrence in double precision rather than by cexp each
+    double pi = acos(-1.0);
+    double complex twiddle = 1;
+    double complex step = cexp(-1.0*I*pi/n);
     for (int i = 0; i < n; i++) {
-        d[i] = cexp(-1.0*I*pi*i/n)*d[i];
+        d[i] = (float complex) twiddle * d[i];
+        twiddle *= step;
     }
 
     // Combine the values again
@@ -92,15 +110,74 @@ void _fft1(float complex *y, float complex *yHat, int n) {
             yHat[i] = c[i-n]-d[i-n];
         }
     }
-    free(c);
-    free(d);
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Calculates the 1D fast Fourier transform of an array of which only the first
+ * m values are not zero. As long as the zeros fill at least the second half,
+ * the first butterflies of a decimation in frequency are trivial and both
+ * halves of the spectrum are transforms of size n/2 with m values not zero.
+ * y must hold n values, the values m to n-1 are overwritten with zeros.
+ */
+void _fft1Pruned(float complex *y, float complex *yHat, int n, int m, Arena *arena) {
+
+    // Check if number is > 1 and power of 2
+    if (n < 2 || (n & (n-1))) {
+        _error("Error in FFT: Input vector must be of size n.\n");
+        return;
+    }
+
+    // A single value is constant in Fourier space
+    if (m <= 1) {
+        for (int i = 0; i < n; i++) {
+            yHat[i] = m == 1 ? y[0] : 0;
+        }
+        return;
+    }
+
+    // Otherwise fall back to the full transform
+    if (m > n/2) {
+        for (int i = m; i < n; i++) {
+            y[i] = 0;
+        }
+        _fft1(y, yHat, n, arena);
+        return;
+    }
+
+    // Halve the value of n
+    n = n/2;
+
+    // Setup the halves of the butterflies, the second half of y is zero
+    size_t mark = _arenaMark(arena);
+    float complex *ySum = _arenaAlloc(arena, n * sizeof(float complex));
+    float complex *yDiff = _arenaAlloc(arena, n * sizeof(float complex));
+    float pi = acos(-1.0);
+    for (int i = 0; i < m; i++) {
+        ySum[i] = y[i];
+        yDiff[i] = cexp(-1.0*I*pi*i/n)*y[i];
+    }
+
+    // Calculate the even and odd values
+    float complex *c = _arenaAlloc(arena, n * sizeof(float complex));
+    _fft1Pruned(ySum, c, n, m, arena);
+
+    float complex *d = _arenaAlloc(arena, n * sizeof(float complex));
+    _fft1Pruned(yDiff, d, n, m, arena);
+
+    for (int i = 0; i < n; i++) {
+        yHat[2*i] = c[i];
+        yHat[2*i+1] = d[i];
+    }
+    _arenaRelease(arena, mark);
 
 }
 
 /**
  * Calculates the 1D inverse fast Fourier transform of an array.
  */
-void _ifft1(float complex *yHat, float complex *y, int n) {
+void _ifft1(float complex *yHat, float complex *y, int n, Arena *arena) {
 
     // Conjugate the whole array
     for (int i = 0; i < n; i++) {
@@ -108,7 +185,7 @@ void _ifft1(float complex *yHat, float complex *y, int n) {
     }
 
     // Calculate the FFT
-    _fft1(yHat, y, n);
+    _fft1(yHat, y, n, arena);
 
     // Conjugate the result
     float h = 1.0/n;
@@ -122,72 +199,142 @@ void _ifft1(float complex *yHat, float complex *y, int n) {
 /**
  * Calculates the 1D convolution of two arrays.
  */
-void _conv1(float complex *y1, float complex *y2, float complex *yConv, int n) {
+void _conv1(float complex *y1, float complex *y2, float complex *yConv, int n, Arena *arena) {
 
     // Calculate the FFT of both vectors
-    float complex *y1Hat = malloc(n * sizeof(float complex));
-    float complex *y2Hat = malloc(n * sizeof(float complex));
+    size_t mark = _arenaMark(arena);
+    float complex *y1Hat = _arenaAlloc(arena, n * sizeof(float complex));
+    float complex *y2Hat = _arenaAlloc(arena, n * sizeof(float complex));
 
-    _fft1(y1, y1Hat, n);
-    _fft1(y2, y2Hat, n);
+    _fft1(y1, y1Hat, n, arena);
+    _fft1(y2, y2Hat, n, arena);
 
     // Multiply in FFT space
-    float complex *yConvHat = malloc(n * sizeof(float complex));
     for (int i = 0; i < n; i++) {
-        yConvHat[i] = y1Hat[i] * y2Hat[i];
+        y1Hat[i] = y1Hat[i] * y2Hat[i];
     }
 
-    free(y1Hat);
-    free(y2Hat);
-
     // Transform back
-    _ifft1(yConvHat, yConv, n);
+    _ifft1(y1Hat, yConv, n, arena);
 
-    free(yConvHat);
+    _arenaRelease(arena, mark);
 
 }
 
 /**
  * Calculates the 2D fast Fourier transform of an array representing a matrix.
  */
-void _fft2(float complex *y, float complex *yHat, int n) {
+void _fft2(float complex *y, float complex *yHat, int n, Arena *arena) {
 
     // Check if number is > 1 and power of 2
     if (n < 2 || (n & (n-1))) {
-        printf("Error in FFT: Input matrix must be of size n*n.\n");
+        _error("Error in FFT: Input matrix must be of size n*n.\n");
         return;
     }
 
+    size_t mark = _arenaMark(arena);
+    float complex *yHatTemp = _arenaAlloc(arena, n * n * sizeof(float complex));
+    float complex *t = _arenaAlloc(arena, n * sizeof(float complex));
+    float complex *tHat = _arenaAlloc(arena, n * sizeof(float complex));
+
     // Go through each row
-    float complex *yHatTemp = malloc(n * n * sizeof(float complex));
     for (int k = 0; k < n; k++) {
-        float complex *t = malloc(n * sizeof(float complex));
-        float complex *tHat = malloc(n * sizeof(float complex));
         _getRow(y, t, k, n);
-        _fft1(&t[0], tHat, n);
-        free(t);
+        _fft1(t, tHat, n, arena);
         _setRow(yHatTemp, tHat, k, n);
-        free(tHat);
     }
 
     // Go through each col now
     for (int k = 0; k < n; k++) {
-        float complex *t = malloc(n * sizeof(float complex));
-        float complex *tHat = malloc(n * sizeof(float complex));
         _getColumn(yHatTemp, t, k, n);
-        _fft1(t, tHat, n);
-        free(t);
+        _fft1(t, tHat, n, arena);
         _setColumn(yHat, tHat, k, n);
-        free(tHat);
     }
-    free(yHatTemp);
+
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Calculates the 2D fast Fourier transform of an array representing a matrix
+ * in place. Unlike _fft2, no second matrix is needed, only two vectors of size
+ * n for the row or column at hand.
+ */
+void _fft2InPlace(float complex *y, int n, Arena *arena) {
+
+    // Check if number is > 1 and power of 2
+    if (n < 2 || (n & (n-1))) {
+        _error("Error in FFT: Input matrix must be of size n*n.\n");
+        return;
+    }
+
+    size_t mark = _arenaMark(arena);
+    float complex *t = _arenaAlloc(arena, n * sizeof(float complex));
+    float complex *tHat = _arenaAlloc(arena, n * sizeof(float complex));
+
+    // Go through each row
+    for (int k = 0; k < n; k++) {
+        _getRow(y, t, k, n);
+        _fft1(t, tHat, n, arena);
+        _setRow(y, tHat, k, n);
+    }
+
+    // Go through each col now
+    for (int k = 0; k < n; k++) {
+        _getColumn(y, t, k, n);
+        _fft1(t, tHat, n, arena);
+        _setColumn(y, tHat, k, n);
+    }
+
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Calculates the 2D fast Fourier transform of real values of width*height,
+ * with rows of length width, zero-padded to a matrix of size n*n. The zero
+ * rows are skipped and the transforms of the rows and columns are pruned to
+ * the values that are not zero.
+ */
+void _fft2Padded(float *y, int width, int height, float complex *yHat, int n, Arena *arena) {
+
+    // Check if number is > 1 and power of 2
+    if (n < 2 || (n & (n-1)) || width > n || height > n) {
+        _error("Error in FFT: Input matrix must fit into size n*n.\n");
+        return;
+    }
+
+    size_t mark = _arenaMark(arena);
+    float complex *yHatTemp = _arenaAlloc(arena, n * n * sizeof(float complex));
+    float complex *t = _arenaAlloc(arena, n * sizeof(float complex));
+    float complex *tHat = _arenaAlloc(arena, n * sizeof(float complex));
+
+    // Go through each row with values
+    for (int k = 0; k < height; k++) {
+        for (int j = 0; j < width; j++) {
+            t[j] = y[k*width+j];
+        }
+        _fft1Pruned(t, tHat, n, width, arena);
+        _setRow(yHatTemp, tHat, k, n);
+    }
+
+    // Go through each col now, of which only the first height values are not zero
+    for (int k = 0; k < n; k++) {
+        for (int i = 0; i < height; i++) {
+            t[i] = yHatTemp[i*n+k];
+        }
+        _fft1Pruned(t, tHat, n, height, arena);
+        _setColumn(yHat, tHat, k, n);
+    }
+
+    _arenaRelease(arena, mark);
 
 }
 
 /**
  * Calculates the 2D inverse fast Fourier transform of an array representing a matrix.
  */
-void _ifft2(float complex *yHat, float complex *y, int n) {
+void _ifft2(float complex *yHat, float complex *y, int n, Arena *arena) {
 
     // Conjugate the whole array
     for (int i = 0; i < n*n; i++) {
@@ -195,7 +342,7 @@ void _ifft2(float complex *yHat, float complex *y, int n) {
     }
 
     // Calculate the FFT
-    _fft2(yHat, y, n);
+    _fft2(yHat, y, n, arena);
 
     // Conjugate the result
     float h = 1.0/(n*n);
@@ -205,31 +352,96 @@ void _ifft2(float complex *yHat, float complex *y, int n) {
 
 }
 
+/**
+ * Calculates the 2D inverse fast Fourier transform of an array representing a
+ * matrix in place, see _fft2InPlace.
+ */
+void _ifft2InPlace(float complex *y, int n, Arena *arena) {
+
+    // Conjugate the whole array
+    for (int i = 0; i < n*n; i++) {
+        y[i] = conjf(y[i]);
+    }
+
+    // Calculate the FFT
+    _fft2InPlace(y, n, arena);
+
+    // Conjugate the result
+    float h = 1.0/(n*n);
+    for (int i = 0; i < n*n; i++) {
+        y[i] = h * conjf(y[i]);
+    }
+
+}
+
+/**
+ * Calculates the values of the 2D inverse fast Fourier transform in a region of
+ * w*h values starting at column x0 and row y0, wrapping around the edges, and
+ * saves them into y with rows of length w. After the rows, only the w columns
+ * of the region are transformed, and yHat is left unchanged.
+ */
+void _ifft2Region(float complex *yHat, float complex *y, int n, int x0, int y0, int w, int h, Arena *arena) {
+
+    // Check if number is > 1 and power of 2
+    if (n < 2 || (n & (n-1))) {
+        _error("Error in FFT: Input matrix must be of size n*n.\n");
+        return;
+    }
+
+    size_t mark = _arenaMark(arena);
+    float complex *yTemp = _arenaAlloc(arena, n * w * sizeof(float complex));
+    float complex *t = _arenaAlloc(arena, n * sizeof(float complex));
+    float complex *tHat = _arenaAlloc(arena, n * sizeof(float complex));
+
+    // Go through each row, conjugated, and keep the columns of the region
+    for (int k = 0; k < n; k++) {
+        for (int j = 0; j < n; j++) {
+            t[j] = conjf(yHat[k*n+j]);
+        }
+        _fft1(t, tHat, n, arena);
+        for (int c = 0; c < w; c++) {
+            yTemp[k*w+c] = tHat[(x0+c) & (n-1)];
+        }
+    }
+
+    // Go through the cols of the region and keep its rows, conjugated again
+    float scale = 1.0/(n*n);
+    for (int c = 0; c < w; c++) {
+        for (int k = 0; k < n; k++) {
+            t[k] = yTemp[k*w+c];
+        }
+        _fft1(t, tHat, n, arena);
+        for (int r = 0; r < h; r++) {
+            y[r*w+c] = scale * conjf(tHat[(y0+r) & (n-1)]);
+        }
+    }
+
+    _arenaRelease(arena, mark);
+
+}
+
 /**
  * Calculates the 2D convolution of two arrays representing a matrix.
  */
-void _conv2(float complex *y1, float complex *y2, float complex *yConv, int n) {
+void _conv2(float complex *y1, float complex *y2, float complex *yConv, int n, Arena *arena) {
 
     // Calculate the FFT of both vectors
-    float complex *y1Hat = malloc(n * n * sizeof(float complex));
-    float complex *y2Hat = malloc(n * n * sizeof(float complex));
+    size_t mark = _arenaMark(arena);
+    float complex *y1Hat = _arenaAlloc(arena, n * n * sizeof(float complex));
+    float complex *y2Hat = _arenaAlloc(arena, n * n * sizeof(float complex));
 
-    _fft2(y1, y1Hat, n);
-    _fft2(y2, y2Hat, n);
+    _fft2(y1, y1Hat, n, arena);
+    _fft2(y2, y2Hat, n, arena);
 
     // Multiply in FFT space
-    float complex *yConvHat = malloc(n * n * sizeof(float complex));
     for (int i = 0; i < n*n; i++) {
-        yConvHat[i] = y1Hat[i] * y2Hat[i];
+        y1Hat[i] = y1Hat[i] * y2Hat[i];
     }
 
-    free(y1Hat);
-    free(y2Hat);
-
     // Transform back
-    _ifft2(yConvHat, yConv, n);
+    _ifft2(y1Hat, yConv, n, arena);
 
-    free(yConvHat);
+    _arenaRelease(arena, mark);
 
 }
 
@@ -237,24 +449,85 @@ void _conv2(float complex *y1, float complex *y2, float complex *yConv, int n) {
  * Calculates the 2D convolution of two arrays representing a matrix,
  * where the second array already is in Fourier space.
  */
-void _conv2Hat(float complex *y1, float complex *y2Hat, float complex *yConv, int n) {
+void _conv2Hat(float complex *y1, float complex *y2Hat, float complex *yConv, int n, Arena *arena) {
 
     // Calculate the FFT of the first vector
-    float complex *y1Hat = malloc(n * n * sizeof(float complex));
+    size_t mark = _arenaMark(arena);
+    float complex *y1Hat = _arenaAlloc(arena, n * n * sizeof(float complex));
 
-    _fft2(y1, y1Hat, n);
+    _fft2(y1, y1Hat, n, arena);
 
     // Multiply in FFT space
-    float complex *yConvHat = malloc(n * n * sizeof(float complex));
     for (int i = 0; i < n*n; i++) {
-        yConvHat[i] = y1Hat[i] * y2Hat[i];
+        y1Hat[i] = y1Hat[i] * y2Hat[i];
     }
 
-    free(y1Hat);
-
     // Transform back
-    _ifft2(yConvHat, yConv, n);
+    _ifft2(y1Hat, yConv, n, arena);
+
+    _arenaRelease(arena, mark);
+
+}
 
-    free(yConvHat);
+/////////////////
+// ARENA SIZES //
+/////////////////
+
+/**
+ * Gets the arena bytes needed by _fft1 and _ifft1 for vectors of size n.
+ */
+size_t _fft1ArenaSize(int n) {
+    size_t size = 0;
+    for (int m = n/2; m >= 2; m /= 2) {
+        size += 4 * _arenaSize(m * sizeof(float complex));
+    }
+    return size;
+}
+
+/**
+ * Gets the arena bytes needed by _conv1 for vectors of size n.
+ */
+size_t _conv1ArenaSize(int n) {
+    return 2 * _arenaSize(n * sizeof(float complex)) + _fft1ArenaSize(n);
+}
 
+/**
+ * Gets the arena bytes needed by _fft2 and _ifft2 for matrices of size n*n.
+ */
+size_t _fft2ArenaSize(int n) {
+    return _arenaSize((size_t) n * n * sizeof(float complex))
+        + 2 * _arenaSize(n * sizeof(float complex))
+        + _fft1ArenaSize(n);
+}
+
+/**
+ * Gets the arena bytes needed by _fft2InPlace and _ifft2InPlace for matrices
+ * of size n*n.
+ */
+size_t _fft2InPlaceArenaSize(int n) {
+    return 2 * _arenaSize(n * sizeof(float complex)) + _fft1ArenaSize(n);
+}
+
+/**
+ * Gets the arena bytes needed by _ifft2Region for matrices of size n*n and a
+ * region of width w.
+ */
+size_t _ifft2RegionArenaSize(int n, int w) {
+    return _arenaSize((size_t) n * w * sizeof(float complex))
+        + 2 * _arenaSize(n * sizeof(float complex))
+        + _fft1ArenaSize(n);
+}
+
+/**
+ * Gets the arena bytes needed by _conv2 for matrices of size n*n.
+ */
+size_t _conv2ArenaSize(int n) {
+    return 2 * _arenaSize((size_t) n * n * sizeof(float complex)) + _fft2ArenaSize(n);
+}
+
+/**
+ * Gets the arena bytes needed by _conv2Hat for matrices of size n*n.
+ */
+size_t _conv2HatArenaSize(int n) {
+    return _arenaSize((size_t) n * n * sizeof(float complex)) + _fft2ArenaSize(n);
 }
@@ -1,9 +1,24 @@
 #include <complex.h>
+#include "arena.h"
 
-void _fft1(float complex *y, float complex *yHat, int n);
-void _ifft1(float complex *yHat, float complex *y, int n);
-void _conv1(float complex *y1, float complex *y2, float complex *yConv, int n);
-void _fft2(float complex *y, float complex *yTranspose, int n);
-void _ifft2(float complex *yHat, float complex *y, int n);
-void _conv2(float complex *y1, float complex *y2, float complex *yConv, int n);
-void _conv2Hat(float complex *y1, float complex *y2Hat, float complex *yConv, int n);
+void _fft1(float complex *y, float complex *yHat, int n, Arena *arena);
+void _fft1Leaf(float complex *y, float complex *yHat, int n, int leaf, Arena *arena);
+void _fft1Pruned(float complex *y, float complex *yHat, int n, int m, Arena *arena);
+void _ifft1(float complex *yHat, float complex *y, int n, Arena *arena);
+void _conv1(float complex *y1, float complex *y2, float complex *yConv, int n, Arena *arena);
+void _fft2(float complex *y, float complex *yTranspose, int n, Arena *arena);
+void _fft2InPlace(float complex *y, int n, Arena *arena);
+void _fft2Padded(float *y, int width, int height, float complex *yHat, int n, Arena *arena);
+void _ifft2(float complex *yHat, float complex *y, int n, Arena *arena);
+void _ifft2InPlace(float complex *y, int n, Arena *arena);
+void _ifft2Region(float complex *yHat, float complex *y, int n, int x0, int y0, int w, int h, Arena *arena);
+void _conv2(float complex *y1, float complex *y2, float complex *yConv, int n, Arena *arena);
+void _conv2Hat(float complex *y1, float complex *y2Hat, float complex *yConv, int n, Arena *arena);
+
+size_t _fft1ArenaSize(int n);
+size_t _conv1ArenaSize(int n);
+size_t _fft2ArenaSize(int n);
+size_t _fft2InPlaceArenaSize(int n);
+size_t _ifft2RegionArenaSize(int n, int w);
+size_t _conv2ArenaSize(int n);
+size_t _conv2HatArenaSize(int n);
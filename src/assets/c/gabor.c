@@ -2,8 +2,12 @@
 #import <stdlib.h>
 #include <complex.h>
 #include <math.h>
+#include "arena.h"
+#include "control.h"
+#include "error.h"
 #include "fourier.h"
 #include "gabor.h"
+#include "pixels.h"
 
 /**
  * Generates a 2D Gabor filter and saves the result into gw.
@@ -23,34 +27,47 @@ void _filter2(float complex *gw, int n, float xi, float sigma, float lambda, flo
 }
 
 /**
- * Generates a 2D Gabor filter that is normalized and saves the result into gw.
+ * Generates a 2D Gabor filter on a window of (2*radius+1)^2 points around its
+ * center and saves the result into gw.
  */
-void _normalizedFilter2(float complex *gw, int n, float xi, float sigma, float lambda, float theta) {
+void _filterWindow2(float complex *gw, int radius, float xi, float sigma, float lambda, float theta) {
 
-    // Generate the filter
-    _filter2(gw, n, xi, sigma, lambda, theta);
+    float pi = acos(-1.0);
+    int w = 2*radius+1;
 
-    // Now normalize the real and imaginary values
+    for (int y = 0; y < w; y++) {
+        for (int x = 0; x < w; x++) {
+            float xs = + (x-radius)*cos(theta) + (y-radius)*sin(theta);
+            float ys = - (x-radius)*sin(theta) + (y-radius)*cos(theta);
+            gw[y*w+x] = cexp(-(xs*xs+xi*xi*ys*ys)/(2*sigma*sigma)) * cexp(2*pi*I*xs/lambda);
+        }
+    }
+
+}
+
+/**
+ * Normalizes the real and imaginary values of a filter of size values, such
+ * that the positive and negative values of each part have the same sum.
+ */
+void _normalizeFilter(float complex *gw, int size) {
 
     // First, get all sums
     float realSumPos = 0.0;
     float realSumNeg = 0.0;
     float imagSumPos = 0.0;
     float imagSumNeg = 0.0;
-    for (int y = 0; y < n; y++) {
-        for (int x = 0; x < n; x++) {
-            float r = crealf(gw[y*n+x]);
-            float i = cimagf(gw[y*n+x]);
-            if (r > 0) {
-                realSumPos += r;
-            } else if (r < 0) {
-                realSumNeg += fabsf(r);
-            }
-            if (i > 0) {
-                imagSumPos += i;
-            } else if (i < 0) {
-                imagSumNeg += fabsf(i);
-            }
+    for (int k = 0; k < size; k++) {
+        float r = crealf(gw[k]);
+        float i = cimagf(gw[k]);
+        if (r > 0) {
+            realSumPos += r;
+        } else if (r < 0) {
+            realSumNeg += fabsf(r);
+        }
+        if (i > 0) {
+            imagSumPos += i;
+        } else if (i < 0) {
+            imagSumNeg += fabsf(i);
         }
     }
 
@@ -74,30 +91,59 @@ void _normalizedFilter2(float complex *gw, int n, float xi, float sigma, float l
     }
 
     // Adjust the values
-    for (int y = 0; y < n; y++) {
-        for (int x = 0; x < n; x++) {
+    for (int k = 0; k < size; k++) {
 
-            float r = crealf(gw[y*n+x]);
-            float i = cimagf(gw[y*n+x]);
+        float r = crealf(gw[k]);
+        float i = cimagf(gw[k]);
 
-            if (r > 0) {
-                r *= realNegFact;
-            } else if (r < 0) {
-                r *= realPosFact;
-            }
-            if (i > 0) {
-                i *= imagNegFact;
-            } else if (i < 0) {
-                i *= imagPosFact;
-            }
+        if (r > 0) {
+            r *= realNegFact;
+        } else if (r < 0) {
+            r *= realPosFact;
+        }
+        if (i > 0) {
+            i *= imagNegFact;
+        } else if (i < 0) {
+            i *= imagPosFact;
+        }
 
-            gw[y*n+x] = r + i*I;
+        gw[k] = r + i*I;
 
-        }
     }
 
 }
 
+/**
+ * Generates a 2D Gabor filter that is normalized and saves the result into gw.
+ */
+void _normalizedFilter2(float complex *gw, int n, float xi, float sigma, float lambda, float theta) {
+
+    // Generate the filter
+    _filter2(gw, n, xi, sigma, lambda, theta);
+
+    // Now normalize the real and imaginary values
+    _normalizeFilter(gw, n*n);
+
+}
+
+/**
+ * Generates a 2D Gabor filter on a window of (2*radius+1)^2 points that is
+ * normalized over that window and saves the result into gw.
+ */
+void _normalizedFilterWindow2(float complex *gw, int radius, float xi, float sigma, float lambda, float theta) {
+    _filterWindow2(gw, radius, xi, sigma, lambda, theta);
+    _normalizeFilter(gw, (2*radius+1)*(2*radius+1));
+}
+
+/**
+ * Gets the radius outside of which the Gaussian envelope of a Gabor filter is
+ * below exp(-8), that is 4 standard deviations along its longer axis.
+ */
+int _filterRadius(float xi, float sigma) {
+    float extent = xi < 1 ? sigma / xi : sigma;
+    return (int) ceilf(4 * extent);
+}
+
 /**
  * Fixes the coordinates of an input image by mirroring all y-values
  */
@@ -124,3 +170,783 @@ void _translate2(float complex *f, float complex *fShift, int n, int hShift, int
     }
 
 }
+
+/**
+ * Calculates the Fourier transform of a real input function, which is shared
+ * by all orientations of a fast Gabor convolution.
+ */
+void _fgc2Spectrum(float *y1, float complex *y1Hat, int n, Arena *arena) {
+
+    int size = n*n;
+    size_t mark = _arenaMark(arena);
+
+    // Assign real value of data
+    float complex *y1C = _arenaAlloc(arena, size * sizeof(float complex));
+    for (int i = 0; i < size; i++) {
+        y1C[i] = y1[i];
+    }
+
+    _fft2(y1C, y1Hat, n, arena);
+
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Calculates the complex response of orientation j of amount orientations of
+ * the 2D fast Gabor convolution, not shifted yet, and saves it into yConv.
+ */
+void _fgc2Response(float complex *y1Hat, float complex *yConv, int n, float xi, float sigma, float lambda, float theta, int j, int amount, Arena *arena) {
+
+    size_t mark = _arenaMark(arena);
+
+    // Get filter data
+    float complex *y2 = _arenaAlloc(arena, n * n * sizeof(float complex));
+    float pi = acos(-1.0);
+    _normalizedFilter2(y2, n, xi, sigma, lambda, theta + pi*j/amount);
+
+    _conv2Hat(y2, y1Hat, yConv, n, arena);
+
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Adds the magnitude of a response, shifted by n/2 in both directions, to
+ * yConvSum, which is overwritten for j = 0. If minMax is not NULL, the minimum
+ * and maximum of yConvSum are tracked while accumulating and saved into
+ * minMax[0] and minMax[1].
+ */
+static void _accumulateShifted(float complex *yConv, float *yConvSum, int n, int j, float *minMax) {
+
+    float min = INFINITY;
+    float max = -INFINITY;
+    for (int y = 0; y < n; y++) {
+        float complex *row = &yConv[((y+n/2) % n) * n];
+        for (int x = 0; x < n; x++) {
+            int i = y*n+x;
+            float yConvShiftedAbs = cabsf(row[(x+n/2) % n]);
+            if (j == 0) yConvSum[i] = yConvShiftedAbs;
+            else yConvSum[i] += yConvShiftedAbs;
+            if (minMax != NULL) {
+                min = yConvSum[i] < min ? yConvSum[i] : min;
+                max = yConvSum[i] > max ? yConvSum[i] : max;
+            }
+        }
+    }
+    if (minMax != NULL) {
+        minMax[0] = min;
+        minMax[1] = max;
+    }
+
+}
+
+/**
+ * Calculates orientation j of amount orientations of the 2D fast Gabor
+ * convolution and adds its magnitude to yConvSum, which is overwritten for j = 0.
+ * If minMax is not NULL, the minimum and maximum of yConvSum are tracked while
+ * accumulating and saved into minMax[0] and minMax[1].
+ */
+void _fgc2Orientation(float complex *y1Hat, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int j, int amount, float *minMax, Arena *arena) {
+
+    size_t mark = _arenaMark(arena);
+
+    // Alloc data
+    float complex *yConv = _arenaAlloc(arena, n * n * sizeof(float complex));
+
+    _fgc2Response(y1Hat, yConv, n, xi, sigma, lambda, theta, j, amount, arena);
+
+    // Shift the values and assign their magnitude
+    _accumulateShifted(yConv, yConvSum, n, j, minMax);
+
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Calculates the Fourier transform of the normalized Gabor filter of
+ * orientation j of amount orientations and saves it into y2Hat. It does not
+ * depend on the input, so it can be shared by a batch of inputs.
+ */
+void _fgc2FilterSpectrum(float complex *y2Hat, int n, float xi, float sigma, float lambda, float theta, int j, int amount, Arena *arena) {
+
+    size_t mark = _arenaMark(arena);
+
+    float complex *y2 = _arenaAlloc(arena, n * n * sizeof(float complex));
+    float pi = acos(-1.0);
+    _normalizedFilter2(y2, n, xi, sigma, lambda, theta + pi*j/amount);
+    _fft2(y2, y2Hat, n, arena);
+
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Calculates orientation j of the 2D fast Gabor convolution like
+ * _fgc2Orientation, but from the spectrum y2Hat of its filter.
+ */
+void _fgc2SpectrumOrientation(float complex *y1Hat, float complex *y2Hat, float *yConvSum, int n, int j, float *minMax, Arena *arena) {
+
+    int size = n*n;
+    size_t mark = _arenaMark(arena);
+
+    // Multiply in Fourier space and transform back
+    float complex *yConvHat = _arenaAlloc(arena, size * sizeof(float complex));
+    float complex *yConv = _arenaAlloc(arena, size * sizeof(float complex));
+    for (int i = 0; i < size; i++) {
+        yConvHat[i] = y2Hat[i] * y1Hat[i];
+    }
+    _ifft2(yConvHat, yConv, n, arena);
+
+    _accumulateShifted(yConv, yConvSum, n, j, minMax);
+
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Calculates the 2D fast Gabor convolution like _fgc2, but from the spectra of
+ * the amount filters, as calculated by _fgc2FilterSpectrum and saved one after
+ * the other into y2Hats.
+ */
+void _fgc2Spectra(float *y1, float complex *y2Hats, float *yConvSum, int n, int amount, float *minMax, Arena *arena) {
+
+    size_t mark = _arenaMark(arena);
+
+    // Calculate Fourier transform of y1 first
+    float complex *y1Hat = _arenaAlloc(arena, n * n * sizeof(float complex));
+    _fgc2Spectrum(y1, y1Hat, n, arena);
+
+    for (int j = 0; j < amount; j++) {
+        _fgc2SpectrumOrientation(y1Hat, &y2Hats[(size_t) j * n * n], yConvSum, n, j, j == amount-1 ? minMax : NULL, arena);
+    }
+
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Calculates orientation j of amount orientations of the 2D Gabor convolution
+ * like _fgc2Orientation, but directly in the spatial domain with the filter
+ * truncated to a window of (2*radius+1)^2 points, which needs 2*radius+1 < n.
+ * Only the region of width*height values starting at column x0 and row y0 is
+ * calculated and saved into yConvSum with rows of length width. The input is
+ * padded circularly, so that the result equals the circular convolution of the
+ * Fourier method up to the truncation.
+ */
+void _fgc2DirectRegionOrientation(float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int j, int amount, int radius, int x0, int y0, int width, int height, float *minMax, Arena *arena) {
+
+    int w = 2*radius+1;
+    int m = width + 2*radius;
+    size_t mark = _arenaMark(arena);
+
+    // Get the filter window, flipped and split into real and imaginary part
+    float complex *window = _arenaAlloc(arena, w * w * sizeof(float complex));
+    float *kernelReal = _arenaAlloc(arena, w * w * sizeof(float));
+    float *kernelImag = _arenaAlloc(arena, w * w * sizeof(float));
+    float pi = acos(-1.0);
+    _normalizedFilterWindow2(window, radius, xi, sigma, lambda, theta + pi*j/amount);
+    for (int k = 0; k < w*w; k++) {
+        kernelReal[w*w-1-k] = crealf(window[k]);
+        kernelImag[w*w-1-k] = cimagf(window[k]);
+    }
+
+    // Pad the input of the region circularly
+    float *padded = _arenaAlloc(arena, m * (height + 2*radius) * sizeof(float));
+    for (int y = 0; y < height + 2*radius; y++) {
+        for (int x = 0; x < m; x++) {
+            padded[y*m+x] = y1[((y0+y-radius) & (n-1))*n + ((x0+x-radius) & (n-1))];
+        }
+    }
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            float re = 0;
+            float im = 0;
+            for (int a = 0; a < w; a++) {
+                const float *row = &padded[(y+a)*m + x];
+                const float *kr = &kernelReal[a*w];
+                const float *ki = &kernelImag[a*w];
+                for (int b = 0; b < w; b++) {
+                    re += kr[b] * row[b];
+                    im += ki[b] * row[b];
+                }
+            }
+            float yConvAbs = sqrtf(re*re + im*im);
+            if (j == 0) yConvSum[y*width+x] = yConvAbs;
+            else yConvSum[y*width+x] += yConvAbs;
+        }
+    }
+    if (minMax != NULL) _minMax(yConvSum, width*height, &minMax[0], &minMax[1]);
+
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Calculates orientation j of amount orientations of the 2D Gabor convolution
+ * directly in the spatial domain for the whole image, see
+ * _fgc2DirectRegionOrientation.
+ */
+void _fgc2DirectOrientation(float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int j, int amount, int radius, float *minMax, Arena *arena) {
+    _fgc2DirectRegionOrientation(y1, yConvSum, n, xi, sigma, lambda, theta, j, amount, radius, 0, 0, n, n, minMax, arena);
+}
+
+/**
+ * Calculates orientation j of amount orientations of the 2D Gabor convolution
+ * like _fgc2DirectOrientation, but with Fourier transforms of size tile*tile
+ * by the overlap-save method. Each tile yields tile-2*radius rows and columns
+ * of the result, so tile must be a power of 2 greater than 2*radius.
+ */
+void _fgc2TiledOrientation(float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int j, int amount, int radius, int tile, float *minMax, Arena *arena) {
+
+    int w = 2*radius+1;
+    int t = tile;
+    int valid = t - 2*radius;
+    size_t mark = _arenaMark(arena);
+
+    // Get the filter window and place it around the origin of a tile
+    float complex *window = _arenaAlloc(arena, w * w * sizeof(float complex));
+    float complex *kernel = _arenaAlloc(arena, t * t * sizeof(float complex));
+    float complex *kernelHat = _arenaAlloc(arena, t * t * sizeof(float complex));
+    float complex *block = _arenaAlloc(arena, t * t * sizeof(float complex));
+    float complex *blockConv = _arenaAlloc(arena, t * t * sizeof(float complex));
+    float pi = acos(-1.0);
+    _normalizedFilterWindow2(window, radius, xi, sigma, lambda, theta + pi*j/amount);
+    for (int k = 0; k < t*t; k++) {
+        kernel[k] = 0;
+    }
+    for (int y = 0; y < w; y++) {
+        for (int x = 0; x < w; x++) {
+            kernel[((y-radius) & (t-1))*t + ((x-radius) & (t-1))] = window[y*w+x];
+        }
+    }
+    _fft2(kernel, kernelHat, t, arena);
+
+    for (int oy = 0; oy < n; oy += valid) {
+        for (int ox = 0; ox < n; ox += valid) {
+
+            // Gather the tile with a margin of radius, wrapping around the edges
+            for (int y = 0; y < t; y++) {
+                for (int x = 0; x < t; x++) {
+                    block[y*t+x] = y1[((oy-radius+y) & (n-1))*n + ((ox-radius+x) & (n-1))];
+                }
+            }
+
+            _conv2Hat(block, kernelHat, blockConv, t, arena);
+
+            // Keep the values that are not affected by the circular convolution of the tile
+            int rows = n - oy < valid ? n - oy : valid;
+            int cols = n - ox < valid ? n - ox : valid;
+            for (int y = 0; y < rows; y++) {
+                for (int x = 0; x < cols; x++) {
+                    float yConvAbs = cabsf(blockConv[(y+radius)*t + x+radius]);
+                    if (j == 0) yConvSum[(oy+y)*n + ox+x] = yConvAbs;
+                    else yConvSum[(oy+y)*n + ox+x] += yConvAbs;
+                }
+            }
+
+        }
+    }
+    if (minMax != NULL) _minMax(yConvSum, n*n, &minMax[0], &minMax[1]);
+
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Calculates the 2D fast Gabor convolution of an input function and a Gabor
+ * filter of given params, summed up over amount orientations. If minMax is not
+ * NULL, the range of the result is saved into it. The transform of the input
+ * and each orientation are steps of the control, if given; if it is
+ * cancelled, the calculation stops after the current step and yConvSum is
+ * incomplete.
+ */
+void _fgc2(float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int amount, float *minMax, Control *control, Arena *arena) {
+
+    size_t mark = _arenaMark(arena);
+    _controlBegin(control, amount + 1);
+
+    // Calculate Fourier transform of y1 first
+    float complex *y1Hat = _arenaAlloc(arena, n * n * sizeof(float complex));
+    _fgc2Spectrum(y1, y1Hat, n, arena);
+
+    for (int j = 0; j < amount && !_controlStep(control); j++) {
+        _fgc2Orientation(y1Hat, yConvSum, n, xi, sigma, lambda, theta, j, amount, j == amount-1 ? minMax : NULL, arena);
+    }
+
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Calculates orientation j of amount orientations of the 2D fast Gabor
+ * convolution like _fgc2Orientation, but with the filter, its spectrum and the
+ * response all in the matrix yConv, transformed in place, so that no further
+ * matrix is needed.
+ */
+void _fgc2InPlaceOrientation(float complex *y1Hat, float complex *yConv, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int j, int amount, float *minMax, Arena *arena) {
+
+    float pi = acos(-1.0);
+    _normalizedFilter2(yConv, n, xi, sigma, lambda, theta + pi*j/amount);
+    _fft2InPlace(yConv, n, arena);
+
+    // Multiply in FFT space
+    for (int i = 0; i < n*n; i++) {
+        yConv[i] *= y1Hat[i];
+    }
+
+    _ifft2InPlace(yConv, n, arena);
+    _accumulateShifted(yConv, yConvSum, n, j, minMax);
+
+}
+
+/**
+ * Calculates the 2D fast Gabor convolution like _fgc2, but with the transforms
+ * in place. The peak memory is the two matrices of n*n complex values for the
+ * spectrum of the input and the response at hand, plus vectors of size n, see
+ * _fgc2InPlaceArenaSize. The steps of the control, if given, are like in
+ * _fgc2.
+ */
+void _fgc2InPlace(float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int amount, float *minMax, Control *control, Arena *arena) {
+
+    size_t mark = _arenaMark(arena);
+    _controlBegin(control, amount + 1);
+
+    // Calculate Fourier transform of y1 first
+    float complex *y1Hat = _arenaAlloc(arena, n * n * sizeof(float complex));
+    for (int i = 0; i < n*n; i++) {
+        y1Hat[i] = y1[i];
+    }
+    _fft2InPlace(y1Hat, n, arena);
+
+    float complex *yConv = _arenaAlloc(arena, n * n * sizeof(float complex));
+    for (int j = 0; j < amount && !_controlStep(control); j++) {
+        _fgc2InPlaceOrientation(y1Hat, yConv, yConvSum, n, xi, sigma, lambda, theta, j, amount, j == amount-1 ? minMax : NULL, arena);
+    }
+
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Calculates orientation j of amount orientations of the 2D fast Gabor
+ * convolution in a region of width*height values starting at column x0 and row
+ * y0 like _fgc2DirectRegionOrientation, but by the Fourier method with an
+ * inverse transform pruned to the region.
+ */
+void _fgc2PrunedRegionOrientation(float complex *y1Hat, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int j, int amount, int x0, int y0, int width, int height, float *minMax, Arena *arena) {
+
+    int size = n*n;
+    size_t mark = _arenaMark(arena);
+
+    // Get filter data and multiply in Fourier space
+    float complex *y2 = _arenaAlloc(arena, size * sizeof(float complex));
+    float complex *y2Hat = _arenaAlloc(arena, size * sizeof(float complex));
+    float complex *yConv = _arenaAlloc(arena, width * height * sizeof(float complex));
+    float pi = acos(-1.0);
+    _normalizedFilter2(y2, n, xi, sigma, lambda, theta + pi*j/amount);
+    _fft2(y2, y2Hat, n, arena);
+    for (int i = 0; i < size; i++) {
+        y2Hat[i] = y2Hat[i] * y1Hat[i];
+    }
+
+    // Transform back the region only, which is shifted by n/2 in both directions
+    _ifft2Region(y2Hat, yConv, n, x0 - n/2, y0 - n/2, width, height, arena);
+
+    for (int i = 0; i < width*height; i++) {
+        float yConvAbs = cabsf(yConv[i]);
+        if (j == 0) yConvSum[i] = yConvAbs;
+        else yConvSum[i] += yConvAbs;
+    }
+    if (minMax != NULL) _minMax(yConvSum, width*height, &minMax[0], &minMax[1]);
+
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Checks if the direct method is cheaper than the pruned Fourier method for a
+ * region. A multiply-add of the direct method costs about 1/32 of a unit of
+ * n^2 log2(n) of the Fourier method.
+ */
+int _fgc2RegionIsDirect(int n, int radius, int width, int height) {
+    double taps = (double) (2*radius+1) * (2*radius+1);
+    return 2*radius+1 < n && (double) width * height * taps < 32 * (double) n * n * log2(n);
+}
+
+/**
+ * Calculates the 2D fast Gabor convolution of an input function like _fgc2,
+ * but only in a region of width*height values starting at column x0 and row
+ * y0, which is saved into yConvSum with rows of length width. Small regions
+ * are calculated directly with the filter truncated to 4 standard deviations,
+ * so that the cost scales with the region times the filter instead of n^2.
+ * The steps of the control, if given, are like in _fgc2.
+ */
+void _fgc2Region(float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int amount, int x0, int y0, int width, int height, float *minMax, Control *control, Arena *arena) {
+
+    // Check the region
+    if (x0 < 0 || y0 < 0 || width < 1 || height < 1 || x0 + width > n || y0 + height > n) {
+        _error("Error in region: Region must lie within the image.\n");
+        return;
+    }
+
+    int radius = _filterRadius(xi, sigma);
+    if (_fgc2RegionIsDirect(n, radius, width, height)) {
+        _controlBegin(control, amount);
+        for (int j = 0; j < amount && !_controlCancelled(control); j++) {
+            _fgc2DirectRegionOrientation(y1, yConvSum, n, xi, sigma, lambda, theta, j, amount, radius, x0, y0, width, height, j == amount-1 ? minMax : NULL, arena);
+            _controlStep(control);
+        }
+        return;
+    }
+
+    size_t mark = _arenaMark(arena);
+    _controlBegin(control, amount + 1);
+
+    // Calculate Fourier transform of y1 first
+    float complex *y1Hat = _arenaAlloc(arena, n * n * sizeof(float complex));
+    _fgc2Spectrum(y1, y1Hat, n, arena);
+
+    for (int j = 0; j < amount && !_controlStep(control); j++) {
+        _fgc2PrunedRegionOrientation(y1Hat, yConvSum, n, xi, sigma, lambda, theta, j, amount, x0, y0, width, height, j == amount-1 ? minMax : NULL, arena);
+    }
+
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Gets the size n of the matrix an image of width*height is zero-padded to,
+ * which is the smallest power of 2 that leaves at least the radius of the
+ * filter as zeros behind the image, so that the responses do not wrap around.
+ */
+int _fgc2PaddedSize(float xi, float sigma, int width, int height) {
+    int extent = (width > height ? width : height) + _filterRadius(xi, sigma);
+    int n = 2;
+    while (n < extent) n *= 2;
+    return n;
+}
+
+/**
+ * Calculates the 2D Gabor convolution of an image of width*height zero-padded
+ * to a matrix of size n*n. The image stays at the top left, the zero rows and
+ * columns are pruned from the Fourier transform of the image and only the
+ * responses of the image are transformed back, so yConvSum is of width*height
+ * as well. The steps of the control, if given, are like in _fgc2.
+ */
+void _fgc2Padded(float *y1, int width, int height, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int amount, float *minMax, Control *control, Arena *arena) {
+
+    size_t mark = _arenaMark(arena);
+    _controlBegin(control, amount + 1);
+
+    // Calculate Fourier transform of the padded y1 first
+    float complex *y1Hat = _arenaAlloc(arena, n * n * sizeof(float complex));
+    _fft2Padded(y1, width, height, y1Hat, n, arena);
+
+    for (int j = 0; j < amount && !_controlStep(control); j++) {
+        _fgc2PrunedRegionOrientation(y1Hat, yConvSum, n, xi, sigma, lambda, theta, j, amount, 0, 0, width, height, j == amount-1 ? minMax : NULL, arena);
+    }
+
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Gets the DC correction of the spectrum of a Gabor filter, that is the
+ * weight of its Gaussian envelope that is subtracted so that the filter has no
+ * DC like the normalized one, or 0 where that weight is negligible.
+ */
+static float _filterDcCorrection(float sigma, float lambda) {
+    float pi = acos(-1.0);
+    float kappa = expf(-2*pi*pi*sigma*sigma/(lambda*lambda));
+    return kappa > 1e-4 ? kappa : 0;
+}
+
+/**
+ * Gets the size m of the grid the responses of the band-limited method are
+ * transformed back on. The spectrum of a filter is a Gaussian around its
+ * carrier, so m is the smallest power of 2 that holds 4 standard deviations of
+ * it on either side for any orientation, and the DC correction if needed, but
+ * at most n.
+ */
+int _fgc2DecimatedSize(int n, float xi, float sigma, float lambda) {
+
+    float pi = acos(-1.0);
+    float deviation = n * (xi > 1 ? xi : 1) / (2*pi*sigma);
+    float band = 8 * deviation + (_filterDcCorrection(sigma, lambda) > 0 ? n / lambda : 0);
+
+    int m = 2;
+    while (m < band && m < n) m *= 2;
+    return m;
+
+}
+
+/**
+ * Calculates orientation j of amount orientations of the 2D fast Gabor
+ * convolution, but only from the m*m frequencies of the passband of the
+ * filter, with m < n. The band is shifted to DC, so that the inverse transform
+ * is of size m*m and yields the magnitude of the response at every n/m-th row
+ * and column, which is added to yConvSum of m*m values like in
+ * _fgc2Orientation. The spectrum of the filter is evaluated there
+ * analytically, where normalizing it hardly changes it. If the DC correction
+ * is needed, the normalized filter differs from the Gaussian minus the
+ * correction, so its discrete spectrum is sampled instead, recentered to 0.
+ */
+void _fgc2DecimatedOrientation(float complex *y1Hat, float *yConvSum, int n, int m, float xi, float sigma, float lambda, float theta, int j, int amount, float *minMax, Arena *arena) {
+
+    size_t mark = _arenaMark(arena);
+
+    float pi = acos(-1.0);
+    float angle = theta + pi*j/amount;
+    float c = cosf(angle);
+    float s = sinf(angle);
+    float kappa = _filterDcCorrection(sigma, lambda);
+    float scale = 2*pi*sigma*sigma / xi;
+    float width = 2*pi*pi*sigma*sigma;
+
+    float complex *y2Hat = NULL;
+    if (kappa > 0) {
+        y2Hat = _arenaAlloc(arena, n * n * sizeof(float complex));
+        _fgc2FilterSpectrum(y2Hat, n, xi, sigma, lambda, theta, j, amount, arena);
+    }
+
+    // Center the band on the carrier, or between it and DC if the correction is needed
+    float shift = kappa > 0 ? 0.5 : 1;
+    int cx = (int) lroundf(shift * n * c / lambda);
+    int cy = (int) lroundf(shift * n * s / lambda);
+
+    // Multiply the band with the spectrum of the filter, with the band at DC
+    float complex *yConvHat = _arenaAlloc(arena, m * m * sizeof(float complex));
+    float complex *yConv = _arenaAlloc(arena, m * m * sizeof(float complex));
+    for (int b = 0; b < m; b++) {
+        int ky = cy + (b < m/2 ? b : b - m);
+        float fy = (float) ky / n;
+        const float complex *row = &y1Hat[(ky & (n-1)) * n];
+        for (int a = 0; a < m; a++) {
+            int kx = cx + (a < m/2 ? a : a - m);
+            float complex filterHat;
+            if (y2Hat != NULL) {
+                // The filter is centered at n/2, which alternates the sign of its spectrum
+                filterHat = ((kx + ky) & 1 ? -1 : 1) * y2Hat[(ky & (n-1)) * n + (kx & (n-1))];
+            } else {
+                float fx = (float) kx / n;
+                float u = fx*c + fy*s;
+                float v = (-fx*s + fy*c) / xi;
+                float du = u - 1/lambda;
+                filterHat = scale * expf(-width*(du*du + v*v));
+            }
+            yConvHat[b*m+a] = filterHat * row[kx & (n-1)];
+        }
+    }
+    _ifft2(yConvHat, yConv, m, arena);
+
+    // The shift to DC only changes the phase, the transform of size m scales by (n/m)^2
+    float h = (float) m * m / ((float) n * n);
+    for (int i = 0; i < m*m; i++) {
+        float yConvAbs = h * cabsf(yConv[i]);
+        if (j == 0) yConvSum[i] = yConvAbs;
+        else yConvSum[i] += yConvAbs;
+    }
+    if (minMax != NULL) _minMax(yConvSum, m*m, &minMax[0], &minMax[1]);
+
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Calculates the 2D fast Gabor convolution like _fgc2, but band-limited, see
+ * _fgc2DecimatedOrientation, so that yConvSum is the decimated result of m*m
+ * values with m from _fgc2DecimatedSize. Only the transform of the input is
+ * of size n*n. If the band is not smaller than the image, that is m = n, the
+ * orientations are those of _fgc2. The steps of the control, if given, are
+ * like in _fgc2.
+ */
+void _fgc2Decimated(float *y1, float *yConvSum, int n, int m, float xi, float sigma, float lambda, float theta, int amount, float *minMax, Control *control, Arena *arena) {
+
+    size_t mark = _arenaMark(arena);
+    _controlBegin(control, amount + 1);
+
+    // Calculate Fourier transform of y1 first
+    float complex *y1Hat = _arenaAlloc(arena, n * n * sizeof(float complex));
+    _fgc2Spectrum(y1, y1Hat, n, arena);
+
+    for (int j = 0; j < amount && !_controlStep(control); j++) {
+        float *jMinMax = j == amount-1 ? minMax : NULL;
+        if (m < n) _fgc2DecimatedOrientation(y1Hat, yConvSum, n, m, xi, sigma, lambda, theta, j, amount, jMinMax, arena);
+        else _fgc2Orientation(y1Hat, yConvSum, n, xi, sigma, lambda, theta, j, amount, jMinMax, arena);
+    }
+
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Calculates a texture descriptor of an input function, that is the mean and
+ * variance of the magnitude of each of the amount Gabor filter responses,
+ * pooled over a grid of blocks*blocks blocks. The magnitudes are pooled while
+ * they are calculated, so no magnitude image is needed. The features are saved
+ * as [amount][blocks][blocks][2] with mean and variance in the last dimension.
+ * Returns 0 on success or 1 if the blocks do not divide n.
+ */
+int _fgc2Descriptor(float *y1, float *features, int n, float xi, float sigma, float lambda, float theta, int amount, int blocks, Arena *arena) {
+
+    // Check if the blocks divide the image
+    if (blocks < 1 || blocks > n || n % blocks != 0) {
+        _error("Error in descriptor: Blocks must divide the image size n.\n");
+        return 1;
+    }
+
+    int size = n*n;
+    int blockSize = n / blocks;
+    int blockCount = blocks * blocks;
+    double blockPixels = (double) blockSize * blockSize;
+    size_t mark = _arenaMark(arena);
+
+    // Calculate Fourier transform of y1 first
+    float complex *y1Hat = _arenaAlloc(arena, size * sizeof(float complex));
+    float complex *yConv = _arenaAlloc(arena, size * sizeof(float complex));
+    double *sums = _arenaAlloc(arena, 2 * blockCount * sizeof(double));
+    _fgc2Spectrum(y1, y1Hat, n, arena);
+
+    for (int j = 0; j < amount; j++) {
+
+        _fgc2Response(y1Hat, yConv, n, xi, sigma, lambda, theta, j, amount, arena);
+
+        // Pool the magnitudes, the response is shifted by n/2 in both directions
+        for (int b = 0; b < 2 * blockCount; b++) {
+            sums[b] = 0;
+        }
+        for (int y = 0; y < n; y++) {
+            int rowBlock = ((y + n/2) % n) / blockSize * blocks;
+            for (int x = 0; x < n; x++) {
+                int b = rowBlock + ((x + n/2) % n) / blockSize;
+                float v = cabsf(yConv[y*n+x]);
+                sums[2*b] += v;
+                sums[2*b+1] += (double) v * v;
+            }
+        }
+
+        for (int b = 0; b < blockCount; b++) {
+            double mean = sums[2*b] / blockPixels;
+            double variance = sums[2*b+1] / blockPixels - mean * mean;
+            features[2*(j*blockCount+b)] = mean;
+            features[2*(j*blockCount+b)+1] = variance > 0 ? variance : 0;
+        }
+
+    }
+
+    _arenaRelease(arena, mark);
+
+    return 0;
+
+}
+
+/**
+ * Gets the arena bytes needed by _fgc2Padded. The pruned transforms need no
+ * more than the full ones.
+ */
+size_t _fgc2PaddedArenaSize(int n, int width, int height) {
+
+    size_t matrixSize = _arenaSize((size_t) n * n * sizeof(float complex));
+    size_t transformSize = _fft2ArenaSize(n) > _ifft2RegionArenaSize(n, width) ? _fft2ArenaSize(n) : _ifft2RegionArenaSize(n, width);
+    size_t orientationSize = 2 * matrixSize + _arenaSize((size_t) width * height * sizeof(float complex)) + transformSize;
+
+    return matrixSize + (_fft2ArenaSize(n) > orientationSize ? _fft2ArenaSize(n) : orientationSize);
+
+}
+
+/**
+ * Gets the arena bytes needed by _fgc2Descriptor.
+ */
+size_t _fgc2DescriptorArenaSize(int n, int blocks) {
+    size_t matrixSize = _arenaSize((size_t) n * n * sizeof(float complex));
+    return 3 * matrixSize + _arenaSize(2 * (size_t) blocks * blocks * sizeof(double)) + _conv2HatArenaSize(n);
+}
+
+/**
+ * Gets the arena bytes needed by _fgc2Decimated, with room for the spectrum of
+ * the filter in case the DC correction is needed.
+ */
+size_t _fgc2DecimatedArenaSize(int n, int m) {
+    size_t matrixSize = _arenaSize((size_t) n * n * sizeof(float complex));
+    if (m >= n) return _fgc2ArenaSize(n);
+    size_t bandSize = 2 * _arenaSize((size_t) m * m * sizeof(float complex));
+    size_t filterSize = matrixSize + _fgc2FilterSpectrumArenaSize(n);
+    size_t transformSize = _fft2ArenaSize(n) > _fft2ArenaSize(m) ? _fft2ArenaSize(n) : _fft2ArenaSize(m);
+    return matrixSize + (filterSize > bandSize ? filterSize : bandSize) + bandSize + transformSize;
+}
+
+/**
+ * Gets the arena bytes needed by _fgc2. The buffers of an orientation are
+ * released before the next one, so the amount of orientations does not count.
+ */
+size_t _fgc2ArenaSize(int n) {
+    size_t matrixSize = _arenaSize((size_t) n * n * sizeof(float complex));
+    return 3 * matrixSize + _conv2HatArenaSize(n);
+}
+
+/**
+ * Gets the arena bytes needed by _fgc2InPlace, that is two matrices and the
+ * vectors of the transforms.
+ */
+size_t _fgc2InPlaceArenaSize(int n) {
+    return 2 * _arenaSize((size_t) n * n * sizeof(float complex)) + _fft2InPlaceArenaSize(n);
+}
+
+/**
+ * Gets the arena bytes needed by _fgc2FilterSpectrum.
+ */
+size_t _fgc2FilterSpectrumArenaSize(int n) {
+    return _arenaSize((size_t) n * n * sizeof(float complex)) + _fft2ArenaSize(n);
+}
+
+/**
+ * Gets the arena bytes needed by _fgc2Spectra, besides the filter spectra.
+ */
+size_t _fgc2SpectraArenaSize(int n) {
+    size_t matrixSize = _arenaSize((size_t) n * n * sizeof(float complex));
+    return 3 * matrixSize + _fft2ArenaSize(n);
+}
+
+/**
+ * Gets the arena bytes needed by _fgc2DirectRegionOrientation.
+ */
+size_t _fgc2DirectRegionArenaSize(int radius, int width, int height) {
+    size_t w = 2*radius+1;
+    size_t padded = (size_t) (width + 2*radius) * (height + 2*radius);
+    return _arenaSize(w * w * sizeof(float complex)) + 2 * _arenaSize(w * w * sizeof(float)) + _arenaSize(padded * sizeof(float));
+}
+
+/**
+ * Gets the arena bytes needed by _fgc2DirectOrientation.
+ */
+size_t _fgc2DirectArenaSize(int n, int radius) {
+    return _fgc2DirectRegionArenaSize(radius, n, n);
+}
+
+/**
+ * Gets the arena bytes needed by _fgc2Region.
+ */
+size_t _fgc2RegionArenaSize(int n, float xi, float sigma, int width, int height) {
+
+    int radius = _filterRadius(xi, sigma);
+    if (_fgc2RegionIsDirect(n, radius, width, height)) return _fgc2DirectRegionArenaSize(radius, width, height);
+
+    size_t matrixSize = _arenaSize((size_t) n * n * sizeof(float complex));
+    size_t spectrumSize = matrixSize + _fft2ArenaSize(n);
+    size_t transformSize = _fft2ArenaSize(n) > _ifft2RegionArenaSize(n, width) ? _fft2ArenaSize(n) : _ifft2RegionArenaSize(n, width);
+    size_t orientationSize = 2 * matrixSize + _arenaSize((size_t) width * height * sizeof(float complex)) + transformSize;
+
+    return matrixSize + (spectrumSize > orientationSize ? spectrumSize : orientationSize);
+
+}
+
+/**
+ * Gets the arena bytes needed by _fgc2TiledOrientation.
+ */
+size_t _fgc2TiledArenaSize(int radius, int tile) {
+    size_t w = 2*radius+1;
+    size_t tileSize = _arenaSize((size_t) tile * tile * sizeof(float complex));
+    return _arenaSize(w * w * sizeof(float complex)) + 4 * tileSize + _conv2HatArenaSize(tile);
+}
@@ -1,7 +1,45 @@
 #include <complex.h>
-#include <emscripten/emscripten.h>
+#include "arena.h"
+#include "control.h"
 
 void _filter2(float complex *gw, int n, float xi, float sigma, float lambda, float theta);
+void _filterWindow2(float complex *gw, int radius, float xi, float sigma, float lambda, float theta);
+void _normalizeFilter(float complex *gw, int size);
 void _normalizedFilter2(float complex *gw, int n, float xi, float sigma, float lambda, float theta);
+void _normalizedFilterWindow2(float complex *gw, int radius, float xi, float sigma, float lambda, float theta);
+int _filterRadius(float xi, float sigma);
 void _translate2(float complex *f, float complex *fShift, int n, int hShift, int vShift);
 void _mirrorYCoordinate(float complex *f, float complex *f2, int n);
+void _fgc2Spectrum(float *y1, float complex *y1Hat, int n, Arena *arena);
+void _fgc2Response(float complex *y1Hat, float complex *yConv, int n, float xi, float sigma, float lambda, float theta, int j, int amount, Arena *arena);
+void _fgc2Orientation(float complex *y1Hat, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int j, int amount, float *minMax, Arena *arena);
+void _fgc2FilterSpectrum(float complex *y2Hat, int n, float xi, float sigma, float lambda, float theta, int j, int amount, Arena *arena);
+void _fgc2SpectrumOrientation(float complex *y1Hat, float complex *y2Hat, float *yConvSum, int n, int j, float *minMax, Arena *arena);
+void _fgc2Spectra(float *y1, float complex *y2Hats, float *yConvSum, int n, int amount, float *minMax, Arena *arena);
+void _fgc2DirectRegionOrientation(float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int j, int amount, int radius, int x0, int y0, int width, int height, float *minMax, Arena *arena);
+void _fgc2DirectOrientation(float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int j, int amount, int radius, float *minMax, Arena *arena);
+void _fgc2TiledOrientation(float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int j, int amount, int radius, int tile, float *minMax, Arena *arena);
+void _fgc2InPlaceOrientation(float complex *y1Hat, float complex *yConv, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int j, int amount, float *minMax, Arena *arena);
+void _fgc2InPlace(float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int amount, float *minMax, Control *control, Arena *arena);
+void _fgc2(float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int amount, float *minMax, Control *control, Arena *arena);
+void _fgc2PrunedRegionOrientation(float complex *y1Hat, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int j, int amount, int x0, int y0, int width, int height, float *minMax, Arena *arena);
+int _fgc2RegionIsDirect(int n, int radius, int width, int height);
+void _fgc2Region(float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int amount, int x0, int y0, int width, int height, float *minMax, Control *control, Arena *arena);
+int _fgc2PaddedSize(float xi, float sigma, int width, int height);
+void _fgc2Padded(float *y1, int width, int height, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int amount, float *minMax, Control *control, Arena *arena);
+int _fgc2DecimatedSize(int n, float xi, float sigma, float lambda);
+void _fgc2DecimatedOrientation(float complex *y1Hat, float *yConvSum, int n, int m, float xi, float sigma, float lambda, float theta, int j, int amount, float *minMax, Arena *arena);
+void _fgc2Decimated(float *y1, float *yConvSum, int n, int m, float xi, float sigma, float lambda, float theta, int amount, float *minMax, Control *control, Arena *arena);
+int _fgc2Descriptor(float *y1, float *features, int n, float xi, float sigma, float lambda, float theta, int amount, int blocks, Arena *arena);
+
+size_t _fgc2ArenaSize(int n);
+size_t _fgc2InPlaceArenaSize(int n);
+size_t _fgc2PaddedArenaSize(int n, int width, int height);
+size_t _fgc2DecimatedArenaSize(int n, int m);
+size_t _fgc2DescriptorArenaSize(int n, int blocks);
+size_t _fgc2FilterSpectrumArenaSize(int n);
+size_t _fgc2SpectraArenaSize(int n);
+size_t _fgc2DirectRegionArenaSize(int radius, int width, int height);
+size_t _fgc2DirectArenaSize(int n, int radius);
+size_t _fgc2RegionArenaSize(int n, float xi, float sigma, int width, int height);
+size_t _fgc2TiledArenaSize(int radius, int tile);
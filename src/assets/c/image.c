@@ -0,0 +1,386 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "error.h"
+#include "image.h"
+
+/**
+ * Skips whitespace and comments of a PGM header.
+ */
+static void _skipPgmSpace(FILE *file) {
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        if (c == '#') {
+            while ((c = fgetc(file)) != EOF && c != '\n');
+        } else if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+            ungetc(c, file);
+            return;
+        }
+    }
+}
+
+/**
+ * Reads the header and the samples of a binary 8 or 16 bit PGM image (P5)
+ * without converting them, see _grayPgm. Returns 0 on success, otherwise the
+ * caller frees image->data.
+ */
+int _decodePgm(const char *path, PgmImage *image) {
+
+    *image = (PgmImage) {0, 0, 0, NULL};
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        _error("Error in PGM: Could not open %s.\n", path);
+        return 1;
+    }
+
+    int maxValue = 0;
+    char magic[3] = {0};
+    if (fread(magic, 1, 2, file) != 2 || magic[0] != 'P' || magic[1] != '5') {
+        _error("Error in PGM: %s is not a binary PGM image.\n", path);
+        fclose(file);
+        return 1;
+    }
+    _skipPgmSpace(file);
+    if (fscanf(file, "%d", &image->width) != 1) maxValue = -1;
+    _skipPgmSpace(file);
+    if (fscanf(file, "%d", &image->height) != 1) maxValue = -1;
+    _skipPgmSpace(file);
+    if (maxValue == 0 && fscanf(file, "%d", &maxValue) != 1) maxValue = -1;
+    fgetc(file);
+
+    if (maxValue <= 0 || maxValue > 65535 || image->width <= 0 || image->height <= 0) {
+        _error("Error in PGM: %s has an invalid header.\n", path);
+        fclose(file);
+        return 1;
+    }
+
+    size_t size = (size_t) image->width * image->height;
+    int bytes = maxValue > 255 ? 2 : 1;
+    image->maxValue = maxValue;
+    image->data = malloc(size * bytes);
+
+    if (image->data == NULL || fread(image->data, bytes, size, file) != size) {
+        _error("Error in PGM: %s is truncated.\n", path);
+        free(image->data);
+        image->data = NULL;
+        fclose(file);
+        return 1;
+    }
+    fclose(file);
+
+    return 0;
+
+}
+
+/**
+ * Converts the samples of a decoded PGM image into gray values in [0, 255].
+ */
+void _grayPgm(PgmImage *image, float *pixels) {
+
+    size_t size = (size_t) image->width * image->height;
+    const unsigned char *data = image->data;
+
+    // Scale to [0, 255], 16 bit values are big-endian
+    float scale = 255.0 / image->maxValue;
+    if (image->maxValue > 255) {
+        for (size_t i = 0; i < size; i++) {
+            pixels[i] = scale * ((data[2*i] << 8) | data[2*i+1]);
+        }
+    } else {
+        for (size_t i = 0; i < size; i++) {
+            pixels[i] = scale * data[i];
+        }
+    }
+
+}
+
+/**
+ * Reads a binary 8 or 16 bit PGM image (P5) into gray values in [0, 255].
+ * Returns NULL on failure, otherwise the caller frees the result.
+ */
+float *_readPgm(const char *path, int *width, int *height) {
+
+    PgmImage image;
+    if (_decodePgm(path, &image)) return NULL;
+
+    *width = image.width;
+    *height = image.height;
+    float *pixels = malloc((size_t) image.width * image.height * sizeof(float));
+    if (pixels != NULL) _grayPgm(&image, pixels);
+    free(image.data);
+
+    return pixels;
+
+}
+
+/**
+ * Writes an 8 bit binary PGM image (P5). Returns 0 on success.
+ */
+int _writePgm(const char *path, unsigned char *pixels, int width, int height) {
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        _error("Error in PGM: Could not write %s.\n", path);
+        return 1;
+    }
+
+    size_t size = (size_t) width * height;
+    fprintf(file, "P5\n%d %d\n255\n", width, height);
+    size_t written = fwrite(pixels, 1, size, file);
+    fclose(file);
+
+    return written != size;
+
+}
+
+/**
+ * Gets the bytes of a pixel of given type.
+ */
+static int _pixelBytes(int type) {
+    return type == PIXEL_F32 ? 4 : type == PIXEL_U16 ? 2 : 1;
+}
+
+/**
+ * Reads an unsigned integer of 2 or 4 bytes in the byte order of a TIFF file.
+ */
+static unsigned int _tiffValue(const unsigned char *p, int bytes, int bigEndian) {
+    unsigned int value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= (unsigned int) p[bigEndian ? i : bytes-1-i] << (8 * (bytes-1-i));
+    }
+    return value;
+}
+
+/**
+ * Parses the header of a binary PGM image in a mapped file. Returns 0 on
+ * success.
+ */
+static int _mapPgm(MappedImage *image) {
+
+    // The header is short, so parse it from a null-terminated copy
+    char header[256] = {0};
+    size_t length = image->mapSize < sizeof(header) - 1 ? image->mapSize : sizeof(header) - 1;
+    memcpy(header, image->map, length);
+
+    int maxValue = 0;
+    int offset = 0;
+    char *p = header + 2;
+    int values[3];
+    for (int k = 0; k < 3; k++) {
+        while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == '#') {
+            if (*p == '#') while (*p != '\0' && *p != '\n') p++;
+            else p++;
+        }
+        if (sscanf(p, "%d%n", &values[k], &offset) != 1) return 1;
+        p += offset;
+    }
+    image->width = values[0];
+    image->height = values[1];
+    maxValue = values[2];
+    if (maxValue <= 0 || maxValue > 65535) return 1;
+
+    image->type = maxValue > 255 ? PIXEL_U16 : PIXEL_U8;
+    image->bigEndian = 1;
+    image->scale = 255.0 / maxValue;
+    image->rowsPerStrip = image->height;
+    image->strips = 1;
+    image->stripOffsets = malloc(sizeof(size_t));
+    image->stripOffsets[0] = (p - header) + 1;
+
+    return 0;
+
+}
+
+/**
+ * Parses the first directory of an uncompressed gray scale TIFF image with
+ * strips of 8 or 16 bit integers or 32 bit floats in a mapped file. Returns 0
+ * on success.
+ */
+static int _mapTiff(MappedImage *image) {
+
+    const unsigned char *map = image->map;
+    size_t size = image->mapSize;
+    int bigEndian = map[0] == 'M';
+
+    size_t directory = _tiffValue(map + 4, 4, bigEndian);
+    if (directory + 2 > size) return 1;
+    int entries = _tiffValue(map + directory, 2, bigEndian);
+    if (directory + 2 + 12 * (size_t) entries > size) return 1;
+
+    int bits = 8, compression = 1, samples = 1, format = 1;
+    size_t offsetsPosition = 0;
+    int offsetsBytes = 4;
+    image->rowsPerStrip = 0;
+    image->strips = 0;
+
+    for (int e = 0; e < entries; e++) {
+        const unsigned char *entry = map + directory + 2 + 12 * e;
+        int tag = _tiffValue(entry, 2, bigEndian);
+        int bytes = _tiffValue(entry + 2, 2, bigEndian) == 3 ? 2 : 4;
+        unsigned int count = _tiffValue(entry + 4, 4, bigEndian);
+        unsigned int value = _tiffValue(entry + 8, bytes, bigEndian);
+        switch (tag) {
+            case 256: image->width = value; break;
+            case 257: image->height = value; break;
+            case 258: bits = value; break;
+            case 259: compression = value; break;
+            case 277: samples = value; break;
+            case 278: image->rowsPerStrip = value; break;
+            case 339: format = value; break;
+            case 273:
+                image->strips = count;
+                offsetsBytes = bytes;
+                offsetsPosition = count * bytes <= 4 ? (size_t) (entry + 8 - map) : _tiffValue(entry + 8, 4, bigEndian);
+                break;
+        }
+    }
+
+    if (compression != 1 || samples != 1 || image->strips < 1 || offsetsPosition + (size_t) image->strips * offsetsBytes > size) return 1;
+    if (bits == 8 && format == 1) image->type = PIXEL_U8;
+    else if (bits == 16 && format == 1) image->type = PIXEL_U16;
+    else if (bits == 32 && format == 3) image->type = PIXEL_F32;
+    else return 1;
+
+    if (image->rowsPerStrip <= 0 || image->rowsPerStrip > image->height) image->rowsPerStrip = image->height;
+    if (image->strips < (image->height + image->rowsPerStrip - 1) / image->rowsPerStrip) return 1;
+
+    image->bigEndian = bigEndian;
+    image->scale = image->type == PIXEL_U16 ? 255.0 / 65535 : 1;
+    image->stripOffsets = malloc(image->strips * sizeof(size_t));
+    for (int s = 0; s < image->strips; s++) {
+        image->stripOffsets[s] = _tiffValue(map + offsetsPosition + s * offsetsBytes, offsetsBytes, bigEndian);
+    }
+
+    return 0;
+
+}
+
+/**
+ * Maps a binary PGM image, an uncompressed gray scale TIFF image with strips,
+ * or, if raw is not NULL, raw pixel data into memory. Gray values of integer
+ * images are scaled to [0, 255] when read. Returns 0 on success.
+ */
+int _mapImage(const char *path, RawFormat *raw, MappedImage *image) {
+
+    memset(image, 0, sizeof(MappedImage));
+
+    int fd = open(path, O_RDONLY);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) != 0 || status.st_size < 8) {
+        _error("Error in image: Could not open %s.\n", path);
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+
+    image->mapSize = status.st_size;
+    image->map = mmap(NULL, image->mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image->map == MAP_FAILED) {
+        _error("Error in image: Could not map %s.\n", path);
+        image->map = NULL;
+        return 1;
+    }
+
+    // Rows are read one after the other
+    madvise(image->map, image->mapSize, MADV_SEQUENTIAL);
+
+    int failed;
+    if (raw != NULL) {
+        image->width = raw->width;
+        image->height = raw->height;
+        image->type = raw->type;
+        image->scale = raw->type == PIXEL_U16 ? 255.0 / 65535 : 1;
+        image->rowsPerStrip = raw->height;
+        image->strips = 1;
+        image->stripOffsets = calloc(1, sizeof(size_t));
+        failed = 0;
+    } else if (image->map[0] == 'P' && image->map[1] == '5') {
+        failed = _mapPgm(image);
+    } else if ((image->map[0] == 'I' && image->map[1] == 'I' && image->map[2] == 42) || (image->map[0] == 'M' && image->map[1] == 'M' && image->map[3] == 42)) {
+        failed = _mapTiff(image);
+    } else {
+        _error("Error in image: %s is neither a binary PGM nor a TIFF image.\n", path);
+        _unmapImage(image);
+        return 1;
+    }
+
+    // Check that all strips lie within the file
+    size_t rowBytes = (size_t) image->width * _pixelBytes(image->type);
+    for (int s = 0; !failed && s < image->strips; s++) {
+        int rows = image->height - s * image->rowsPerStrip;
+        rows = rows < image->rowsPerStrip ? rows : image->rowsPerStrip;
+        failed = rows > 0 && image->stripOffsets[s] + rows * rowBytes > image->mapSize;
+    }
+    if (failed || image->width <= 0 || image->height <= 0) {
+        _error("Error in image: %s has an invalid header or is truncated.\n", path);
+        _unmapImage(image);
+        return 1;
+    }
+
+    return 0;
+
+}
+
+/**
+ * Reads count gray values of row y of a mapped image starting at column x0,
+ * wrapping around the right edge.
+ */
+void _readMappedRow(MappedImage *image, int y, int x0, int count, float *values) {
+
+    int width = image->width;
+    int bytes = _pixelBytes(image->type);
+    const unsigned char *row = image->map + image->stripOffsets[y / image->rowsPerStrip]
+        + (size_t) (y % image->rowsPerStrip) * width * bytes;
+
+    int x = ((x0 % width) + width) % width;
+    for (int i = 0; i < count; i++) {
+        const unsigned char *p = row + (size_t) x * bytes;
+        if (image->type == PIXEL_U8) {
+            values[i] = image->scale * p[0];
+        } else if (image->type == PIXEL_U16) {
+            int v = image->bigEndian ? (p[0] << 8) | p[1] : (p[1] << 8) | p[0];
+            values[i] = image->scale * v;
+        } else {
+            unsigned char b[4] = {p[0], p[1], p[2], p[3]};
+            if (image->bigEndian) {
+                b[0] = p[3]; b[1] = p[2]; b[2] = p[1]; b[3] = p[0];
+            }
+            memcpy(&values[i], b, sizeof(float));
+        }
+        x = x + 1 < width ? x + 1 : 0;
+    }
+
+}
+
+/**
+ * Drops the resident pages of all rows before rowEnd, which are read from
+ * the file again if they are needed later.
+ */
+void _releaseMappedRows(MappedImage *image, int rowEnd) {
+
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t rowBytes = (size_t) image->width * _pixelBytes(image->type);
+
+    for (int s = 0; s < image->strips && s * image->rowsPerStrip < rowEnd; s++) {
+        int rows = rowEnd - s * image->rowsPerStrip;
+        rows = rows < image->rowsPerStrip ? rows : image->rowsPerStrip;
+        size_t start = (image->stripOffsets[s] + page - 1) / page * page;
+        size_t end = (image->stripOffsets[s] + rows * rowBytes) / page * page;
+        if (end > start) madvise(image->map + start, end - start, MADV_DONTNEED);
+    }
+
+}
+
+/**
+ * Unmaps an image.
+ */
+void _unmapImage(MappedImage *image) {
+    if (image->map != NULL) munmap(image->map, image->mapSize);
+    free(image->stripOffsets);
+    memset(image, 0, sizeof(MappedImage));
+}
@@ -0,0 +1,57 @@
+#include <stddef.h>
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#define PIXEL_U8 1
+#define PIXEL_U16 2
+#define PIXEL_F32 3
+
+/**
+ * The layout of raw pixel data without a header, in native byte order.
+ */
+typedef struct RawFormat {
+    int width;
+    int height;
+    int type;
+} RawFormat;
+
+/**
+ * The samples of a binary PGM image as stored in the file, of 1 byte each up
+ * to a maximum value of 255 and of 2 big-endian bytes otherwise.
+ */
+typedef struct PgmImage {
+    int width;
+    int height;
+    int maxValue;
+    unsigned char *data;
+} PgmImage;
+
+/**
+ * An image file mapped into memory, so that only the rows in use are
+ * resident. The rows are stored in strips of rowsPerStrip rows, which is a
+ * single strip for PGM and raw images.
+ */
+typedef struct MappedImage {
+    unsigned char *map;
+    size_t mapSize;
+    int width;
+    int height;
+    int type;
+    int bigEndian;
+    float scale;
+    int rowsPerStrip;
+    int strips;
+    size_t *stripOffsets;
+} MappedImage;
+
+int _decodePgm(const char *path, PgmImage *image);
+void _grayPgm(PgmImage *image, float *pixels);
+float *_readPgm(const char *path, int *width, int *height);
+int _writePgm(const char *path, unsigned char *pixels, int width, int height);
+int _mapImage(const char *path, RawFormat *raw, MappedImage *image);
+void _readMappedRow(MappedImage *image, int y, int x0, int count, float *values);
+void _releaseMappedRows(MappedImage *image, int rowEnd);
+void _unmapImage(MappedImage *image);
+
+#endif
@@ -1,15 +1,110 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <complex.h>
 #include <math.h>
+#ifdef __EMSCRIPTEN__
 #include <emscripten/emscripten.h>
+#else
+#define EMSCRIPTEN_KEEPALIVE
+#endif
+#include "arena.h"
+#include "batch.h"
+#include "control.h"
 #include "fourier.h"
 #include "gabor.h"
+#include "pixels.h"
+#include "recursive.h"
+#include "steerable.h"
+#include "transform.h"
+#include "tuner.h"
 
 void _printComplexArray(char *name, float complex z[], int size);
 void _printSquareMatrix(char *name, float *z, int size);
 void _printComplexSquareMatrix(char *name, float complex *z, int size);
 
+/**
+ * Arena holding all transient buffers of the public methods. It only grows if
+ * a call needs more memory than any call before and is reset after each call.
+ */
+static Arena sessionArena;
+
+/**
+ * Control block of the fgc2 calls, set by setControl, or NULL.
+ */
+static Control *sessionControl = NULL;
+
+/**
+ * Plans of the fgc2 shapes measured in this session or imported.
+ */
+static Wisdom sessionWisdom;
+
+/**
+ * Plan of a stepwise fgc2 call and its input, that is the spectrum of the
+ * input function for the Fourier method or a copy of it otherwise, kept in the
+ * session arena between fgc2Begin and fgc2End.
+ */
+static Plan sessionPlan;
+static float complex *sessionSpectrum = NULL;
+static float *sessionInput = NULL;
+
+/**
+ * Input function kept in the session by setImage and its spectrum, which is
+ * calculated on first use. Unlike the other session buffers, they live outside
+ * the session arena, so that they survive the calls until the next image.
+ */
+static float *sessionImage = NULL;
+static float complex *sessionImageSpectrum = NULL;
+static int sessionImageN = 0;
+
+/**
+ * Spectra of the filters of a stepwise batch, kept in the session arena
+ * between fgc2BatchBegin and fgc2BatchEnd.
+ */
+static float complex *sessionFilterSpectra = NULL;
+static int sessionBatchN = 0;
+static int sessionBatchAmount = 0;
+
+/**
+ * Gets the plan for a fgc2 shape from the session wisdom, measuring the
+ * strategies first if the shape is new. Returns 0 on success.
+ */
+static int _sessionPlan(Plan *plan, float *y1, int n, float xi, float sigma, float lambda, float theta, int amount) {
+
+    Plan *known = _wisdomFind(&sessionWisdom, n, _filterRadius(xi, sigma), amount);
+    if (known != NULL) {
+        *plan = *known;
+        return 0;
+    }
+
+    if (_arenaReserve(&sessionArena, _fgc2TuneArenaSize(n, xi, sigma))) return 1;
+    *plan = _fgc2Tune(&sessionWisdom, y1, n, xi, sigma, lambda, theta, amount, &sessionArena);
+    _arenaReset(&sessionArena);
+
+    return 0;
+
+}
+
+/**
+ * Public method that sets the control block of the following fgc2 calls, or
+ * NULL for none. The calls count their steps in it, that is the transform of
+ * the input and the orientations, or the images of a batch, and stop at the
+ * next step once its cancel flag is set, leaving the result incomplete. In
+ * shared memory, the caller can read the progress and cancel from another
+ * thread while a call is running.
+ */
+void EMSCRIPTEN_KEEPALIVE setControl(Control *control) {
+    sessionControl = control;
+}
+
+/**
+ * Public method that reserves the session arena for fgc2 calls of given size,
+ * so that following calls of that size never need to allocate.
+ */
+int EMSCRIPTEN_KEEPALIVE reserve(int n) {
+    return _arenaReserve(&sessionArena, _fgc2ArenaSize(n));
+}
+
 /**
  * Public method that calculates the 1D or 2D fast Fourier transform.
  */
@@ -20,19 +115,22 @@ void EMSCRIPTEN_KEEPALIVE fft(float *yReal, float *yImag, int m, int n) {
     int size = m;
     if (n > 1) size = m*n;
 
+    // Reserve the arena
+    size_t arenaSize = 2 * _arenaSize(size * sizeof(float complex));
+    arenaSize += n > 1 ? _fft2ArenaSize(m) : _fft1ArenaSize(m);
+    if (_arenaReserve(&sessionArena, arenaSize)) return;
+
     // Alloc complex vector
-    float complex *y = malloc(size * sizeof(float complex));
-    float complex *yHat = malloc(size * sizeof(float complex));
+    float complex *y = _arenaAlloc(&sessionArena, size * sizeof(float complex));
+    float complex *yHat = _arenaAlloc(&sessionArena, size * sizeof(float complex));
 
     for (int i = 0; i < size; i++) {
         y[i] = yReal[i] + yImag[i] * I;
     }
 
     // Do the transform
-    if (size == m) _fft1(y, yHat, m);
-    else _fft2(y, yHat, m);
-
-    free(y);
+    if (size == m) _fft1(y, yHat, m, &sessionArena);
+    else _fft2(y, yHat, m, &sessionArena);
 
     // Save back the data
     for (int i = 0; i < size; i++) {
@@ -40,7 +138,7 @@ void EMSCRIPTEN_KEEPALIVE fft(float *yReal, float *yImag, int m, int n) {
         yImag[i] = cimagf(yHat[i]);
     }
 
-    free(yHat);
+    _arenaReset(&sessionArena);
 
     printf("Done!\n");
 
@@ -56,10 +154,15 @@ void EMSCRIPTEN_KEEPALIVE conv(float *y1, float *y2, float *yConv, int m, int n)
     // Set dimension
     int size = m*n;
 
+    // Reserve the arena
+    size_t arenaSize = 3 * _arenaSize(size * sizeof(float complex));
+    arenaSize += n > 1 ? _conv2ArenaSize(m) : _conv1ArenaSize(m);
+    if (_arenaReserve(&sessionArena, arenaSize)) return;
+
     // Alloc data
-    float complex *y1C = malloc(size * sizeof(float complex));
-    float complex *y2C = malloc(size * sizeof(float complex));
-    float complex *yConvC = malloc(size * sizeof(float complex));
+    float complex *y1C = _arenaAlloc(&sessionArena, size * sizeof(float complex));
+    float complex *y2C = _arenaAlloc(&sessionArena, size * sizeof(float complex));
+    float complex *yConvC = _arenaAlloc(&sessionArena, size * sizeof(float complex));
 
     // Assign real value of data
     for (int i = 0; i < size; i++) {
@@ -69,20 +172,17 @@ void EMSCRIPTEN_KEEPALIVE conv(float *y1, float *y2, float *yConv, int m, int n)
 
     // Do the convolution
     if (n > 1) {
-        _conv2(y1C, y2C, yConvC, m);
+        _conv2(y1C, y2C, yConvC, m, &sessionArena);
     } else {
-        _conv1(y1C, y2C, yConvC, m);
+        _conv1(y1C, y2C, yConvC, m, &sessionArena);
     }
 
-    free(y1C);
-    free(y2C);
-
     // Assign real value of data
     for (int i = 0; i < size; i++) {
         yConv[i] = crealf(yConvC[i]);
     }
 
-    free(yConvC);
+    _arenaReset(&sessionArena);
 
     printf("Done!\n");
 
@@ -98,8 +198,11 @@ void EMSCRIPTEN_KEEPALIVE normalizedFilter2(float *gReal, float *gImag, int n, f
     // Set dimension
     int size = n*n;
 
+    // Reserve the arena
+    if (_arenaReserve(&sessionArena, _arenaSize(size * sizeof(float complex)))) return;
+
     // Alloc data
-    float complex *g = malloc(size * sizeof(float complex));
+    float complex *g = _arenaAlloc(&sessionArena, size * sizeof(float complex));
 
     // Get the filter
     _normalizedFilter2(g, n, xi, sigma, lambda, theta);
@@ -110,7 +213,7 @@ void EMSCRIPTEN_KEEPALIVE normalizedFilter2(float *gReal, float *gImag, int n, f
         gImag[i] = cimagf(g[i]);
     }
 
-    free(g);
+    _arenaReset(&sessionArena);
 
     printf("Done!\n");
 
@@ -118,69 +221,610 @@ void EMSCRIPTEN_KEEPALIVE normalizedFilter2(float *gReal, float *gImag, int n, f
 
 /**
  * Public method that calculates the 2D fast Gabor convolution of an input
- * function and a Gabor filter of given params.
+ * function and a Gabor filter of given params, with the fastest strategy for
+ * its shape.
  */
 void EMSCRIPTEN_KEEPALIVE fgc2(float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int amount) {
 
     printf("Launching C method...\n");
 
-    // Set dimension
-    int size = n*n;
+    Plan plan;
+    if (_sessionPlan(&plan, y1, n, xi, sigma, lambda, theta, amount)) return;
 
-    // Alloc data
-    float complex *y1C = malloc(size * sizeof(float complex));
+    // Reserve the arena
+    if (_arenaReserve(&sessionArena, _fgc2PlannedArenaSize(&plan))) return;
 
-    // Assign real value of data
-    for (int i = 0; i < size; i++) {
-        y1C[i] = y1[i];
+    _fgc2Planned(&plan, y1, yConvSum, n, xi, sigma, lambda, theta, amount, NULL, sessionControl, &sessionArena);
+
+    _arenaReset(&sessionArena);
+
+    printf("Done!\n");
+
+}
+
+/**
+ * Public method that calculates the 2D fast Gabor convolution like fgc2, but
+ * returns the result quantized to 8 or 16 bit levels. The range of the result
+ * is tracked while accumulating and saved into scale, such that level k stands
+ * for the value scale[0] + k*(scale[1]-scale[0])/(2^bits-1).
+ */
+void EMSCRIPTEN_KEEPALIVE fgc2Quantized(float *y1, void *levels, float *scale, int n, float xi, float sigma, float lambda, float theta, int amount, int bits) {
+
+    printf("Launching C method...\n");
+
+    Plan plan;
+    if (_sessionPlan(&plan, y1, n, xi, sigma, lambda, theta, amount)) return;
+
+    // Reserve the arena, including the unquantized sum
+    size_t sumSize = _arenaSize(n * n * sizeof(float));
+    if (_arenaReserve(&sessionArena, sumSize + _fgc2PlannedArenaSize(&plan))) return;
+
+    float *yConvSum = _arenaAlloc(&sessionArena, n * n * sizeof(float));
+    _fgc2Planned(&plan, y1, yConvSum, n, xi, sigma, lambda, theta, amount, scale, sessionControl, &sessionArena);
+    if (!_controlCancelled(sessionControl)) _quantize(yConvSum, levels, n * n, scale[0], scale[1], bits);
+
+    _arenaReset(&sessionArena);
+
+    printf("Done!\n");
+
+}
+
+/**
+ * Public method that calculates the 2D fast Gabor convolution like fgc2, but
+ * with a steerable basis of as few filters as approximate all orientations
+ * with a relative error of at most tolerance, which is much faster for many
+ * orientations. Returns the amount of basis filters or 0 on failure.
+ */
+int EMSCRIPTEN_KEEPALIVE fgc2Steerable(float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int amount, float tolerance) {
+
+    printf("Launching C method...\n");
+
+    // Reserve the arena for the rank first and then for the convolution
+    if (_arenaReserve(&sessionArena, _fgc2SteerableRankArenaSize(n, xi, sigma, amount))) return 0;
+    int rank = _fgc2SteerableRank(n, xi, sigma, lambda, theta, amount, tolerance, &sessionArena);
+    if (_arenaReserve(&sessionArena, _fgc2SteerableArenaSize(n, xi, sigma, amount, rank))) return 0;
+
+    _fgc2Steerable(y1, yConvSum, n, xi, sigma, lambda, theta, amount, rank, NULL, sessionControl, &sessionArena);
+
+    _arenaReset(&sessionArena);
+
+    printf("Done!\n");
+
+    return rank;
+
+}
+
+/**
+ * Public method that calculates the 2D fast Gabor convolution like fgc2, but
+ * only in the region of width*height values starting at column x and row y,
+ * which is saved into yConvSum with rows of length width.
+ */
+void EMSCRIPTEN_KEEPALIVE fgc2Region(float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int amount, int x, int y, int width, int height) {
+
+    printf("Launching C method...\n");
+
+    // Reserve the arena
+    if (_arenaReserve(&sessionArena, _fgc2RegionArenaSize(n, xi, sigma, width, height))) return;
+
+    _fgc2Region(y1, yConvSum, n, xi, sigma, lambda, theta, amount, x, y, width, height, NULL, sessionControl, &sessionArena);
+
+    _arenaReset(&sessionArena);
+
+    printf("Done!\n");
+
+}
+
+/**
+ * Public method that calculates the 2D fast Gabor convolution of an image of
+ * any width*height, which is zero-padded to the next power of 2 instead of
+ * cropped. The result in yConvSum is of width*height as well.
+ */
+void EMSCRIPTEN_KEEPALIVE fgc2Padded(float *y1, float *yConvSum, int width, int height, float xi, float sigma, float lambda, float theta, int amount) {
+
+    printf("Launching C method...\n");
+
+    // Reserve the arena
+    int n = _fgc2PaddedSize(xi, sigma, width, height);
+    if (_arenaReserve(&sessionArena, _fgc2PaddedArenaSize(n, width, height))) return;
+
+    _fgc2Padded(y1, width, height, yConvSum, n, xi, sigma, lambda, theta, amount, NULL, sessionControl, &sessionArena);
+
+    _arenaReset(&sessionArena);
+
+    printf("Done!\n");
+
+}
+
+/**
+ * Public method that calculates the 2D fast Gabor convolution like fgc2, but
+ * with the fastest strategy whose transient memory fits into budget bytes,
+ * e.g. the transforms in place with two matrices of n*n complex values instead
+ * of several. Returns 0 on success or 1 if no strategy fits.
+ */
+int EMSCRIPTEN_KEEPALIVE fgc2Budget(float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int amount, size_t budget) {
+
+    printf("Launching C method...\n");
+
+    // Choose the strategy and reserve the arena
+    Plan plan;
+    if (_fgc2Budget(&plan, n, xi, sigma, amount, budget)) return 1;
+    if (_arenaReserve(&sessionArena, _fgc2PlannedArenaSize(&plan))) return 1;
+
+    _fgc2Planned(&plan, y1, yConvSum, n, xi, sigma, lambda, theta, amount, NULL, sessionControl, &sessionArena);
+
+    _arenaReset(&sessionArena);
+
+    printf("Done!\n");
+
+    return 0;
+
+}
+
+/**
+ * Public method that calculates the 2D Gabor convolution of an image of any
+ * width*height by recursive filters, whose cost per pixel does not depend on
+ * sigma. The result in yConvSum is of width*height as well. Returns 0 on
+ * success or 1 if sigma is too small for the recursive filters.
+ */
+int EMSCRIPTEN_KEEPALIVE fgc2Recursive(float *y1, float *yConvSum, int width, int height, float xi, float sigma, float lambda, float theta, int amount) {
+
+    printf("Launching C method...\n");
+
+    // Reserve the arena
+    if (_arenaReserve(&sessionArena, _fgc2RecursiveArenaSize(width, height, xi, sigma))) return 1;
+
+    int status = _fgc2Recursive(y1, yConvSum, width, height, xi, sigma, lambda, theta, amount, NULL, sessionControl, &sessionArena);
+
+    _arenaReset(&sessionArena);
+
+    printf("Done!\n");
+
+    return status;
+
+}
+
+/**
+ * Public method that gets the size m of the decimated result of fgc2Decimated.
+ */
+int EMSCRIPTEN_KEEPALIVE fgc2DecimatedSize(int n, float xi, float sigma, float lambda) {
+    return _fgc2DecimatedSize(n, xi, sigma, lambda);
+}
+
+/**
+ * Public method that calculates the 2D fast Gabor convolution like fgc2, but
+ * only from the passband of the filters, so that the inverse transforms are of
+ * size m*m, see fgc2DecimatedSize. The result in yConvSum is the magnitude at
+ * every n/m-th row and column, or upsampled to n*n for display if upsample is
+ * set. Returns m.
+ */
+int EMSCRIPTEN_KEEPALIVE fgc2Decimated(float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int amount, int upsample) {
+
+    printf("Launching C method...\n");
+
+    // Reserve the arena, with the decimated result if it is upsampled
+    int m = _fgc2DecimatedSize(n, xi, sigma, lambda);
+    size_t resultSize = upsample ? _arenaSize((size_t) m * m * sizeof(float)) : 0;
+    if (_arenaReserve(&sessionArena, resultSize + _fgc2DecimatedArenaSize(n, m))) return 0;
+
+    float *decimated = upsample ? _arenaAlloc(&sessionArena, m * m * sizeof(float)) : yConvSum;
+    _fgc2Decimated(y1, decimated, n, m, xi, sigma, lambda, theta, amount, NULL, sessionControl, &sessionArena);
+    if (upsample) _upsample(decimated, m, yConvSum, n);
+
+    _arenaReset(&sessionArena);
+
+    printf("Done!\n");
+
+    return m;
+
+}
+
+/**
+ * Public method that gets the shape of the coefficients of fgt2, that is the
+ * rows and columns of the lattice and the size of the local transforms, saved
+ * into shape. Returns 0 on success.
+ */
+int EMSCRIPTEN_KEEPALIVE fgt2Shape(int width, int height, float sigma, int step, int *shape) {
+
+    Lattice lattice;
+    if (_fgt2Lattice(&lattice, width, height, sigma, step)) return 1;
+
+    shape[0] = lattice.rows;
+    shape[1] = lattice.cols;
+    shape[2] = lattice.size;
+
+    return 0;
+
+}
+
+/**
+ * Public method that calculates the 2D Gabor transform of an image of
+ * width*height with Gaussian windows of given sigma every step pixels on a
+ * pool of threads. The coefficients are saved as [rows][cols][size][size][2]
+ * floats with real and imaginary part, see fgt2Shape. Returns 0 on success.
+ */
+int EMSCRIPTEN_KEEPALIVE fgt2(float *f, float *coefficients, int width, int height, float sigma, int step, int threads) {
+
+    printf("Launching C method...\n");
+
+    // Get the lattice and reserve the arena
+    Lattice lattice;
+    if (_fgt2Lattice(&lattice, width, height, sigma, step)) return 1;
+    if (_arenaReserve(&sessionArena, _fgt2ArenaSize(&lattice))) return 1;
+
+    int failed = _fgt2(&lattice, f, (float complex *) coefficients, threads, sessionControl, &sessionArena);
+
+    _arenaReset(&sessionArena);
+
+    printf("Done!\n");
+
+    return failed;
+
+}
+
+/**
+ * Public method that calculates the inverse of fgt2 with the same params and
+ * saves the image into f. Returns 0 on success.
+ */
+int EMSCRIPTEN_KEEPALIVE ifgt2(float *coefficients, float *f, int width, int height, float sigma, int step, int threads) {
+
+    printf("Launching C method...\n");
+
+    // Get the lattice and reserve the arena
+    Lattice lattice;
+    if (_fgt2Lattice(&lattice, width, height, sigma, step)) return 1;
+    if (_arenaReserve(&sessionArena, _ifgt2ArenaSize(&lattice))) return 1;
+
+    int failed = _ifgt2(&lattice, (float complex *) coefficients, f, threads, sessionControl, &sessionArena);
+
+    _arenaReset(&sessionArena);
+
+    printf("Done!\n");
+
+    return failed;
+
+}
+
+/**
+ * Public method that calculates a Gabor texture descriptor of an input
+ * function, that is the mean and variance of the magnitude of each of the
+ * amount filter responses pooled over blocks*blocks blocks. The features are
+ * saved as [amount][blocks][blocks][2]. Returns 0 on success or 1 if the
+ * blocks do not divide n.
+ */
+int EMSCRIPTEN_KEEPALIVE fgc2Descriptor(float *y1, float *features, int n, float xi, float sigma, float lambda, float theta, int amount, int blocks) {
+
+    printf("Launching C method...\n");
+
+    // Reserve the arena
+    if (_arenaReserve(&sessionArena, _fgc2DescriptorArenaSize(n, blocks))) return 1;
+
+    int status = _fgc2Descriptor(y1, features, n, xi, sigma, lambda, theta, amount, blocks, &sessionArena);
+
+    _arenaReset(&sessionArena);
+
+    printf("Done!\n");
+
+    return status;
+
+}
+
+/**
+ * Public method that starts a stepwise 2D fast Gabor convolution by choosing
+ * the strategy for its shape and calculating the spectrum of the input
+ * function, if needed. The orientations are then calculated one by one with
+ * fgc2Orientation, so that the caller can report progress or cancel between
+ * them, and fgc2End releases the input. The steps are counted in the control
+ * block like in fgc2.
+ */
+int EMSCRIPTEN_KEEPALIVE fgc2Begin(float *y1, int n, float xi, float sigma, float lambda, float theta, int amount) {
+
+    printf("Launching C method...\n");
+
+    _arenaReset(&sessionArena);
+    if (_sessionPlan(&sessionPlan, y1, n, xi, sigma, lambda, theta, amount)) return 1;
+
+    // Reserve the arena
+    size_t inputSize = sessionPlan.strategy == STRATEGY_FFT ? 0 : _arenaSize(n * n * sizeof(float));
+    if (_arenaReserve(&sessionArena, inputSize + _fgc2PlannedArenaSize(&sessionPlan))) return 1;
+
+    if (sessionPlan.strategy == STRATEGY_FFT) {
+        _controlBegin(sessionControl, amount + 1);
+        sessionSpectrum = _arenaAlloc(&sessionArena, n * n * sizeof(float complex));
+        _fgc2Spectrum(y1, sessionSpectrum, n, &sessionArena);
+        _controlStep(sessionControl);
+    } else {
+        _controlBegin(sessionControl, amount);
+        sessionInput = _arenaAlloc(&sessionArena, n * n * sizeof(float));
+        memcpy(sessionInput, y1, n * n * sizeof(float));
     }
 
-    // Calculate Fourier transform of y1C First
-    float complex *y1Hat = malloc(n * n * sizeof(float complex));
-    _fft2(y1C, y1Hat, n);
+    return 0;
 
-    free(y1C);
+}
 
-    for (int j = 0; j < amount; j++) {
+/**
+ * Public method that frees the input function kept in the session and its
+ * spectrum.
+ */
+void EMSCRIPTEN_KEEPALIVE clearImage() {
+    free(sessionImage);
+    free(sessionImageSpectrum);
+    sessionImage = NULL;
+    sessionImageSpectrum = NULL;
+    sessionImageN = 0;
+}
+
+/**
+ * Public method that allocates the input function of size n*n kept in the
+ * session, which replaces the previous one along with its spectrum. The caller
+ * fills the returned buffer, which may then be passed as input to the other
+ * methods without copying it and is used by fgc2BeginImage. Returns NULL on
+ * failure.
+ */
+float* EMSCRIPTEN_KEEPALIVE setImage(int n) {
 
-        // Alloc data
-        float complex *y2 = malloc(size * sizeof(float complex));
-        float complex *yConv = malloc(size * sizeof(float complex));
-        float complex *yConvShifted = malloc(size * sizeof(float complex));
+    clearImage();
 
-        // Get filter data
-        float pi = acos(-1.0);
-        _normalizedFilter2(y2, n, xi, sigma, lambda, theta + pi*j/amount);
+    sessionImage = malloc((size_t) n * n * sizeof(float));
+    if (sessionImage == NULL) {
+        printf("Error in setImage: Could not allocate the image.\n");
+        return NULL;
+    }
+    sessionImageN = n;
 
-        _conv2Hat(y2, y1Hat, yConv, n);
+    return sessionImage;
 
-        free(y2);
+}
 
-        // Shift the values
-        _translate2(yConv, yConvShifted, n, n/2, n/2);
+/**
+ * Public method that starts a stepwise 2D fast Gabor convolution like
+ * fgc2Begin, but of the input function kept in the session by setImage. With
+ * the Fourier method, its spectrum is only calculated by the first call, so
+ * that following calls with other params only need the filters and the
+ * inverse transforms. The transform of the input still counts as a step.
+ */
+int EMSCRIPTEN_KEEPALIVE fgc2BeginImage(float xi, float sigma, float lambda, float theta, int amount) {
 
-        free(yConv);
+    printf("Launching C method...\n");
 
-        float *yConvShiftedAbs = malloc(size * sizeof(float));
+    if (sessionImage == NULL) {
+        printf("Error in fgc2BeginImage: setImage has not been called.\n");
+        return 1;
+    }
 
-        // Assign real value of data
-        for (int i = 0; i < size; i++) {
-            yConvShiftedAbs[i] = cabsf(yConvShifted[i]);
-            if (j == 0) yConvSum[i] = yConvShiftedAbs[i];
-            else yConvSum[i] += yConvShiftedAbs[i];
+    int n = sessionImageN;
+    _arenaReset(&sessionArena);
+    if (_sessionPlan(&sessionPlan, sessionImage, n, xi, sigma, lambda, theta, amount)) return 1;
+
+    // Reserve the arena
+    if (_arenaReserve(&sessionArena, _fgc2PlannedArenaSize(&sessionPlan))) return 1;
+
+    if (sessionPlan.strategy == STRATEGY_FFT) {
+        _controlBegin(sessionControl, amount + 1);
+        if (sessionImageSpectrum == NULL) {
+            sessionImageSpectrum = malloc((size_t) n * n * sizeof(float complex));
+            if (sessionImageSpectrum == NULL) {
+                printf("Error in fgc2BeginImage: Could not allocate the spectrum.\n");
+                return 1;
+            }
+            _fgc2Spectrum(sessionImage, sessionImageSpectrum, n, &sessionArena);
         }
+        sessionSpectrum = sessionImageSpectrum;
+        _controlStep(sessionControl);
+    } else {
+        _controlBegin(sessionControl, amount);
+        sessionInput = sessionImage;
+    }
 
-        free(yConvShifted);
-        free(yConvShiftedAbs);
+    return 0;
 
+}
+
+/**
+ * Public method that adds orientation j of a stepwise 2D fast Gabor
+ * convolution to yConvSum, which is overwritten for j = 0. If minMax is not
+ * NULL, the range of yConvSum is saved into it.
+ */
+void EMSCRIPTEN_KEEPALIVE fgc2Orientation(float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int j, int amount, float *minMax) {
+
+    if (sessionSpectrum == NULL && sessionInput == NULL) {
+        printf("Error in fgc2Orientation: fgc2Begin has not been called.\n");
+        return;
     }
 
-    free(y1Hat);
+    _fgc2PlanOrientation(&sessionPlan, sessionInput, sessionSpectrum, yConvSum, n, xi, sigma, lambda, theta, j, amount, minMax, &sessionArena);
+    _controlStep(sessionControl);
+
+}
+
+/**
+ * Public method that ends a stepwise 2D fast Gabor convolution. The input
+ * function kept by setImage is not released.
+ */
+void EMSCRIPTEN_KEEPALIVE fgc2End() {
+
+    sessionSpectrum = NULL;
+    sessionInput = NULL;
+    _arenaReset(&sessionArena);
 
     printf("Done!\n");
 
 }
 
+/**
+ * Public method that calculates the 2D fast Gabor convolution of count images
+ * of size n*n with the same filter params, saved one after the other into
+ * images, and saves the results one after the other into results. The
+ * spectra of the filters are calculated once for all images, which are spread
+ * over the given amount of threads if threads are available.
+ */
+int EMSCRIPTEN_KEEPALIVE fgc2Batch(float *images, float *results, int count, int n, float xi, float sigma, float lambda, float theta, int amount, int threads) {
+
+    printf("Launching C method...\n");
+
+    Plan plan;
+    if (_sessionPlan(&plan, images, n, xi, sigma, lambda, theta, amount)) return 1;
+
+    // Reserve the arena
+    if (_arenaReserve(&sessionArena, _fgc2BatchArenaSize(&plan))) return 1;
+
+    int failed = _fgc2Batch(&plan, images, results, count, n, xi, sigma, lambda, theta, amount, threads, NULL, NULL, sessionControl, &sessionArena);
+
+    _arenaReset(&sessionArena);
+
+    printf("Done!\n");
+
+    return failed;
+
+}
+
+/**
+ * Public method that starts a stepwise batch of 2D fast Gabor convolutions of
+ * images of size n*n with the same filter params by calculating the spectra
+ * of the filters. The images are then calculated one by one with
+ * fgc2BatchImage, so that the caller gets each result right away, and
+ * fgc2BatchEnd releases the spectra.
+ */
+int EMSCRIPTEN_KEEPALIVE fgc2BatchBegin(int n, float xi, float sigma, float lambda, float theta, int amount) {
+
+    printf("Launching C method...\n");
+
+    // Reserve the arena, dropping the spectra of an earlier batch that it held
+    _arenaReset(&sessionArena);
+    sessionFilterSpectra = NULL;
+    size_t spectraSize = _arenaSize((size_t) amount * n * n * sizeof(float complex));
+    size_t filterSize = _fgc2FilterSpectrumArenaSize(n);
+    size_t imageSize = _fgc2SpectraArenaSize(n);
+    if (_arenaReserve(&sessionArena, spectraSize + (filterSize > imageSize ? filterSize : imageSize))) return 1;
+
+    sessionFilterSpectra = _arenaAlloc(&sessionArena, (size_t) amount * n * n * sizeof(float complex));
+    for (int j = 0; j < amount; j++) {
+        _fgc2FilterSpectrum(&sessionFilterSpectra[(size_t) j * n * n], n, xi, sigma, lambda, theta, j, amount, &sessionArena);
+    }
+    sessionBatchN = n;
+    sessionBatchAmount = amount;
+
+    return 0;
+
+}
+
+/**
+ * Public method that calculates the 2D fast Gabor convolution of an image of
+ * a stepwise batch. If minMax is not NULL, the range of the result is saved
+ * into it.
+ */
+void EMSCRIPTEN_KEEPALIVE fgc2BatchImage(float *y1, float *yConvSum, float *minMax) {
+
+    if (sessionFilterSpectra == NULL) {
+        printf("Error in fgc2BatchImage: fgc2BatchBegin has not been called.\n");
+        return;
+    }
+
+    _fgc2Spectra(y1, sessionFilterSpectra, yConvSum, sessionBatchN, sessionBatchAmount, minMax, &sessionArena);
+
+}
+
+/**
+ * Public method that ends a stepwise batch of 2D fast Gabor convolutions.
+ */
+void EMSCRIPTEN_KEEPALIVE fgc2BatchEnd() {
+
+    sessionFilterSpectra = NULL;
+    _arenaReset(&sessionArena);
+
+    printf("Done!\n");
+
+}
+
+/**
+ * Public method that adds the fgc2 plans of a wisdom text, as exported by
+ * exportWisdom, so that their shapes need not be measured again. Returns the
+ * amount of plans added.
+ */
+int EMSCRIPTEN_KEEPALIVE importWisdom(const char *text) {
+    return _wisdomImport(&sessionWisdom, text);
+}
+
+/**
+ * Public method that gets the fgc2 plans of this session as text, one plan
+ * per line.
+ */
+const char* EMSCRIPTEN_KEEPALIVE exportWisdom() {
+    static char text[WISDOM_CAPACITY * 64];
+    _wisdomExport(&sessionWisdom, text, sizeof(text));
+    return text;
+}
+
+/**
+ * Public method that converts RGBA pixels to gray values.
+ */
+void EMSCRIPTEN_KEEPALIVE grayScale(unsigned char *rgba, float *gray, int size) {
+    _rgbaToGray(rgba, gray, size);
+}
+
+/**
+ * Public method that converts RGBA pixels to gray RGBA pixels in place.
+ */
+void EMSCRIPTEN_KEEPALIVE toGrayScale(unsigned char *rgba, int size) {
+
+    if (_arenaReserve(&sessionArena, _arenaSize(size * sizeof(float)))) return;
+
+    float *gray = _arenaAlloc(&sessionArena, size * sizeof(float));
+    _rgbaToGray(rgba, gray, size);
+    _grayToRgba(gray, rgba, size, 0, 1);
+
+    _arenaReset(&sessionArena);
+
+}
+
+/**
+ * Public method that converts gray values to gray RGBA pixels. The values are
+ * shifted by their minimum and, if adjustScale is set, scaled to the full range.
+ */
+void EMSCRIPTEN_KEEPALIVE grayScaleToRgba(float *gray, unsigned char *rgba, int size, int adjustScale) {
+
+    float min, max;
+    _minMax(gray, size, &min, &max);
+    float scale = max > min && adjustScale ? 256.0 / (max - min) : 1;
+
+    _grayToRgba(gray, rgba, size, min, scale);
+
+}
+
+/**
+ * Public method that converts values to RGBA pixels of a color scale from
+ * blue (minimum) to red (maximum).
+ */
+void EMSCRIPTEN_KEEPALIVE colorScaleToRgba(float *pixels, unsigned char *rgba, int size) {
+
+    float min, max;
+    _minMax(pixels, size, &min, &max);
+
+    _colorScaleToRgba(pixels, rgba, size, min, max);
+
+}
+
+/**
+ * Public method that quantizes values to 8 or 16 bit levels. If track is set,
+ * the range of the values is determined and saved into scale first, otherwise
+ * the range given in scale is used.
+ */
+void EMSCRIPTEN_KEEPALIVE quantize(float *values, void *levels, float *scale, int size, int bits, int track) {
+
+    if (track) _minMax(values, size, &scale[0], &scale[1]);
+
+    _quantize(values, levels, size, scale[0], scale[1], bits);
+
+}
+
+/**
+ * Public method that converts 8 or 16 bit levels to gray RGBA pixels with
+ * value scale*level.
+ */
+void EMSCRIPTEN_KEEPALIVE levelsToRgba(void *levels, int bits, unsigned char *rgba, int size, float scale) {
+    _levelsToRgba(levels, bits, rgba, size, scale);
+}
+
 ///////////////////
 // OTHER METHODS //
 ///////////////////
@@ -0,0 +1,1217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <complex.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "arena.h"
+#include "batch.h"
+#include "cache.h"
+#include "gabor.h"
+#include "image.h"
+#include "pipeline.h"
+#include "pixels.h"
+#include "queue.h"
+#include "recursive.h"
+#include "steerable.h"
+#include "stream.h"
+#include "transform.h"
+#include "tuner.h"
+#include "video.h"
+
+/**
+ * Params of a native run, with the same defaults as the web application.
+ */
+typedef struct Options {
+    float xi;
+    float sigma;
+    float lambda;
+    float theta;
+    int amount;
+    int blocks;
+    int region[4];
+    const char *cacheDirectory;
+    size_t cacheLimit;
+    const char *wisdomPath;
+    int threads;
+    int tile;
+    RawFormat raw;
+    int pad;
+    float tolerance;
+    int recursive;
+    size_t budget;
+    int decimate;
+    int step;
+    const char *manifestPath;
+    int processes;
+    int pipeline[6];
+    int videoTile;
+    float videoThreshold;
+} Options;
+
+/**
+ * Images of the same size waiting to be calculated as a batch, with the paths
+ * and cache keys of their results.
+ */
+typedef struct PendingImages {
+    int n;
+    int count;
+    int capacity;
+    float *images;
+    const char **outputs;
+    char (*keys)[256];
+    ResultCache *cache;
+    int failures;
+    pthread_mutex_t lock;
+} PendingImages;
+
+/**
+ * The spectra of the filters for the images of size n, which a worker keeps
+ * between images, so that each image only needs its own transforms.
+ */
+typedef struct FilterSpectra {
+    int n;
+    float complex *y2Hats;
+} FilterSpectra;
+
+/**
+ * An image passing through the stages of the pipeline. Each stage frees what
+ * the previous one left once it is done with it. A cached result skips the
+ * transform stages.
+ */
+typedef struct PipelineImage {
+    const char *input;
+    const char *output;
+    PgmImage pgm;
+    int n;
+    float *pixels;
+    float complex *y1Hat;
+    float *result;
+    int cached;
+    char key[256];
+} PipelineImage;
+
+/**
+ * The state the stages of the pipeline share: the params, the cache, which is
+ * not thread-safe and thus locked, and the arenas of the threads of the
+ * transform stages along with the spectra of the filters each filter thread
+ * keeps.
+ */
+typedef struct PipelineState {
+    Options *options;
+    ResultCache *cache;
+    pthread_mutex_t lock;
+    Arena *spectrumArenas;
+    Arena *filterArenas;
+    FilterSpectra *spectra;
+} PipelineState;
+
+/**
+ * The pairs of input and output images of a manifest.
+ */
+typedef struct Manifest {
+    int count;
+    char **inputs;
+    char **outputs;
+    unsigned int key;
+} Manifest;
+
+/**
+ * Prints the usage of the native program.
+ */
+static void _printUsage(const char *program) {
+    printf("Usage: %s [options] input.pgm output.pgm [input.pgm output.pgm ...]\n", program);
+    printf("       %s [options] --manifest FILE [--processes P]\n", program);
+    printf("Calculates the 2D fast Gabor convolution of square PGM images of size 2^k.\n\n");
+    printf("  --xi X          dilation in x or y (default 0.5)\n");
+    printf("  --sigma S       width (default 1)\n");
+    printf("  --lambda L      wavelength of the sinusoid part (default 4)\n");
+    printf("  --theta T       original angle in degrees (default 0)\n");
+    printf("  --amount A      amount of rotations considered (default 1)\n");
+    printf("  --descriptor B  write the texture descriptor instead of the image, that is\n");
+    printf("                  the mean and variance of each filter response pooled over\n");
+    printf("                  B*B blocks, B = 2^k, as float32 array [amount][B][B][2]\n");
+    printf("  --region X,Y,W,H\n");
+    printf("                  calculate only the W*H pixels starting at column X and\n");
+    printf("                  row Y, which is cheap for small regions\n");
+    printf("  --tile T        stream images of any size tile by tile with T*T Fourier\n");
+    printf("                  transforms, so that the memory does not depend on the\n");
+    printf("                  image size; the input may also be a gray scale TIFF\n");
+    printf("                  image with strips, the output is a raw float32 array\n");
+    printf("  --raw W,H,TYPE  read the input of --tile as raw W*H pixels of TYPE u8,\n");
+    printf("                  u16 or f32\n");
+    printf("  --steerable E   convolve with a steerable basis of as few filters as\n");
+    printf("                  approximate all orientations with a relative error of\n");
+    printf("                  at most E, e.g. 0.05, which is faster for many rotations\n");
+    printf("  --pad           accept images of any size, which are zero-padded to the\n");
+    printf("                  next power of 2 that leaves room for the filter\n");
+    printf("  --recursive     accept images of any size, which are filtered by recursive\n");
+    printf("                  Gaussians at a cost that does not depend on sigma, within\n");
+    printf("                  5%% of the Fourier method for sigma >= 3 along either axis\n");
+    printf("                  and 2 <= lambda <= 3 sigma, within 10%% for sigma >= 1.5\n");
+    printf("  --budget M      calculate with the fastest strategy that needs at most M\n");
+    printf("                  MiB of transient memory, e.g. in place or tiled\n");
+    printf("  --decimate      write only every k-th row and column of the result, which\n");
+    printf("                  is calculated from the passband of the filters with\n");
+    printf("                  small inverse transforms; k grows with sigma\n");
+    printf("  --transform K   write the 2D Gabor transform of an image of any size with\n");
+    printf("                  Gaussian windows of width sigma every K pixels, with K\n");
+    printf("                  at most 4*sigma, as float32 array [rows][cols][M][M][2]\n");
+    printf("                  of local transforms of size M on T threads\n");
+    printf("  --manifest FILE calculate the pairs of input and output images in FILE,\n");
+    printf("                  one pair per line; the progress is kept in FILE.state,\n");
+    printf("                  so that an interrupted run resumes where it stopped\n");
+    printf("  --processes P   calculate the manifest on P worker processes, which\n");
+    printf("                  steal images from each other when they run out\n");
+    printf("  --pipeline D,G,F,M,E[,Q]\n");
+    printf("                  pass the images through stages with their own threads:\n");
+    printf("                  D to decode, G to convert to gray values, F for the\n");
+    printf("                  Fourier transforms, M to multiply with the filters and\n");
+    printf("                  transform back and E to quantize and encode, with queues\n");
+    printf("                  of Q images between them (default 4); prints the\n");
+    printf("                  throughput, the busy time and the queue depth per stage\n");
+    printf("  --incremental T[,E]\n");
+    printf("                  treat the images as frames of a video: each frame only\n");
+    printf("                  recalculates the T*T tiles whose mean absolute change\n");
+    printf("                  exceeds E gray values (default 0) and the tiles within\n");
+    printf("                  the filter radius of them, and keeps the rest\n");
+    printf("  --cache DIR     cache results in DIR\n");
+    printf("  --cache-size M  maximum size of the cache in MiB (default 1024)\n");
+    printf("  --threads T     calculate T images of the same size at a time, sharing the\n");
+    printf("                  spectra of the filters (default 1)\n");
+    printf("  --wisdom FILE   keep the fastest strategy measured for each shape in FILE,\n");
+    printf("                  so that later runs need not measure it again\n");
+}
+
+/**
+ * Parses the command line options. Returns the index of the first file or -1.
+ */
+static int _parseOptions(int argc, char **argv, Options *options) {
+
+    static struct option longOptions[] = {
+        {"xi", required_argument, NULL, 'x'},
+        {"sigma", required_argument, NULL, 's'},
+        {"lambda", required_argument, NULL, 'l'},
+        {"theta", required_argument, NULL, 't'},
+        {"amount", required_argument, NULL, 'a'},
+        {"descriptor", required_argument, NULL, 'd'},
+        {"region", required_argument, NULL, 'r'},
+        {"cache", required_argument, NULL, 'c'},
+        {"cache-size", required_argument, NULL, 'm'},
+        {"wisdom", required_argument, NULL, 'w'},
+        {"threads", required_argument, NULL, 'p'},
+        {"tile", required_argument, NULL, 'T'},
+        {"raw", required_argument, NULL, 'R'},
+        {"pad", no_argument, NULL, 'P'},
+        {"steerable", required_argument, NULL, 'S'},
+        {"recursive", no_argument, NULL, 'I'},
+        {"budget", required_argument, NULL, 'B'},
+        {"decimate", no_argument, NULL, 'D'},
+        {"transform", required_argument, NULL, 'G'},
+        {"manifest", required_argument, NULL, 'M'},
+        {"processes", required_argument, NULL, 'N'},
+        {"pipeline", required_argument, NULL, 'L'},
+        {"incremental", required_argument, NULL, 'V'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    *options = (Options) {0.5, 1, 4, 0, 1, 0, {0, 0, 0, 0}, NULL, (size_t) 1024 << 20, NULL, 1, 0, {0, 0, 0}, 0, 0, 0, 0, 0, 0, NULL, 1, {0, 0, 0, 0, 0, 4}, 0, 0};
+
+    int c;
+    while ((c = getopt_long(argc, argv, "h", longOptions, NULL)) != -1) {
+        switch (c) {
+            case 'x': options->xi = atof(optarg); break;
+            case 's': options->sigma = atof(optarg); break;
+            case 'l': options->lambda = atof(optarg); break;
+            case 't': options->theta = -2 * acos(-1.0) * atof(optarg) / 360; break;
+            case 'a': options->amount = atoi(optarg); break;
+            case 'd': options->blocks = atoi(optarg); break;
+            case 'r':
+                if (sscanf(optarg, "%d,%d,%d,%d", &options->region[0], &options->region[1], &options->region[2], &options->region[3]) != 4) return -1;
+                break;
+            case 'c': options->cacheDirectory = optarg; break;
+            case 'm': options->cacheLimit = (size_t) atol(optarg) << 20; break;
+            case 'w': options->wisdomPath = optarg; break;
+            case 'p': options->threads = atoi(optarg); break;
+            case 'T': options->tile = atoi(optarg); break;
+            case 'P': options->pad = 1; break;
+            case 'S': options->tolerance = atof(optarg); break;
+            case 'I': options->recursive = 1; break;
+            case 'B': options->budget = (size_t) atol(optarg) << 20; break;
+            case 'D': options->decimate = 1; break;
+            case 'G': options->step = atoi(optarg); break;
+            case 'M': options->manifestPath = optarg; break;
+            case 'N': options->processes = atoi(optarg); break;
+            case 'V':
+                if (sscanf(optarg, "%d,%f", &options->videoTile, &options->videoThreshold) < 1 || options->videoTile < 1) return -1;
+                break;
+            case 'L': {
+                int *p = options->pipeline;
+                int values = sscanf(optarg, "%d,%d,%d,%d,%d,%d", &p[0], &p[1], &p[2], &p[3], &p[4], &p[5]);
+                if (values < 5 || p[0] < 1 || p[1] < 1 || p[2] < 1 || p[3] < 1 || p[4] < 1 || p[5] < 1) return -1;
+                break;
+            }
+            case 'R': {
+                char type[4] = {0};
+                if (sscanf(optarg, "%d,%d,%3s", &options->raw.width, &options->raw.height, type) != 3) return -1;
+                options->raw.type = strcmp(type, "u8") == 0 ? PIXEL_U8 : strcmp(type, "u16") == 0 ? PIXEL_U16 : strcmp(type, "f32") == 0 ? PIXEL_F32 : 0;
+                if (options->raw.type == 0) return -1;
+                break;
+            }
+            default: return -1;
+        }
+    }
+
+    // The modes choose what is calculated and how, so at most one of them may be given
+    const char *modeNames[] = {"--descriptor", "--region", "--tile", "--pad", "--steerable", "--recursive", "--budget", "--decimate", "--transform", "--pipeline", "--incremental"};
+    int modeSet[] = {options->blocks > 0, options->region[2] > 0, options->tile > 0, options->pad, options->tolerance > 0, options->recursive,
+        options->budget > 0, options->decimate, options->step > 0, options->pipeline[0] > 0, options->videoTile > 0};
+    int modes = 0;
+    for (int m = 0; m < (int) (sizeof(modeSet) / sizeof(modeSet[0])); m++) {
+        modes += modeSet[m];
+    }
+    if (modes > 1) {
+        printf("Error: Only one of");
+        for (int m = 0; m < (int) (sizeof(modeNames) / sizeof(modeNames[0])); m++) printf(" %s", modeNames[m]);
+        printf(" may be given.\n");
+        return -1;
+    }
+
+    if (options->raw.type != 0 && options->tile == 0) return -1;
+    if (options->tolerance < 0 || options->step < 0) return -1;
+    if (options->processes < 1 || (options->manifestPath == NULL && options->processes > 1)) return -1;
+    if (options->manifestPath != NULL && (options->tile > 0 || options->step > 0 || options->pipeline[0] > 0 || options->videoTile > 0 || options->threads > 1 || argc > optind)) return -1;
+    if ((options->pipeline[0] > 0 || options->videoTile > 0) && options->threads > 1) return -1;
+    if (options->videoTile > 0 && (options->cacheDirectory != NULL || options->videoThreshold < 0)) return -1;
+
+    int files = options->manifestPath == NULL ? argc - optind : 2;
+    if (options->amount < 1 || options->threads < 1 || options->blocks < 0 || (options->blocks & (options->blocks - 1)) || files < 2 || files % 2 != 0) return -1;
+
+    return optind;
+
+}
+
+/**
+ * Writes an array of floats to a file. Returns 0 on success.
+ */
+static int _writeFloats(const char *path, float *data, size_t count) {
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        printf("Error: Could not write %s.\n", path);
+        return 1;
+    }
+
+    size_t written = fwrite(data, sizeof(float), count, file);
+    fclose(file);
+
+    return written != count;
+
+}
+
+/**
+ * Writes a result as 8 bit image, quantized to its full range. Returns 0 on
+ * success.
+ */
+static int _writeImage(const char *path, float *result, int width, int height) {
+
+    size_t size = (size_t) width * height;
+    float min, max;
+    unsigned char *levels = malloc(size);
+    _minMax(result, size, &min, &max);
+    _quantize(result, levels, size, min, max, 8);
+
+    int written = _writePgm(path, levels, width, height);
+    free(levels);
+
+    return written;
+
+}
+
+/**
+ * Calculates the spectra of the filters for images of size n, unless they are
+ * kept for that size already. Returns 0 on success.
+ */
+static int _updateSpectra(FilterSpectra *spectra, int n, Options *options, Arena *arena) {
+
+    if (spectra->n == n) return 0;
+
+    free(spectra->y2Hats);
+    spectra->n = 0;
+    spectra->y2Hats = malloc((size_t) options->amount * n * n * sizeof(float complex));
+    if (spectra->y2Hats == NULL || _arenaReserve(arena, _fgc2FilterSpectrumArenaSize(n))) return 1;
+
+    for (int j = 0; j < options->amount; j++) {
+        _fgc2FilterSpectrum(&spectra->y2Hats[(size_t) j * n * n], n, options->xi, options->sigma, options->lambda, options->theta, j, options->amount, arena);
+    }
+    spectra->n = n;
+
+    return 0;
+
+}
+
+/**
+ * Calculates the texture descriptor if blocks are given, the region if one is
+ * given, the Gabor convolution of the zero-padded image if pad is set, by
+ * recursive filters if recursive is set, with a steerable basis if a tolerance
+ * is given, decimated if decimate is set, or else the Gabor convolution of the
+ * whole image with the fastest strategy for its shape, or within the budget if
+ * one is given. If spectra
+ * are given and the fastest strategy is the Fourier method, the spectra of the
+ * filters are kept in them for the next image of the same size. Returns 0 on
+ * success.
+ */
+static int _calculate(float *pixels, float *result, int width, int height, Options *options, Wisdom *wisdom, FilterSpectra *spectra, Arena *arena) {
+
+    int *region = options->region;
+    int n = width;
+
+    if (options->pad) {
+        n = _fgc2PaddedSize(options->xi, options->sigma, width, height);
+        if (_arenaReserve(arena, _fgc2PaddedArenaSize(n, width, height))) return 1;
+        _fgc2Padded(pixels, width, height, result, n, options->xi, options->sigma, options->lambda, options->theta, options->amount, NULL, NULL, arena);
+    } else if (options->recursive) {
+        if (_arenaReserve(arena, _fgc2RecursiveArenaSize(width, height, options->xi, options->sigma))) return 1;
+        if (_fgc2Recursive(pixels, result, width, height, options->xi, options->sigma, options->lambda, options->theta, options->amount, NULL, NULL, arena)) return 1;
+    } else if (options->tolerance > 0) {
+        if (_arenaReserve(arena, _fgc2SteerableRankArenaSize(n, options->xi, options->sigma, options->amount))) return 1;
+        int rank = _fgc2SteerableRank(n, options->xi, options->sigma, options->lambda, options->theta, options->amount, options->tolerance, arena);
+        if (_arenaReserve(arena, _fgc2SteerableArenaSize(n, options->xi, options->sigma, options->amount, rank))) return 1;
+        _fgc2Steerable(pixels, result, n, options->xi, options->sigma, options->lambda, options->theta, options->amount, rank, NULL, NULL, arena);
+    } else if (options->blocks > 0) {
+        if (_arenaReserve(arena, _fgc2DescriptorArenaSize(n, options->blocks))) return 1;
+        if (_fgc2Descriptor(pixels, result, n, options->xi, options->sigma, options->lambda, options->theta, options->amount, options->blocks, arena)) return 1;
+    } else if (region[2] > 0) {
+        if (_arenaReserve(arena, _fgc2RegionArenaSize(n, options->xi, options->sigma, region[2], region[3]))) return 1;
+        _fgc2Region(pixels, result, n, options->xi, options->sigma, options->lambda, options->theta, options->amount, region[0], region[1], region[2], region[3], NULL, NULL, arena);
+    } else if (options->decimate) {
+        int m = _fgc2DecimatedSize(n, options->xi, options->sigma, options->lambda);
+        if (_arenaReserve(arena, _fgc2DecimatedArenaSize(n, m))) return 1;
+        _fgc2Decimated(pixels, result, n, m, options->xi, options->sigma, options->lambda, options->theta, options->amount, NULL, NULL, arena);
+    } else if (options->budget > 0) {
+        Plan plan;
+        if (_fgc2Budget(&plan, n, options->xi, options->sigma, options->amount, options->budget)) return 1;
+        if (_arenaReserve(arena, _fgc2PlannedArenaSize(&plan))) return 1;
+        _fgc2Planned(&plan, pixels, result, n, options->xi, options->sigma, options->lambda, options->theta, options->amount, NULL, NULL, arena);
+    } else {
+        // Choose the strategy, which is measured on the first image of a shape
+        if (_arenaReserve(arena, _fgc2TuneArenaSize(n, options->xi, options->sigma))) return 1;
+        Plan plan = _fgc2Tune(wisdom, pixels, n, options->xi, options->sigma, options->lambda, options->theta, options->amount, arena);
+        if (spectra != NULL && plan.strategy == STRATEGY_FFT) {
+            if (_updateSpectra(spectra, n, options, arena)) return 1;
+            if (_arenaReserve(arena, _fgc2SpectraArenaSize(n))) return 1;
+            _fgc2Spectra(pixels, spectra->y2Hats, result, n, options->amount, NULL, arena);
+        } else {
+            if (_arenaReserve(arena, _fgc2PlannedArenaSize(&plan))) return 1;
+            _fgc2Planned(&plan, pixels, result, n, options->xi, options->sigma, options->lambda, options->theta, options->amount, NULL, NULL, arena);
+        }
+    }
+
+    _arenaReset(arena);
+    return 0;
+
+}
+
+/**
+ * Calculates the Gabor convolution of one image and writes it as normalized
+ * 8 bit image, or its texture descriptor if blocks are given. The cache is
+ * consulted first, if given. Returns 0 on success.
+ */
+static int _processImage(const char *input, const char *output, Options *options, ResultCache *cache, Wisdom *wisdom, FilterSpectra *spectra, Arena *arena) {
+
+    int width, height;
+    float *pixels = _readPgm(input, &width, &height);
+    if (pixels == NULL) return 1;
+
+    int n = width;
+    if (!options->pad && !options->recursive && (width != height || n < 2 || (n & (n-1)) || options->blocks > n || (options->blocks > 0 && n % options->blocks != 0))) {
+        printf("Error in %s: Image must be of size n*n with n = 2^k and divisible by the blocks.\n", input);
+        free(pixels);
+        return 1;
+    }
+
+    // The result is the sum of magnitudes, of the region or decimated if given, or the descriptor
+    int *region = options->region;
+    if (region[2] > 0 && (region[0] < 0 || region[1] < 0 || region[3] < 1 || region[0] + region[2] > n || region[1] + region[3] > n)) {
+        printf("Error in %s: Region must lie within the image.\n", input);
+        free(pixels);
+        return 1;
+    }
+    int resultWidth = region[2] > 0 ? region[2] : width;
+    int resultHeight = region[2] > 0 ? region[3] : height;
+    if (options->decimate) {
+        resultWidth = _fgc2DecimatedSize(n, options->xi, options->sigma, options->lambda);
+        resultHeight = resultWidth;
+    }
+    size_t size = (size_t) resultWidth * resultHeight;
+    int blocks = options->blocks;
+    size_t resultSize = blocks > 0 ? (size_t) options->amount * blocks * blocks * 2 : size;
+    float *result = malloc(resultSize * sizeof(float));
+
+    char hash[17], key[256];
+    _hashPixels(pixels, (size_t) width * height, hash);
+    _fgc2CacheKey(key, sizeof(key), hash, n, options->xi, options->sigma, options->lambda, options->theta, options->amount);
+    if (blocks > 0) snprintf(key + strlen(key), sizeof(key) - strlen(key), "-descriptor-%d", blocks);
+    if (options->pad) snprintf(key + strlen(key), sizeof(key) - strlen(key), "-padded-%d-%d", width, height);
+    if (options->recursive) snprintf(key + strlen(key), sizeof(key) - strlen(key), "-recursive-%d-%d", width, height);
+    if (options->tolerance > 0) snprintf(key + strlen(key), sizeof(key) - strlen(key), "-steerable-%g", options->tolerance);
+    if (options->decimate) snprintf(key + strlen(key), sizeof(key) - strlen(key), "-decimated-%d", resultWidth);
+    if (region[2] > 0) {
+        snprintf(key + strlen(key), sizeof(key) - strlen(key), "-region-%d-%d-%d-%d", region[0], region[1], region[2], region[3]);
+    }
+
+    if (cache == NULL || _cacheLoad(cache, key, result, resultSize * sizeof(float)) != 0) {
+        if (_calculate(pixels, result, width, height, options, wisdom, spectra, arena)) {
+            free(pixels);
+            free(result);
+            return 1;
+        }
+        if (cache != NULL) _cacheStore(cache, key, result, resultSize * sizeof(float));
+    }
+    free(pixels);
+
+    if (blocks > 0) {
+        int written = _writeFloats(output, result, resultSize);
+        free(result);
+        return written;
+    }
+
+    int written = _writeImage(output, result, resultWidth, resultHeight);
+    free(result);
+
+    return written;
+
+}
+
+/**
+ * Calculates the Gabor convolution of a mapped image of any size tile by tile
+ * and writes it as raw floats. Returns 0 on success.
+ */
+static int _streamImage(const char *input, const char *output, Options *options, Arena *arena) {
+
+    MappedImage image;
+    if (_mapImage(input, options->raw.type != 0 ? &options->raw : NULL, &image)) return 1;
+
+    int radius = _filterRadius(options->xi, options->sigma);
+    int failed = _arenaReserve(arena, _fgc2StreamArenaSize(options->amount, radius, options->tile));
+    if (!failed) {
+        failed = _fgc2Stream(&image, output, options->xi, options->sigma, options->lambda, options->theta, options->amount, options->tile, arena);
+    }
+
+    _arenaReset(arena);
+    _unmapImage(&image);
+
+    return failed;
+
+}
+
+/**
+ * Calculates the 2D Gabor transform of an image of any size on
+ * options->threads threads and writes its coefficients as raw floats.
+ * Returns 0 on success.
+ */
+static int _transformImage(const char *input, const char *output, Options *options, Arena *arena) {
+
+    int width, height;
+    float *pixels = _readPgm(input, &width, &height);
+    if (pixels == NULL) return 1;
+
+    Lattice lattice;
+    if (_fgt2Lattice(&lattice, width, height, options->sigma, options->step) || _arenaReserve(arena, _fgt2ArenaSize(&lattice))) {
+        free(pixels);
+        return 1;
+    }
+
+    size_t count = _fgt2Count(&lattice);
+    float complex *coefficients = malloc(count * sizeof(float complex));
+    if (coefficients == NULL) {
+        printf("Error in %s: Could not allocate %zu coefficients.\n", input, count);
+        free(pixels);
+        return 1;
+    }
+
+    int failed = _fgt2(&lattice, pixels, coefficients, options->threads, NULL, arena);
+    if (!failed) {
+        printf("Coefficients of %s: [%d][%d][%d][%d][2]\n", input, lattice.rows, lattice.cols, lattice.size, lattice.size);
+        failed = _writeFloats(output, (float *) coefficients, 2 * count);
+    }
+
+    _arenaReset(arena);
+    free(coefficients);
+    free(pixels);
+
+    return failed;
+
+}
+
+/**
+ * Writes the result of a pending image and caches it. Called by the threads
+ * of the batch.
+ */
+static void _writePendingImage(int index, float *yConvSum, void *data) {
+
+    PendingImages *pending = data;
+    int failed = _writeImage(pending->outputs[index], yConvSum, pending->n, pending->n);
+
+    // The cache is not thread-safe
+    pthread_mutex_lock(&pending->lock);
+    if (pending->cache != NULL) _cacheStore(pending->cache, pending->keys[index], yConvSum, (size_t) pending->n * pending->n * sizeof(float));
+    pending->failures += failed != 0;
+    pthread_mutex_unlock(&pending->lock);
+
+}
+
+/**
+ * Calculates the pending images as a batch with the fastest strategy for
+ * their shape and writes their results. Returns 0 on success.
+ */
+static int _flushPendingImages(PendingImages *pending, Options *options, Wisdom *wisdom, Arena *arena) {
+
+    if (pending->count == 0) return 0;
+
+    int n = pending->n;
+    int count = pending->count;
+    pending->count = 0;
+
+    // Choose the strategy, which is measured on the first image of a shape
+    if (_arenaReserve(arena, _fgc2TuneArenaSize(n, options->xi, options->sigma))) return count;
+    Plan plan = _fgc2Tune(wisdom, pending->images, n, options->xi, options->sigma, options->lambda, options->theta, options->amount, arena);
+    if (_arenaReserve(arena, _fgc2BatchArenaSize(&plan))) return count;
+
+    int failed = _fgc2Batch(&plan, pending->images, NULL, count, n, options->xi, options->sigma, options->lambda, options->theta,
+                            options->amount, options->threads, _writePendingImage, pending, NULL, arena);
+    _arenaReset(arena);
+
+    return failed ? count : 0;
+
+}
+
+/**
+ * Calculates the Gabor convolution of images like _processImage, but collects
+ * consecutive images of the same size that are not cached and calculates them
+ * as a batch on options->threads threads. Returns the amount of failures.
+ */
+static int _processImages(char **files, int pairs, Options *options, ResultCache *cache, Wisdom *wisdom, Arena *arena) {
+
+    PendingImages pending = {0, 0, 4 * options->threads, NULL, NULL, NULL, cache, 0};
+    pending.outputs = malloc(pending.capacity * sizeof(char *));
+    pending.keys = malloc(pending.capacity * sizeof(*pending.keys));
+    pthread_mutex_init(&pending.lock, NULL);
+    int failures = 0;
+
+    for (int p = 0; p < pairs; p++) {
+
+        const char *input = files[2*p];
+        const char *output = files[2*p+1];
+
+        int width, height;
+        float *pixels = _readPgm(input, &width, &height);
+        if (pixels == NULL) {
+            failures++;
+            continue;
+        }
+
+        int n = width;
+        if (width != height || n < 2 || (n & (n-1))) {
+            printf("Error in %s: Image must be of size n*n with n = 2^k.\n", input);
+            free(pixels);
+            failures++;
+            continue;
+        }
+
+        char hash[17], key[256];
+        size_t size = (size_t) n * n;
+        _hashPixels(pixels, size, hash);
+        _fgc2CacheKey(key, sizeof(key), hash, n, options->xi, options->sigma, options->lambda, options->theta, options->amount);
+
+        // Write cached results right away, which reuses the pixels
+        if (cache != NULL && _cacheLoad(cache, key, pixels, size * sizeof(float)) == 0) {
+            failures += _writeImage(output, pixels, n, n) != 0;
+            free(pixels);
+            continue;
+        }
+
+        // A batch holds images of one size only
+        if (pending.count == pending.capacity || (pending.count > 0 && n != pending.n)) {
+            failures += _flushPendingImages(&pending, options, wisdom, arena);
+        }
+        if (n != pending.n) {
+            free(pending.images);
+            pending.images = malloc(pending.capacity * size * sizeof(float));
+            pending.n = n;
+        }
+
+        memcpy(&pending.images[pending.count * size], pixels, size * sizeof(float));
+        pending.outputs[pending.count] = output;
+        strcpy(pending.keys[pending.count], key);
+        pending.count++;
+        free(pixels);
+
+    }
+
+    failures += _flushPendingImages(&pending, options, wisdom, arena);
+    failures += pending.failures;
+
+    pthread_mutex_destroy(&pending.lock);
+    free(pending.images);
+    free(pending.outputs);
+    free(pending.keys);
+
+    return failures;
+
+}
+
+/**
+ * Decodes a PGM image of the pipeline, which must be of size n*n with
+ * n = 2^k. Returns 0 on success.
+ */
+static int _decodeStage(void *item, int thread, void *data) {
+
+    PipelineImage *image = item;
+    if (_decodePgm(image->input, &image->pgm)) return 1;
+
+    int n = image->pgm.width;
+    if (image->pgm.height != n || n < 2 || (n & (n-1))) {
+        printf("Error in %s: Image must be of size n*n with n = 2^k.\n", image->input);
+        return 1;
+    }
+    image->n = n;
+
+    return 0;
+
+}
+
+/**
+ * Converts a decoded image of the pipeline into gray values and looks up its
+ * result in the cache, if any. Returns 0 on success.
+ */
+static int _grayStage(void *item, int thread, void *data) {
+
+    PipelineImage *image = item;
+    PipelineState *state = data;
+    Options *options = state->options;
+    size_t size = (size_t) image->n * image->n;
+
+    image->pixels = malloc(size * sizeof(float));
+    if (image->pixels == NULL) return 1;
+    _grayPgm(&image->pgm, image->pixels);
+    free(image->pgm.data);
+    image->pgm.data = NULL;
+
+    if (state->cache == NULL) return 0;
+
+    char hash[17];
+    _hashPixels(image->pixels, size, hash);
+    _fgc2CacheKey(image->key, sizeof(image->key), hash, image->n, options->xi, options->sigma, options->lambda, options->theta, options->amount);
+
+    image->result = malloc(size * sizeof(float));
+    if (image->result == NULL) return 1;
+    pthread_mutex_lock(&state->lock);
+    image->cached = _cacheLoad(state->cache, image->key, image->result, size * sizeof(float)) == 0;
+    pthread_mutex_unlock(&state->lock);
+
+    if (image->cached) {
+        free(image->pixels);
+        image->pixels = NULL;
+    }
+
+    return 0;
+
+}
+
+/**
+ * Calculates the spectrum of an image of the pipeline in the arena of the
+ * thread. Returns 0 on success.
+ */
+static int _spectrumStage(void *item, int thread, void *data) {
+
+    PipelineImage *image = item;
+    PipelineState *state = data;
+    if (image->cached) return 0;
+
+    int n = image->n;
+    Arena *arena = &state->spectrumArenas[thread];
+    image->y1Hat = malloc((size_t) n * n * sizeof(float complex));
+    if (image->y1Hat == NULL || _arenaReserve(arena, _fgc2FilterSpectrumArenaSize(n))) return 1;
+
+    _fgc2Spectrum(image->pixels, image->y1Hat, n, arena);
+    _arenaReset(arena);
+    free(image->pixels);
+    image->pixels = NULL;
+
+    return 0;
+
+}
+
+/**
+ * Multiplies the spectrum of an image of the pipeline with the spectra of the
+ * filters, which the thread keeps for its last size, transforms each product
+ * back and sums up the magnitudes. The result is cached, if a cache is given.
+ * Returns 0 on success.
+ */
+static int _filterStage(void *item, int thread, void *data) {
+
+    PipelineImage *image = item;
+    PipelineState *state = data;
+    if (image->cached) return 0;
+
+    int n = image->n;
+    size_t size = (size_t) n * n;
+    Arena *arena = &state->filterArenas[thread];
+    FilterSpectra *spectra = &state->spectra[thread];
+    if (_updateSpectra(spectra, n, state->options, arena) || _arenaReserve(arena, _fgc2SpectraArenaSize(n))) return 1;
+
+    if (image->result == NULL) image->result = malloc(size * sizeof(float));
+    if (image->result == NULL) return 1;
+    for (int j = 0; j < state->options->amount; j++) {
+        _fgc2SpectrumOrientation(image->y1Hat, &spectra->y2Hats[(size_t) j * size], image->result, n, j, NULL, arena);
+    }
+    _arenaReset(arena);
+    free(image->y1Hat);
+    image->y1Hat = NULL;
+
+    if (state->cache != NULL) {
+        pthread_mutex_lock(&state->lock);
+        _cacheStore(state->cache, image->key, image->result, size * sizeof(float));
+        pthread_mutex_unlock(&state->lock);
+    }
+
+    return 0;
+
+}
+
+/**
+ * Quantizes the result of an image of the pipeline and writes it as 8 bit
+ * image. Returns 0 on success.
+ */
+static int _encodeStage(void *item, int thread, void *data) {
+
+    PipelineImage *image = item;
+    int failed = _writeImage(image->output, image->result, image->n, image->n);
+    free(image->result);
+    image->result = NULL;
+
+    return failed;
+
+}
+
+/**
+ * Prints what the stages of a pipeline measured and which stage is the
+ * bottleneck, that is the one whose threads were busy the largest share of the
+ * time. The queue is the one in front of the stage, with its mean and maximum
+ * depth when items were added.
+ */
+static void _printPipelineReport(Stage *stages, int count, double seconds, int depth) {
+
+    printf("%-10s %7s %7s %6s %9s %5s %9s %9s %11s\n", "stage", "threads", "images", "failed", "images/s", "busy", "starved", "blocked", "queue");
+
+    int bottleneck = 0;
+    double most = -1;
+    for (int s = 0; s < count; s++) {
+        Stage *stage = &stages[s];
+        double busy = seconds > 0 ? stage->busy / (stage->threads * seconds) : 0;
+        double meanDepth = stage->queue.pushes > 0 ? (double) stage->queue.depthSum / stage->queue.pushes : 0;
+        printf("%-10s %7d %7ld %6ld %9.1f %4.0f%% %8.2fs %8.2fs %4.1f %2d/%-2d\n",
+            stage->name, stage->threads, stage->done, stage->failed, seconds > 0 ? stage->done / seconds : 0, 100 * busy,
+            stage->starved, stage->blocked, meanDepth, stage->queue.maxDepth, depth);
+        if (busy > most) {
+            most = busy;
+            bottleneck = s;
+        }
+    }
+
+    printf("Bottleneck: %s, busy %.0f%% of %.2f s.\n", stages[bottleneck].name, 100 * most, seconds);
+
+}
+
+/**
+ * Calculates the Gabor convolution of images with the Fourier method in a
+ * pipeline of stages with the threads given by options->pipeline, so that
+ * the images are decoded and encoded while others are transformed. Returns
+ * the amount of failures.
+ */
+static int _pipelineImages(char **files, int pairs, Options *options, ResultCache *cache) {
+
+    int *threads = options->pipeline;
+    PipelineImage *images = calloc(pairs, sizeof(PipelineImage));
+    void **items = malloc(pairs * sizeof(void *));
+    PipelineState state = {options, cache};
+    state.spectrumArenas = calloc(threads[2], sizeof(Arena));
+    state.filterArenas = calloc(threads[3], sizeof(Arena));
+    state.spectra = calloc(threads[3], sizeof(FilterSpectra));
+    if (images == NULL || items == NULL || state.spectrumArenas == NULL || state.filterArenas == NULL || state.spectra == NULL) {
+        printf("Error in pipeline: Could not allocate %d images.\n", pairs);
+        free(images);
+        free(items);
+        free(state.spectrumArenas);
+        free(state.filterArenas);
+        free(state.spectra);
+        return pairs;
+    }
+    pthread_mutex_init(&state.lock, NULL);
+
+    for (int p = 0; p < pairs; p++) {
+        images[p].input = files[2*p];
+        images[p].output = files[2*p+1];
+        items[p] = &images[p];
+    }
+
+    Stage stages[5] = {
+        {"decode", threads[0], _decodeStage, &state},
+        {"grayscale", threads[1], _grayStage, &state},
+        {"fft", threads[2], _spectrumStage, &state},
+        {"filter", threads[3], _filterStage, &state},
+        {"encode", threads[4], _encodeStage, &state}
+    };
+    double seconds;
+    int failures = _pipelineRun(stages, 5, items, pairs, threads[5], &seconds);
+    _printPipelineReport(stages, 5, seconds, threads[5]);
+
+    // Failed images keep what their last stage left
+    for (int p = 0; p < pairs; p++) {
+        free(images[p].pgm.data);
+        free(images[p].pixels);
+        free(images[p].y1Hat);
+        free(images[p].result);
+    }
+    for (int t = 0; t < threads[2]; t++) {
+        _arenaDestroy(&state.spectrumArenas[t]);
+    }
+    for (int t = 0; t < threads[3]; t++) {
+        _arenaDestroy(&state.filterArenas[t]);
+        free(state.spectra[t].y2Hats);
+    }
+    pthread_mutex_destroy(&state.lock);
+    free(state.spectrumArenas);
+    free(state.filterArenas);
+    free(state.spectra);
+    free(items);
+    free(images);
+
+    return failures;
+
+}
+
+/**
+ * Calculates the Gabor convolution of the frames of a video, given as pairs
+ * of input and output images of the same size n*n in order, incrementally:
+ * each frame only recalculates the tiles that changed and their halo. Returns
+ * the amount of failures.
+ */
+static int _processVideo(char **files, int pairs, Options *options, Arena *arena) {
+
+    Video video = {0};
+    int failures = 0;
+
+    for (int p = 0; p < pairs; p++) {
+
+        const char *input = files[2*p];
+        const char *output = files[2*p+1];
+
+        int width, height;
+        float *pixels = _readPgm(input, &width, &height);
+        if (pixels == NULL) {
+            failures++;
+            continue;
+        }
+
+        if (video.input == NULL || width != video.n || height != video.n) {
+            if (video.input != NULL) {
+                printf("Error in %s: Frame must be of the size %d of the first frame.\n", input, video.n);
+                free(pixels);
+                failures++;
+                continue;
+            }
+            if (width != height || _videoOpen(&video, width, options->xi, options->sigma, options->lambda, options->theta, options->amount, options->videoTile, options->videoThreshold)) {
+                printf("Error in %s: Frame must be of size n*n with n = 2^k and at least the tile.\n", input);
+                free(pixels);
+                return pairs;
+            }
+        }
+
+        int recalculated = _videoFrame(&video, pixels, arena);
+        free(pixels);
+        if (recalculated < 0) {
+            failures++;
+            continue;
+        }
+        printf("Frame %d: %d of %d tiles recalculated.\n", video.frames, recalculated, video.tiles * video.tiles);
+
+        failures += _writeImage(output, video.result, video.n, video.n) != 0;
+
+    }
+
+    if (video.frames > 0) {
+        int total = video.frames * video.tiles * video.tiles;
+        printf("Recalculated %d of %d tiles of %d frames (%.1f%%), %d of them changed.\n",
+            video.recalculatedTiles, total, video.frames, 100.0 * video.recalculatedTiles / total, video.dirtyTiles);
+    }
+    _videoClose(&video);
+
+    return failures;
+
+}
+
+/**
+ * Reads a manifest of one pair of input and output paths per line, separated
+ * by white space. Empty lines and lines starting with # are skipped. The key
+ * is a hash of the manifest and the options that change the results, so that
+ * a changed run is not resumed. Returns 0 on success.
+ */
+static int _readManifest(const char *path, Options *options, Manifest *manifest) {
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        printf("Error in %s: Could not open manifest.\n", path);
+        return 1;
+    }
+
+    *manifest = (Manifest) {0, NULL, NULL, 0x811c9dc5u};
+    int capacity = 0;
+    char line[2048], input[1024], output[1024];
+    while (fgets(line, sizeof(line), file) != NULL) {
+
+        if (line[0] == '#' || sscanf(line, "%1023s %1023s", input, output) < 1) continue;
+        if (sscanf(line, "%1023s %1023s", input, output) != 2) {
+            printf("Error in %s: Line without output: %s", path, line);
+            fclose(file);
+            return 1;
+        }
+
+        if (manifest->count == capacity) {
+            capacity = capacity > 0 ? 2 * capacity : 256;
+            manifest->inputs = realloc(manifest->inputs, capacity * sizeof(char *));
+            manifest->outputs = realloc(manifest->outputs, capacity * sizeof(char *));
+        }
+        manifest->inputs[manifest->count] = strdup(input);
+        manifest->outputs[manifest->count] = strdup(output);
+        manifest->count++;
+
+        for (const char *c = line; *c != '\0'; c++) {
+            manifest->key = (manifest->key ^ (unsigned char) *c) * 0x01000193u;
+        }
+
+    }
+    fclose(file);
+
+    char params[256];
+    snprintf(params, sizeof(params), "%.9g %.9g %.9g %.9g %d %d %d %d %d %d %d %d %d %.9g %d",
+        options->xi, options->sigma, options->lambda, options->theta, options->amount, options->blocks,
+        options->region[0], options->region[1], options->region[2], options->region[3], options->pad, options->recursive,
+        (int) (options->budget >> 20), options->tolerance, options->decimate);
+    for (const char *c = params; *c != '\0'; c++) {
+        manifest->key = (manifest->key ^ (unsigned char) *c) * 0x01000193u;
+    }
+
+    return 0;
+
+}
+
+/**
+ * Frees the paths of a manifest.
+ */
+static void _freeManifest(Manifest *manifest) {
+    for (int i = 0; i < manifest->count; i++) {
+        free(manifest->inputs[i]);
+        free(manifest->outputs[i]);
+    }
+    free(manifest->inputs);
+    free(manifest->outputs);
+}
+
+/**
+ * Calculates the images of the queue in a worker process until none is left.
+ * The worker keeps its wisdom, arena and the spectra of the filters between
+ * images, so that the plans and filters of a shape are only calculated once
+ * per worker.
+ */
+static void _runWorker(JobQueue *queue, int shard, Manifest *manifest, Options *options, ResultCache *cache, Wisdom *wisdom) {
+
+    Arena arena = {0};
+    FilterSpectra spectra = {0, NULL};
+
+    int job;
+    while ((job = _queueClaim(queue, shard)) >= 0) {
+        int failed = _processImage(manifest->inputs[job], manifest->outputs[job], options, cache, wisdom, &spectra, &arena) != 0;
+        _queueFinish(queue, job, failed);
+        fflush(stdout);
+    }
+
+    free(spectra.y2Hats);
+    _arenaDestroy(&arena);
+
+}
+
+/**
+ * Starts the worker process of a shard. Returns its id or -1.
+ */
+static pid_t _startWorker(JobQueue *queue, int shard, Manifest *manifest, Options *options, ResultCache *cache, Wisdom *wisdom) {
+
+    // Nothing buffered may be written twice
+    fflush(stdout);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        _runWorker(queue, shard, manifest, options, cache, wisdom);
+        _exit(0);
+    }
+    if (pid < 0) printf("Error in runner: Could not start worker %d.\n", shard);
+
+    return pid;
+
+}
+
+/**
+ * Gets the current time in s.
+ */
+static double _seconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/**
+ * Calculates the images of a manifest on options->processes worker processes,
+ * each of which takes the images of its shard first and then steals from the
+ * others. A worker that crashes is started again, its image counts as failed.
+ * The progress is reported every second and kept in the queue file next to the
+ * manifest, from which an interrupted run resumes. Returns the amount of
+ * failures and images left.
+ */
+static int _runManifest(Options *options, ResultCache *cache, Wisdom *wisdom) {
+
+    Manifest manifest;
+    if (_readManifest(options->manifestPath, options, &manifest)) return 1;
+
+    char statePath[1100];
+    snprintf(statePath, sizeof(statePath), "%s.state", options->manifestPath);
+    int processes = options->processes < manifest.count ? options->processes : manifest.count;
+    processes = processes > 0 ? processes : 1;
+
+    JobQueue queue;
+    if (_queueOpen(&queue, statePath, manifest.count, manifest.key, processes)) {
+        _freeManifest(&manifest);
+        return 1;
+    }
+    int resumed = queue.header->done;
+    if (resumed > 0) printf("Resuming with %d of %d images done.\n", resumed, manifest.count);
+
+    pid_t *workers = malloc(processes * sizeof(pid_t));
+    int running = 0;
+    for (int s = 0; s < processes; s++) {
+        workers[s] = _startWorker(&queue, s, &manifest, options, cache, wisdom);
+        running += workers[s] > 0;
+    }
+
+    double start = _seconds();
+    double report = start;
+    while (running > 0) {
+
+        int status;
+        pid_t pid = waitpid(-1, &status, WNOHANG);
+        if (pid > 0) {
+            int s = 0;
+            while (s < processes && workers[s] != pid) s++;
+            if (s == processes) continue;
+            workers[s] = -1;
+            running--;
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                int abandoned = _queueAbandon(&queue, s);
+                printf("Error in runner: Worker %d stopped, %d image%s failed.\n", s, abandoned, abandoned == 1 ? "" : "s");
+                if (_queuePending(&queue) > 0) {
+                    workers[s] = _startWorker(&queue, s, &manifest, options, cache, wisdom);
+                    running += workers[s] > 0;
+                }
+            }
+            continue;
+        }
+
+        usleep(50000);
+        double now = _seconds();
+        if (now - report >= 1) {
+            int done = queue.header->done + queue.header->failed - resumed;
+            printf("%d of %d images, %.1f images/s\n", done + resumed, manifest.count, done / (now - start));
+            fflush(stdout);
+            report = now;
+        }
+
+    }
+
+    int done = queue.header->done - resumed;
+    int failed = queue.header->failed;
+    int left = _queuePending(&queue);
+    double time = _seconds() - start;
+    printf("Calculated %d images in %.1f s on %d processes, %.1f images/s, %d failed",
+        done, time, processes, time > 0 ? done / time : 0, failed);
+    if (left > 0) printf(", %d left to resume", left);
+    printf(".\n");
+
+    free(workers);
+    _queueClose(&queue);
+    _freeManifest(&manifest);
+
+    return failed + left;
+
+}
+
+int main(int argc, char **argv) {
+
+    Options options;
+    int first = _parseOptions(argc, argv, &options);
+    if (first < 0) {
+        _printUsage(argv[0]);
+        return 1;
+    }
+
+    float narrowSigma = options.xi > 1 ? options.sigma / options.xi : options.sigma;
+    if (options.recursive && (narrowSigma < 3 || options.lambda < 2 || options.lambda > 3 * narrowSigma)) {
+        printf("Warning: Recursive filters differ from the Fourier method by more than 5%% unless sigma >= 3 along either axis and 2 <= lambda <= 3 sigma.\n");
+    }
+
+    ResultCache cache;
+    ResultCache *cachePointer = NULL;
+    if (options.cacheDirectory != NULL) {
+        if (_cacheOpen(&cache, options.cacheDirectory, options.cacheLimit)) return 1;
+        cachePointer = &cache;
+    }
+
+    Wisdom wisdom = {0};
+    if (options.wisdomPath != NULL && _wisdomLoad(&wisdom, options.wisdomPath)) return 1;
+
+    Arena arena = {0};
+    int failures = 0;
+    if (options.manifestPath != NULL) {
+        // The workers plan with copies of the wisdom, only what was loaded is saved
+        failures = _runManifest(&options, cachePointer, &wisdom);
+    } else if (options.step > 0) {
+        for (int i = first; i + 1 < argc; i += 2) {
+            failures += _transformImage(argv[i], argv[i+1], &options, &arena) != 0;
+        }
+    } else if (options.videoTile > 0) {
+        failures = _processVideo(&argv[first], (argc - first) / 2, &options, &arena);
+    } else if (options.pipeline[0] > 0) {
+        failures = _pipelineImages(&argv[first], (argc - first) / 2, &options, cachePointer);
+    } else if (options.tile > 0) {
+        for (int i = first; i + 1 < argc; i += 2) {
+            failures += _streamImage(argv[i], argv[i+1], &options, &arena) != 0;
+        }
+    } else if (options.threads > 1 && options.blocks == 0 && options.region[2] == 0 && !options.pad && !options.recursive && options.tolerance == 0 && options.budget == 0 && !options.decimate) {
+        failures = _processImages(&argv[first], (argc - first) / 2, &options, cachePointer, &wisdom, &arena);
+    } else {
+        for (int i = first; i + 1 < argc; i += 2) {
+            failures += _processImage(argv[i], argv[i+1], &options, cachePointer, &wisdom, NULL, &arena) != 0;
+        }
+    }
+    _arenaDestroy(&arena);
+
+    if (options.wisdomPath != NULL && _wisdomSave(&wisdom, options.wisdomPath)) return 1;
+
+    return failures > 0;
+
+}
@@ -0,0 +1,252 @@
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include "error.h"
+#include "pipeline.h"
+
+/**
+ * A thread of a stage, which knows the stage after its own.
+ */
+typedef struct StageThread {
+    Stage *stage;
+    Stage *next;
+    int index;
+    pthread_t thread;
+} StageThread;
+
+/**
+ * Gets the current time in s.
+ */
+static double _seconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/**
+ * Initializes an empty queue of given capacity that is fed by the given
+ * amount of producers. Returns 0 on success.
+ */
+static int _stageQueueOpen(StageQueue *queue, int capacity, int producers) {
+
+    *queue = (StageQueue) {malloc(capacity * sizeof(void *)), capacity, 0, 0, producers};
+    if (queue->items == NULL) return 1;
+
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->notEmpty, NULL);
+    pthread_cond_init(&queue->notFull, NULL);
+
+    return 0;
+
+}
+
+/**
+ * Frees a queue.
+ */
+static void _stageQueueClose(StageQueue *queue) {
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->notEmpty);
+    pthread_cond_destroy(&queue->notFull);
+    free(queue->items);
+    queue->items = NULL;
+}
+
+/**
+ * Appends an item, waiting while the queue is full. Returns 1 if the queue
+ * was closed meanwhile, so that the item is dropped.
+ */
+static int _stageQueuePush(StageQueue *queue, void *item) {
+
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->capacity && !queue->closed) {
+        pthread_cond_wait(&queue->notFull, &queue->lock);
+    }
+    if (queue->closed) {
+        pthread_mutex_unlock(&queue->lock);
+        return 1;
+    }
+
+    queue->items[(queue->head + queue->count) % queue->capacity] = item;
+    queue->count++;
+    queue->pushes++;
+    queue->depthSum += queue->count;
+    queue->maxDepth = queue->count > queue->maxDepth ? queue->count : queue->maxDepth;
+
+    pthread_cond_signal(&queue->notEmpty);
+    pthread_mutex_unlock(&queue->lock);
+
+    return 0;
+
+}
+
+/**
+ * Takes the oldest item, waiting while the queue is empty. Returns NULL once
+ * the queue is empty and all producers are done, or it is closed.
+ */
+static void *_stageQueuePop(StageQueue *queue) {
+
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0 && queue->producers > 0 && !queue->closed) {
+        pthread_cond_wait(&queue->notEmpty, &queue->lock);
+    }
+
+    void *item = NULL;
+    if (queue->count > 0 && !queue->closed) {
+        item = queue->items[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        pthread_cond_signal(&queue->notFull);
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return item;
+
+}
+
+/**
+ * Counts one producer of a queue as done. The last one wakes the consumers,
+ * which then drain the queue and stop.
+ */
+static void _stageQueueDone(StageQueue *queue) {
+    pthread_mutex_lock(&queue->lock);
+    if (--queue->producers == 0) pthread_cond_broadcast(&queue->notEmpty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * Closes a queue, so that its producers and consumers stop waiting and its
+ * items are dropped.
+ */
+static void _stageQueueAbort(StageQueue *queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = 1;
+    pthread_cond_broadcast(&queue->notEmpty);
+    pthread_cond_broadcast(&queue->notFull);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * Processes the items of the queue of a stage and passes them on to the next
+ * stage, if any. The times are summed up per thread and added to the stage
+ * under the lock of its queue once the thread is done.
+ */
+static void *_stageRun(void *argument) {
+
+    StageThread *thread = argument;
+    Stage *stage = thread->stage;
+    long done = 0, failed = 0;
+    double busy = 0, starved = 0, blocked = 0;
+
+    while (1) {
+
+        double start = _seconds();
+        void *item = _stageQueuePop(&stage->queue);
+        double popped = _seconds();
+        starved += popped - start;
+        if (item == NULL) break;
+
+        int itemFailed = stage->function(item, thread->index, stage->data) != 0;
+        double processed = _seconds();
+        busy += processed - popped;
+
+        if (!itemFailed && thread->next != NULL) {
+            itemFailed = _stageQueuePush(&thread->next->queue, item);
+            blocked += _seconds() - processed;
+        }
+        done += !itemFailed;
+        failed += itemFailed;
+
+    }
+
+    pthread_mutex_lock(&stage->queue.lock);
+    stage->done += done;
+    stage->failed += failed;
+    stage->busy += busy;
+    stage->starved += starved;
+    stage->blocked += blocked;
+    pthread_mutex_unlock(&stage->queue.lock);
+
+    if (thread->next != NULL) _stageQueueDone(&thread->next->queue);
+
+    return NULL;
+
+}
+
+/**
+ * Passes items through count stages, each running on its own threads, with a
+ * queue of depth items in front of each stage. The calling thread feeds the
+ * first queue, so that at most the items in the queues and the stages are in
+ * flight at a time. The stages keep their measurements and the wall time is
+ * saved into seconds. Returns the amount of items that failed in any stage.
+ */
+int _pipelineRun(Stage *stages, int count, void **items, int itemCount, int depth, double *seconds) {
+
+    double start = _seconds();
+    int threads = 0;
+    for (int s = 0; s < count; s++) {
+        stages[s].done = stages[s].failed = 0;
+        stages[s].busy = stages[s].starved = stages[s].blocked = 0;
+        threads += stages[s].threads;
+    }
+
+    StageThread *pool = calloc(threads, sizeof(StageThread));
+    int opened = 0;
+    while (pool != NULL && opened < count && _stageQueueOpen(&stages[opened].queue, depth, opened > 0 ? stages[opened-1].threads : 1) == 0) {
+        opened++;
+    }
+    if (opened < count) {
+        _error("Error in pipeline: Could not allocate the queues.\n");
+        for (int s = 0; s < opened; s++) _stageQueueClose(&stages[s].queue);
+        free(pool);
+        return itemCount;
+    }
+
+    // Start the threads of each stage; a stage without any would stall the pipeline
+    int started = 0;
+    int aborted = 0;
+    for (int s = 0; s < count && !aborted; s++) {
+        int stageStarted = 0;
+        for (int t = 0; t < stages[s].threads; t++) {
+            pool[started] = (StageThread) {&stages[s], s + 1 < count ? &stages[s+1] : NULL, t};
+            if (pthread_create(&pool[started].thread, NULL, _stageRun, &pool[started]) != 0) continue;
+            started++;
+            stageStarted++;
+        }
+        if (stageStarted == 0) {
+            _error("Error in pipeline: Could not start the threads of stage %s.\n", stages[s].name);
+            aborted = 1;
+        } else if (s + 1 < count) {
+            // The threads that did not start never finish producing
+            pthread_mutex_lock(&stages[s+1].queue.lock);
+            stages[s+1].queue.producers -= stages[s].threads - stageStarted;
+            pthread_mutex_unlock(&stages[s+1].queue.lock);
+        }
+    }
+
+    int fed = 0;
+    if (aborted) {
+        for (int s = 0; s < count; s++) _stageQueueAbort(&stages[s].queue);
+    } else {
+        while (fed < itemCount && _stageQueuePush(&stages[0].queue, items[fed]) == 0) {
+            fed++;
+        }
+        _stageQueueDone(&stages[0].queue);
+    }
+
+    for (int t = 0; t < started; t++) {
+        pthread_join(pool[t].thread, NULL);
+    }
+    free(pool);
+
+    int failed = itemCount - fed;
+    for (int s = 0; s < count; s++) {
+        failed += stages[s].failed;
+        _stageQueueClose(&stages[s].queue);
+    }
+    if (aborted) failed = itemCount;
+
+    *seconds = _seconds() - start;
+
+    return failed;
+
+}
@@ -0,0 +1,54 @@
+#include <stddef.h>
+#include <pthread.h>
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+/**
+ * Processes one item in a stage, called from thread index thread of the
+ * stage. Returns 0 to pass the item on to the next stage, otherwise the item
+ * counts as failed and is dropped.
+ */
+typedef int (*StageFunction)(void *item, int thread, void *data);
+
+/**
+ * A bounded queue of items in front of a stage. A producer blocks while it is
+ * full and a consumer while it is empty, until all producers are done. The
+ * depth is sampled at each push.
+ */
+typedef struct StageQueue {
+    void **items;
+    int capacity;
+    int head;
+    int count;
+    int producers;
+    int closed;
+    long pushes;
+    long depthSum;
+    int maxDepth;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+} StageQueue;
+
+/**
+ * A stage of a pipeline with its own amount of threads, and what it measured:
+ * the items it passed on and dropped, and the seconds its threads spent in the
+ * function, waiting for an item and waiting for room in the next queue.
+ */
+typedef struct Stage {
+    const char *name;
+    int threads;
+    StageFunction function;
+    void *data;
+    StageQueue queue;
+    long done;
+    long failed;
+    double busy;
+    double starved;
+    double blocked;
+} Stage;
+
+int _pipelineRun(Stage *stages, int count, void **items, int itemCount, int depth, double *seconds);
+
+#endif
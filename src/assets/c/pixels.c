@@ -0,0 +1,302 @@
+#include <string.h>
+#include "pixels.h"
+
+/*
+ * The kernels work on four pixels at once. They use the vector extensions of
+ * GCC and Clang, which are compiled to SIMD instructions (e.g. simd128 in
+ * WebAssembly with -msimd128) and to scalar code otherwise. An RGBA pixel is
+ * read as one little-endian 32-bit word, so that no shuffles are needed.
+ */
+typedef float f32x4 __attribute__((vector_size(16)));
+typedef int i32x4 __attribute__((vector_size(16)));
+typedef unsigned int u32x4 __attribute__((vector_size(16)));
+typedef unsigned char u8x4 __attribute__((vector_size(4)));
+typedef unsigned short u16x4 __attribute__((vector_size(8)));
+
+#define ALPHA 0xff000000u
+
+/**
+ * Selects the lanes of a where the mask is set and the lanes of b otherwise.
+ */
+static inline f32x4 _select(i32x4 mask, f32x4 a, f32x4 b) {
+    return (f32x4) (((i32x4) a & mask) | ((i32x4) b & ~mask));
+}
+
+/**
+ * Clamps the lanes to [0, 255].
+ */
+static inline f32x4 _clamp255(f32x4 v) {
+    const f32x4 zero = {0, 0, 0, 0};
+    const f32x4 full = {255, 255, 255, 255};
+    v = _select(v < zero, zero, v);
+    return _select(v > full, full, v);
+}
+
+/**
+ * Rounds clamped lanes to bytes.
+ */
+static inline u32x4 _toByte(f32x4 v) {
+    const f32x4 half = {0.5f, 0.5f, 0.5f, 0.5f};
+    return __builtin_convertvector(_clamp255(v) + half, u32x4);
+}
+
+/**
+ * Clamps a value to [0, 255] and rounds it to a byte.
+ */
+static inline unsigned int _toByteScalar(float v) {
+    if (!(v > 0)) return 0;
+    if (v > 255) return 255;
+    return (unsigned int) (v + 0.5f);
+}
+
+/**
+ * Gets the minimum and maximum value of an array.
+ */
+void _minMax(float *pixels, int size, float *min, float *max) {
+
+    if (size <= 0) {
+        *min = 0;
+        *max = 0;
+        return;
+    }
+
+    float minValue = pixels[0];
+    float maxValue = pixels[0];
+    int i = 0;
+
+    if (size >= 4) {
+        f32x4 minLanes, maxLanes;
+        memcpy(&minLanes, pixels, sizeof(f32x4));
+        maxLanes = minLanes;
+        for (; i + 4 <= size; i += 4) {
+            f32x4 v;
+            memcpy(&v, pixels + i, sizeof(f32x4));
+            minLanes = _select(v < minLanes, v, minLanes);
+            maxLanes = _select(v > maxLanes, v, maxLanes);
+        }
+        for (int k = 0; k < 4; k++) {
+            minValue = minLanes[k] < minValue ? minLanes[k] : minValue;
+            maxValue = maxLanes[k] > maxValue ? maxLanes[k] : maxValue;
+        }
+    }
+
+    for (; i < size; i++) {
+        minValue = pixels[i] < minValue ? pixels[i] : minValue;
+        maxValue = pixels[i] > maxValue ? pixels[i] : maxValue;
+    }
+
+    *min = minValue;
+    *max = maxValue;
+
+}
+
+/**
+ * Converts RGBA pixels to gray values by averaging the red, green and blue channel.
+ */
+void _rgbaToGray(unsigned char *rgba, float *gray, int size) {
+
+    const u32x4 mask = {0xff, 0xff, 0xff, 0xff};
+    const f32x4 third = {1.0f/3, 1.0f/3, 1.0f/3, 1.0f/3};
+    int i = 0;
+
+    for (; i + 4 <= size; i += 4) {
+        u32x4 w;
+        memcpy(&w, rgba + 4*i, sizeof(u32x4));
+        u32x4 sum = (w & mask) + ((w >> 8) & mask) + ((w >> 16) & mask);
+        f32x4 v = __builtin_convertvector(sum, f32x4) * third;
+        memcpy(gray + i, &v, sizeof(f32x4));
+    }
+
+    for (; i < size; i++) {
+        gray[i] = (rgba[4*i] + rgba[4*i+1] + rgba[4*i+2]) / 3.0f;
+    }
+
+}
+
+/**
+ * Converts gray values to opaque gray RGBA pixels with value scale*(gray-offset).
+ */
+void _grayToRgba(float *gray, unsigned char *rgba, int size, float offset, float scale) {
+
+    const f32x4 offsetLanes = {offset, offset, offset, offset};
+    const f32x4 scaleLanes = {scale, scale, scale, scale};
+    const u32x4 alpha = {ALPHA, ALPHA, ALPHA, ALPHA};
+    int i = 0;
+
+    for (; i + 4 <= size; i += 4) {
+        f32x4 v;
+        memcpy(&v, gray + i, sizeof(f32x4));
+        u32x4 b = _toByte(scaleLanes * (v - offsetLanes));
+        u32x4 w = b | (b << 8) | (b << 16) | alpha;
+        memcpy(rgba + 4*i, &w, sizeof(u32x4));
+    }
+
+    for (; i < size; i++) {
+        unsigned int b = _toByteScalar(scale * (gray[i] - offset));
+        rgba[4*i] = b;
+        rgba[4*i+1] = b;
+        rgba[4*i+2] = b;
+        rgba[4*i+3] = 255;
+    }
+
+}
+
+/**
+ * Converts values in [min, max] to opaque RGBA pixels of a color scale from
+ * blue (min) to red (max).
+ */
+void _colorScaleToRgba(float *pixels, unsigned char *rgba, int size, float min, float max) {
+
+    float z0 = min;
+    float z1 = z0 + (max - min) / 3;
+    float z2 = z0 + 2 * (max - min) / 3;
+    float a = z1 > z0 ? 255 / (z1 - z0) : 0;
+    float b = z2 > z1 ? 255 / (z2 - z1) : 0;
+
+    const f32x4 z0Lanes = {z0, z0, z0, z0};
+    const f32x4 z1Lanes = {z1, z1, z1, z1};
+    const f32x4 z2Lanes = {z2, z2, z2, z2};
+    const f32x4 aLanes = {a, a, a, a};
+    const f32x4 bLanes = {b, b, b, b};
+    const f32x4 zero = {0, 0, 0, 0};
+    const f32x4 full = {255, 255, 255, 255};
+    const u32x4 alpha = {ALPHA, ALPHA, ALPHA, ALPHA};
+    int i = 0;
+
+    for (; i + 4 <= size; i += 4) {
+        f32x4 z;
+        memcpy(&z, pixels + i, sizeof(f32x4));
+        i32x4 lower = z < z1Lanes;
+        i32x4 middle = ~lower & (z < z2Lanes);
+        f32x4 r = _select(lower, zero, _select(middle, bLanes * (z - z1Lanes), full));
+        f32x4 g = _select(lower, aLanes * (z - z0Lanes), _select(middle, full, zero));
+        f32x4 bl = _select(lower, -aLanes * (z + z0Lanes), zero);
+        u32x4 w = _toByte(r) | (_toByte(g) << 8) | (_toByte(bl) << 16) | alpha;
+        memcpy(rgba + 4*i, &w, sizeof(u32x4));
+    }
+
+    for (; i < size; i++) {
+        float z = pixels[i];
+        float r, g, bl;
+        if (z < z1) {
+            r = 0;
+            g = a * (z - z0);
+            bl = -a * (z + z0);
+        } else if (z < z2) {
+            r = b * (z - z1);
+            g = 255;
+            bl = 0;
+        } else {
+            r = 255;
+            g = 0;
+            bl = 0;
+        }
+        rgba[4*i] = _toByteScalar(r);
+        rgba[4*i+1] = _toByteScalar(g);
+        rgba[4*i+2] = _toByteScalar(bl);
+        rgba[4*i+3] = 255;
+    }
+
+}
+
+/**
+ * Quantizes values in [min, max] to 8 or 16 bit levels, such that min is
+ * mapped to 0 and max to the highest level.
+ */
+void _quantize(float *values, void *levels, int size, float min, float max, int bits) {
+
+    float highest = bits == 16 ? 65535 : 255;
+    float k = max > min ? highest / (max - min) : 0;
+
+    const f32x4 minLanes = {min, min, min, min};
+    const f32x4 kLanes = {k, k, k, k};
+    const f32x4 half = {0.5f, 0.5f, 0.5f, 0.5f};
+    const f32x4 zero = {0, 0, 0, 0};
+    const f32x4 highestLanes = {highest, highest, highest, highest};
+    int i = 0;
+
+    for (; i + 4 <= size; i += 4) {
+        f32x4 v;
+        memcpy(&v, values + i, sizeof(f32x4));
+        v = kLanes * (v - minLanes);
+        v = _select(v < zero, zero, _select(v > highestLanes, highestLanes, v));
+        u32x4 q = __builtin_convertvector(v + half, u32x4);
+        if (bits == 16) {
+            u16x4 q16 = __builtin_convertvector(q, u16x4);
+            memcpy((unsigned short *) levels + i, &q16, sizeof(u16x4));
+        } else {
+            u8x4 q8 = __builtin_convertvector(q, u8x4);
+            memcpy((unsigned char *) levels + i, &q8, sizeof(u8x4));
+        }
+    }
+
+    for (; i < size; i++) {
+        float v = k * (values[i] - min);
+        unsigned int q = !(v > 0) ? 0 : v > highest ? highest : (unsigned int) (v + 0.5f);
+        if (bits == 16) ((unsigned short *) levels)[i] = q;
+        else ((unsigned char *) levels)[i] = q;
+    }
+
+}
+
+/**
+ * Converts 8 or 16 bit levels to opaque gray RGBA pixels with value scale*level.
+ */
+void _levelsToRgba(void *levels, int bits, unsigned char *rgba, int size, float scale) {
+
+    const f32x4 scaleLanes = {scale, scale, scale, scale};
+    const u32x4 alpha = {ALPHA, ALPHA, ALPHA, ALPHA};
+    int i = 0;
+
+    for (; i + 4 <= size; i += 4) {
+        f32x4 v;
+        if (bits == 16) {
+            u16x4 q16;
+            memcpy(&q16, (unsigned short *) levels + i, sizeof(u16x4));
+            v = __builtin_convertvector(q16, f32x4);
+        } else {
+            u8x4 q8;
+            memcpy(&q8, (unsigned char *) levels + i, sizeof(u8x4));
+            v = __builtin_convertvector(q8, f32x4);
+        }
+        u32x4 b = _toByte(scaleLanes * v);
+        u32x4 w = b | (b << 8) | (b << 16) | alpha;
+        memcpy(rgba + 4*i, &w, sizeof(u32x4));
+    }
+
+    for (; i < size; i++) {
+        float level = bits == 16 ? ((unsigned short *) levels)[i] : ((unsigned char *) levels)[i];
+        unsigned int b = _toByteScalar(scale * level);
+        rgba[4*i] = b;
+        rgba[4*i+1] = b;
+        rgba[4*i+2] = b;
+        rgba[4*i+3] = 255;
+    }
+
+}
+
+/**
+ * Upsamples the values of a periodic m*m grid to n*n values by bilinear
+ * interpolation, where n is a multiple of m, e.g. a decimated result for
+ * display. Value (x, y) of the grid becomes pixel (x*n/m, y*n/m).
+ */
+void _upsample(float *values, int m, float *pixels, int n) {
+
+    int stride = n / m;
+    float h = 1.0f / stride;
+
+    for (int y = 0; y < n; y++) {
+        const float *row0 = &values[(y / stride) * m];
+        const float *row1 = &values[((y / stride + 1) % m) * m];
+        float fy = (y % stride) * h;
+        for (int x = 0; x < n; x++) {
+            int x0 = x / stride;
+            int x1 = (x0 + 1) % m;
+            float fx = (x % stride) * h;
+            float top = row0[x0] + fx * (row0[x1] - row0[x0]);
+            float bottom = row1[x0] + fx * (row1[x1] - row1[x0]);
+            pixels[y*n+x] = top + fy * (bottom - top);
+        }
+    }
+
+}
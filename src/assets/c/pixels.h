@@ -0,0 +1,12 @@
+#ifndef PIXELS_H
+#define PIXELS_H
+
+void _minMax(float *pixels, int size, float *min, float *max);
+void _rgbaToGray(unsigned char *rgba, float *gray, int size);
+void _grayToRgba(float *gray, unsigned char *rgba, int size, float offset, float scale);
+void _colorScaleToRgba(float *pixels, unsigned char *rgba, int size, float min, float max);
+void _quantize(float *values, void *levels, int size, float min, float max, int bits);
+void _levelsToRgba(void *levels, int bits, unsigned char *rgba, int size, float scale);
+void _upsample(float *values, int m, float *pixels, int n);
+
+#endif
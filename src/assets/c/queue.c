@@ -0,0 +1,167 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "error.h"
+#include "queue.h"
+
+static const char queueMagic[8] = "GABORQ1";
+
+/**
+ * Gets the bytes of a queue file of count jobs.
+ */
+static size_t _queueFileSize(int count) {
+    return sizeof(QueueHeader) + 2 * (size_t) count * sizeof(int);
+}
+
+/**
+ * Opens the queue of count jobs in the file at path, split into shards of
+ * consecutive jobs. If the file holds a queue of the same count and key, e.g.
+ * a hash of the jobs, it is resumed: the jobs that are done are kept, the
+ * others are pending again, including those that failed or were running when
+ * the run crashed. Otherwise all jobs are pending. Returns 0 on success.
+ */
+int _queueOpen(JobQueue *queue, const char *path, int count, unsigned int key, int shards) {
+
+    int file = open(path, O_RDWR | O_CREAT, 0644);
+    if (file < 0) {
+        _error("Error in queue: Could not open %s.\n", path);
+        return 1;
+    }
+
+    struct stat status;
+    size_t size = _queueFileSize(count);
+    int resumed = fstat(file, &status) == 0 && (size_t) status.st_size == size;
+    if (ftruncate(file, size) != 0) {
+        _error("Error in queue: Could not resize %s.\n", path);
+        close(file);
+        return 1;
+    }
+
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    close(file);
+    if (data == MAP_FAILED) {
+        _error("Error in queue: Could not map %s.\n", path);
+        return 1;
+    }
+
+    queue->header = data;
+    queue->states = (int *) (queue->header + 1);
+    queue->owners = queue->states + count;
+    queue->fileSize = size;
+
+    QueueHeader *header = queue->header;
+    resumed = resumed && memcmp(header->magic, queueMagic, sizeof(queueMagic)) == 0 && header->key == key && header->count == count;
+    if (!resumed) {
+        memcpy(header->magic, queueMagic, sizeof(queueMagic));
+        header->key = key;
+        header->count = count;
+    }
+    header->done = 0;
+    header->failed = 0;
+    for (int i = 0; i < count; i++) {
+        if (resumed && queue->states[i] == JOB_DONE) {
+            header->done++;
+        } else {
+            queue->states[i] = JOB_PENDING;
+        }
+        queue->owners[i] = -1;
+    }
+
+    // The shards are not kept in the file, as the amount of workers may differ between runs
+    queue->shardCount = shards;
+    queue->shards = mmap(NULL, shards * sizeof(Shard), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (queue->shards == MAP_FAILED) {
+        _error("Error in queue: Could not map the shards.\n");
+        munmap(data, size);
+        return 1;
+    }
+    for (int s = 0; s < shards; s++) {
+        int start = (int) ((long) count * s / shards);
+        int end = (int) ((long) count * (s+1) / shards);
+        queue->shards[s] = (Shard) {start, end, start, end};
+    }
+
+    return 0;
+
+}
+
+/**
+ * Takes a job for the worker of a shard if it is still pending.
+ */
+static int _queueTake(JobQueue *queue, int job, int shard) {
+    int pending = JOB_PENDING;
+    if (__atomic_load_n(&queue->states[job], __ATOMIC_RELAXED) != pending) return 0;
+    if (!__atomic_compare_exchange_n(&queue->states[job], &pending, JOB_RUNNING, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) return 0;
+    __atomic_store_n(&queue->owners[job], shard, __ATOMIC_RELEASE);
+    return 1;
+}
+
+/**
+ * Takes the next job for the worker of a shard, from the head of its own
+ * shard or else from the tail of another one. Each index of a shard is handed
+ * out once from either end and a job is only taken if it is still pending, so
+ * no lock is needed and no job is taken twice. Returns the job or -1 if none
+ * is left.
+ */
+int _queueClaim(JobQueue *queue, int shard) {
+
+    Shard *own = &queue->shards[shard];
+    for (int job = __atomic_fetch_add(&own->head, 1, __ATOMIC_RELAXED); job < own->end; job = __atomic_fetch_add(&own->head, 1, __ATOMIC_RELAXED)) {
+        if (_queueTake(queue, job, shard)) return job;
+    }
+
+    // Steal from the others, starting with the next one
+    for (int k = 1; k < queue->shardCount; k++) {
+        Shard *victim = &queue->shards[(shard + k) % queue->shardCount];
+        for (int job = __atomic_sub_fetch(&victim->tail, 1, __ATOMIC_RELAXED); job >= victim->start; job = __atomic_sub_fetch(&victim->tail, 1, __ATOMIC_RELAXED)) {
+            if (_queueTake(queue, job, shard)) return job;
+        }
+    }
+
+    return -1;
+
+}
+
+/**
+ * Marks a job that was taken as done or failed.
+ */
+void _queueFinish(JobQueue *queue, int job, int failed) {
+    __atomic_store_n(&queue->states[job], failed ? JOB_FAILED : JOB_DONE, __ATOMIC_RELEASE);
+    __atomic_add_fetch(failed ? &queue->header->failed : &queue->header->done, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Marks the jobs running on the worker of a shard as failed, after the worker
+ * crashed. They are not handed out again in this run, as they may have caused
+ * the crash, but a resumed run tries them again. Returns the amount of jobs.
+ */
+int _queueAbandon(JobQueue *queue, int shard) {
+    int count = 0;
+    for (int i = 0; i < queue->header->count; i++) {
+        if (__atomic_load_n(&queue->owners[i], __ATOMIC_ACQUIRE) == shard && __atomic_load_n(&queue->states[i], __ATOMIC_ACQUIRE) == JOB_RUNNING) {
+            _queueFinish(queue, i, 1);
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * Gets the amount of jobs that are neither done nor failed.
+ */
+int _queuePending(JobQueue *queue) {
+    QueueHeader *header = queue->header;
+    return header->count - __atomic_load_n(&header->done, __ATOMIC_RELAXED) - __atomic_load_n(&header->failed, __ATOMIC_RELAXED);
+}
+
+/**
+ * Writes the states back to the file and closes the queue.
+ */
+void _queueClose(JobQueue *queue) {
+    msync(queue->header, queue->fileSize, MS_SYNC);
+    munmap(queue->header, queue->fileSize);
+    munmap(queue->shards, queue->shardCount * sizeof(Shard));
+}
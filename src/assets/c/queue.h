@@ -0,0 +1,56 @@
+#include <stddef.h>
+
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#define JOB_PENDING 0
+#define JOB_RUNNING 1
+#define JOB_DONE 2
+#define JOB_FAILED 3
+
+/**
+ * The header of a queue file, which is followed by the state of each job and
+ * the shard of the worker that took it.
+ */
+typedef struct QueueHeader {
+    char magic[8];
+    unsigned int key;
+    int count;
+    int done;
+    int failed;
+} QueueHeader;
+
+/**
+ * The jobs start to end of a worker, which takes them from its head while
+ * other workers steal them from its tail. Each shard has a cache line of its
+ * own, as all workers update them.
+ */
+typedef struct Shard {
+    int start;
+    int end;
+    int head;
+    int tail;
+} __attribute__((aligned(64))) Shard;
+
+/**
+ * A queue of jobs shared by worker processes. The states live in a memory-
+ * mapped file, so that a run that crashed can be resumed, and the shards in
+ * memory shared with the processes forked after opening the queue.
+ */
+typedef struct JobQueue {
+    QueueHeader *header;
+    int *states;
+    int *owners;
+    Shard *shards;
+    int shardCount;
+    size_t fileSize;
+} JobQueue;
+
+int _queueOpen(JobQueue *queue, const char *path, int count, unsigned int key, int shards);
+int _queueClaim(JobQueue *queue, int shard);
+void _queueFinish(JobQueue *queue, int job, int failed);
+int _queueAbandon(JobQueue *queue, int shard);
+int _queuePending(JobQueue *queue);
+void _queueClose(JobQueue *queue);
+
+#endif
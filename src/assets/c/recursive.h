@@ -0,0 +1,14 @@
+#include <stddef.h>
+#include "arena.h"
+#include "control.h"
+
+#ifndef RECURSIVE_H
+#define RECURSIVE_H
+
+#define RECURSIVE_SIGMA_MIN 0.8
+
+int _fgc2Recursive(float *y1, float *yConvSum, int width, int height, float xi, float sigma, float lambda, float theta, int amount, float *minMax, Control *control, Arena *arena);
+
+size_t _fgc2RecursiveArenaSize(int width, int height, float xi, float sigma);
+
+#endif
@@ -0,0 +1,361 @@
+#include <stdlib.h>
+#include <string.h>
+#include <complex.h>
+#include <math.h>
+#include "arena.h"
+#include "control.h"
+#include "error.h"
+#include "fourier.h"
+#include "gabor.h"
+#include "pixels.h"
+#include "steerable.h"
+
+/**
+ * Gets the side length of the grid the basis is designed on, which is the
+ * window of the filter truncated to 4 standard deviations if it fits into the
+ * image, or the whole image otherwise.
+ */
+static int _steerableGrid(int n, float xi, float sigma) {
+    int radius = _filterRadius(xi, sigma);
+    return radius < n/2 ? 2*radius+1 : n;
+}
+
+/**
+ * Generates the amount filters of the orientations on a grid of size w*w, one
+ * after the other into f.
+ */
+static void _steerableFilters(float complex *f, int w, int n, float xi, float sigma, float lambda, float theta, int amount) {
+
+    float pi = acos(-1.0);
+
+    for (int j = 0; j < amount; j++) {
+        if (w < n) _normalizedFilterWindow2(&f[(size_t) j * w * w], w/2, xi, sigma, lambda, theta + pi*j/amount);
+        else _normalizedFilter2(&f[(size_t) j * w * w], n, xi, sigma, lambda, theta + pi*j/amount);
+    }
+
+}
+
+/**
+ * Calculates the eigenvalues and eigenvectors of a real symmetric matrix m of
+ * size*size with the cyclic Jacobi method. m is overwritten with a diagonal
+ * matrix of the eigenvalues and the eigenvectors are saved into the columns
+ * of v.
+ */
+static void _jacobiEigen(double *m, double *v, int size) {
+
+    for (int i = 0; i < size*size; i++) {
+        v[i] = i % (size+1) == 0 ? 1 : 0;
+    }
+
+    for (int sweep = 0; sweep < 64; sweep++) {
+
+        // Stop as soon as the values off the diagonal vanish
+        double off = 0;
+        double total = 0;
+        for (int i = 0; i < size*size; i++) {
+            if (i % (size+1) != 0) off += m[i]*m[i];
+            total += m[i]*m[i];
+        }
+        if (off <= 1e-24 * total) break;
+
+        for (int p = 0; p < size; p++) {
+            for (int q = p+1; q < size; q++) {
+
+                double mpq = m[p*size+q];
+                if (fabs(mpq) < 1e-300) continue;
+
+                // Rotate, so that m[p][q] becomes 0
+                double h = (m[q*size+q] - m[p*size+p]) / (2*mpq);
+                double t = (h >= 0 ? 1 : -1) / (fabs(h) + sqrt(h*h+1));
+                double c = 1 / sqrt(t*t+1);
+                double s = t*c;
+
+                for (int k = 0; k < size; k++) {
+                    double mkp = m[k*size+p];
+                    double mkq = m[k*size+q];
+                    m[k*size+p] = c*mkp - s*mkq;
+                    m[k*size+q] = s*mkp + c*mkq;
+                }
+                for (int k = 0; k < size; k++) {
+                    double mpk = m[p*size+k];
+                    double mqk = m[q*size+k];
+                    m[p*size+k] = c*mpk - s*mqk;
+                    m[q*size+k] = s*mpk + c*mqk;
+                }
+                for (int k = 0; k < size; k++) {
+                    double vkp = v[k*size+p];
+                    double vkq = v[k*size+q];
+                    v[k*size+p] = c*vkp - s*vkq;
+                    v[k*size+q] = s*vkp + c*vkq;
+                }
+
+            }
+        }
+
+    }
+
+}
+
+/**
+ * Calculates the eigenvalues and eigenvectors of the Gram matrix G = F F^H of
+ * the amount filters f_j in the rows of F, sorted from the largest eigenvalue
+ * down. The Hermitian matrix A + iB is embedded into the real symmetric matrix
+ * [[A, -B], [B, A]], whose eigenvectors [x; y] give the eigenvectors x + iy
+ * twice; they are made orthonormal in the complex sense and those that add
+ * nothing are dropped. The eigenvector k is saved into column k of vectors,
+ * an amount*amount matrix. Returns the sum of all eigenvalues.
+ */
+static double _steerableEigen(float complex *f, int w, int amount, float complex *vectors, double *values, Arena *arena) {
+
+    size_t mark = _arenaMark(arena);
+    int size = 2*amount;
+    size_t taps = (size_t) w * w;
+    double *m = _arenaAlloc(arena, (size_t) size * size * sizeof(double));
+    double *v = _arenaAlloc(arena, (size_t) size * size * sizeof(double));
+    double complex *u = _arenaAlloc(arena, (size_t) amount * sizeof(double complex));
+    int *order = _arenaAlloc(arena, size * sizeof(int));
+
+    // Get the Gram matrix, embedded into the real one
+    double trace = 0;
+    for (int j = 0; j < amount; j++) {
+        for (int l = j; l < amount; l++) {
+            double complex g = 0;
+            for (size_t p = 0; p < taps; p++) {
+                g += f[j*taps+p] * conjf(f[l*taps+p]);
+            }
+            m[j*size+l] = m[l*size+j] = m[(j+amount)*size+l+amount] = m[(l+amount)*size+j+amount] = creal(g);
+            m[(j+amount)*size+l] = cimag(g);
+            m[(l+amount)*size+j] = -cimag(g);
+            m[j*size+l+amount] = -cimag(g);
+            m[l*size+j+amount] = cimag(g);
+            if (j == l) trace += creal(g);
+        }
+    }
+
+    _jacobiEigen(m, v, size);
+
+    // Sort the eigenvalues from the largest down
+    for (int i = 0; i < size; i++) {
+        order[i] = i;
+    }
+    for (int i = 1; i < size; i++) {
+        int o = order[i];
+        int k = i;
+        for (; k > 0 && m[order[k-1]*(size+1)] < m[o*(size+1)]; k--) {
+            order[k] = order[k-1];
+        }
+        order[k] = o;
+    }
+
+    // Take the complex eigenvectors that are not in the span of the ones taken before
+    int count = 0;
+    for (int i = 0; i < size && count < amount; i++) {
+
+        for (int j = 0; j < amount; j++) {
+            u[j] = v[j*size+order[i]] + I*v[(j+amount)*size+order[i]];
+        }
+        for (int k = 0; k < count; k++) {
+            double complex dot = 0;
+            for (int j = 0; j < amount; j++) {
+                dot += conj(vectors[j*amount+k]) * u[j];
+            }
+            for (int j = 0; j < amount; j++) {
+                u[j] -= dot * vectors[j*amount+k];
+            }
+        }
+
+        double norm = 0;
+        for (int j = 0; j < amount; j++) {
+            norm += creal(u[j] * conj(u[j]));
+        }
+        if (norm < 0.25) continue;
+
+        for (int j = 0; j < amount; j++) {
+            vectors[j*amount+count] = u[j] / sqrt(norm);
+        }
+        values[count++] = fmax(m[order[i]*(size+1)], 0);
+
+    }
+    for (; count < amount; count++) {
+        values[count] = 0;
+    }
+
+    _arenaRelease(arena, mark);
+
+    return trace;
+
+}
+
+/**
+ * Gets the rank of the steerable basis of the amount orientations of a Gabor
+ * filter, that is the smallest amount of basis filters which approximate all
+ * orientations with a relative error of at most tolerance.
+ */
+int _fgc2SteerableRank(int n, float xi, float sigma, float lambda, float theta, int amount, float tolerance, Arena *arena) {
+
+    size_t mark = _arenaMark(arena);
+    int w = _steerableGrid(n, xi, sigma);
+    float complex *f = _arenaAlloc(arena, (size_t) amount * w * w * sizeof(float complex));
+    float complex *vectors = _arenaAlloc(arena, (size_t) amount * amount * sizeof(float complex));
+    double *values = _arenaAlloc(arena, amount * sizeof(double));
+
+    _steerableFilters(f, w, n, xi, sigma, lambda, theta, amount);
+    double trace = _steerableEigen(f, w, amount, vectors, values, arena);
+
+    // Drop the smallest eigenvalues as long as the error is tolerated
+    int rank = amount;
+    double dropped = 0;
+    while (rank > 1 && dropped + values[rank-1] <= (double) tolerance * tolerance * trace) {
+        dropped += values[--rank];
+    }
+
+    _arenaRelease(arena, mark);
+
+    return rank;
+
+}
+
+/**
+ * Calculates the 2D Gabor convolution summed up over amount orientations like
+ * _fgc2, but with a steerable basis: the image is convolved with rank basis
+ * filters only, which are combinations of the filters of the orientations
+ * given by the largest eigenvectors of their Gram matrix, and the response of
+ * each orientation is a combination of the basis responses per pixel. The
+ * cost thus grows with rank instead of amount; see _fgc2SteerableRank for the
+ * error. The transform of the input, each basis filter and the combination
+ * are steps of the control, if given.
+ */
+void _fgc2Steerable(float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int amount, int rank, float *minMax, Control *control, Arena *arena) {
+
+    if (rank < 1 || rank > amount) {
+        _error("Error in steerable: Rank must be between 1 and the amount of orientations.\n");
+        return;
+    }
+
+    size_t mark = _arenaMark(arena);
+    int size = n*n;
+    int w = _steerableGrid(n, xi, sigma);
+    size_t taps = (size_t) w * w;
+    _controlBegin(control, rank + 2);
+
+    // Design the basis filters b_k = sum_j conj(u_jk) f_j, so that f_j = sum_k u_jk b_k
+    float complex *vectors = _arenaAlloc(arena, (size_t) amount * amount * sizeof(float complex));
+    float complex *basis = _arenaAlloc(arena, rank * taps * sizeof(float complex));
+    size_t designMark = _arenaMark(arena);
+    float complex *f = _arenaAlloc(arena, amount * taps * sizeof(float complex));
+    double *values = _arenaAlloc(arena, amount * sizeof(double));
+    _steerableFilters(f, w, n, xi, sigma, lambda, theta, amount);
+    _steerableEigen(f, w, amount, vectors, values, arena);
+    for (int k = 0; k < rank; k++) {
+        for (size_t p = 0; p < taps; p++) {
+            float complex b = 0;
+            for (int j = 0; j < amount; j++) {
+                b += conjf(vectors[j*amount+k]) * f[j*taps+p];
+            }
+            basis[k*taps+p] = b;
+        }
+    }
+    _arenaRelease(arena, designMark);
+
+    // Calculate Fourier transform of y1 first
+    float complex *y1Hat = _arenaAlloc(arena, size * sizeof(float complex));
+    _fgc2Spectrum(y1, y1Hat, n, arena);
+    if (_controlStep(control)) {
+        _arenaRelease(arena, mark);
+        return;
+    }
+
+    // Convolve with each basis filter, centered like the filters of _fgc2
+    float complex *responses = _arenaAlloc(arena, (size_t) rank * size * sizeof(float complex));
+    float complex *y2 = _arenaAlloc(arena, size * sizeof(float complex));
+    int offset = w < n ? n/2 - w/2 : 0;
+    for (int k = 0; k < rank; k++) {
+        memset(y2, 0, size * sizeof(float complex));
+        for (int y = 0; y < w; y++) {
+            memcpy(&y2[(y+offset)*n+offset], &basis[k*taps+y*w], w * sizeof(float complex));
+        }
+        _conv2Hat(y2, y1Hat, &responses[(size_t) k * size], n, arena);
+        if (_controlStep(control)) {
+            _arenaRelease(arena, mark);
+            return;
+        }
+    }
+
+    // Combine the responses of each orientation, shifted by n/2 like in _fgc2, and sum up their magnitudes. The
+    // coefficients and the responses of a pixel are split into real and imaginary parts, which vectorizes.
+    float *coefficients = _arenaAlloc(arena, 2 * (size_t) amount * rank * sizeof(float));
+    float *pixel = _arenaAlloc(arena, 2 * rank * sizeof(float));
+    for (int j = 0; j < amount; j++) {
+        for (int k = 0; k < rank; k++) {
+            coefficients[2*j*rank+k] = crealf(vectors[j*amount+k]);
+            coefficients[(2*j+1)*rank+k] = cimagf(vectors[j*amount+k]);
+        }
+    }
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            size_t i = (size_t) ((y+n/2) % n) * n + (x+n/2) % n;
+            for (int k = 0; k < rank; k++) {
+                pixel[k] = crealf(responses[(size_t) k * size + i]);
+                pixel[rank+k] = cimagf(responses[(size_t) k * size + i]);
+            }
+            float sum = 0;
+            for (int j = 0; j < amount; j++) {
+                const float *real = &coefficients[2*j*rank];
+                const float *imag = &coefficients[(2*j+1)*rank];
+                float re = 0;
+                float im = 0;
+                for (int k = 0; k < rank; k++) {
+                    re += real[k]*pixel[k] - imag[k]*pixel[rank+k];
+                    im += real[k]*pixel[rank+k] + imag[k]*pixel[k];
+                }
+                sum += sqrtf(re*re + im*im);
+            }
+            yConvSum[y*n+x] = sum;
+        }
+    }
+    if (minMax != NULL) _minMax(yConvSum, size, &minMax[0], &minMax[1]);
+    _controlStep(control);
+
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Gets the arena bytes needed to design the basis, besides the basis itself.
+ */
+static size_t _steerableDesignArenaSize(int w, int amount) {
+    size_t size = 2 * amount;
+    return _arenaSize((size_t) amount * w * w * sizeof(float complex))
+        + _arenaSize(amount * sizeof(double))
+        + 2 * _arenaSize(size * size * sizeof(double))
+        + _arenaSize(amount * sizeof(double complex))
+        + _arenaSize(size * sizeof(int));
+}
+
+/**
+ * Gets the arena bytes needed by _fgc2SteerableRank.
+ */
+size_t _fgc2SteerableRankArenaSize(int n, float xi, float sigma, int amount) {
+    return _arenaSize((size_t) amount * amount * sizeof(float complex)) + _steerableDesignArenaSize(_steerableGrid(n, xi, sigma), amount);
+}
+
+/**
+ * Gets the arena bytes needed by _fgc2Steerable, which holds the responses of
+ * the rank basis filters at a time.
+ */
+size_t _fgc2SteerableArenaSize(int n, float xi, float sigma, int amount, int rank) {
+
+    int w = _steerableGrid(n, xi, sigma);
+    size_t matrixSize = _arenaSize((size_t) n * n * sizeof(float complex));
+    size_t basisSize = _arenaSize((size_t) amount * amount * sizeof(float complex)) + _arenaSize((size_t) rank * w * w * sizeof(float complex));
+    size_t spectrumSize = 2 * matrixSize + _fft2ArenaSize(n);
+    size_t responsesSize = matrixSize + _arenaSize((size_t) rank * n * n * sizeof(float complex)) + matrixSize;
+    size_t convolutionSize = responsesSize + _conv2HatArenaSize(n);
+    size_t combinationSize = responsesSize + _arenaSize(2 * (size_t) amount * rank * sizeof(float)) + _arenaSize(2 * rank * sizeof(float));
+    size_t designSize = _steerableDesignArenaSize(w, amount);
+
+    size_t size = spectrumSize > convolutionSize ? spectrumSize : convolutionSize;
+    size = size > combinationSize ? size : combinationSize;
+    return basisSize + (designSize > size ? designSize : size);
+
+}
@@ -0,0 +1,14 @@
+#include <stddef.h>
+#include "arena.h"
+#include "control.h"
+
+#ifndef STEERABLE_H
+#define STEERABLE_H
+
+int _fgc2SteerableRank(int n, float xi, float sigma, float lambda, float theta, int amount, float tolerance, Arena *arena);
+void _fgc2Steerable(float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int amount, int rank, float *minMax, Control *control, Arena *arena);
+
+size_t _fgc2SteerableRankArenaSize(int n, float xi, float sigma, int amount);
+size_t _fgc2SteerableArenaSize(int n, float xi, float sigma, int amount, int rank);
+
+#endif
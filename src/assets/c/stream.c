@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <complex.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "arena.h"
+#include "error.h"
+#include "fourier.h"
+#include "gabor.h"
+#include "image.h"
+#include "stream.h"
+
+/**
+ * Writes the rows of a tile of the result at column x0 and row y0 into a file
+ * of width*height floats. Returns 0 on success.
+ */
+static int _writeTile(int fd, float *values, int x0, int y0, int cols, int rows, int width) {
+
+    for (int y = 0; y < rows; y++) {
+        size_t bytes = cols * sizeof(float);
+        off_t offset = ((off_t) (y0 + y) * width + x0) * sizeof(float);
+        if (pwrite(fd, &values[y * cols], bytes, offset) != (ssize_t) bytes) return 1;
+    }
+
+    return 0;
+
+}
+
+/**
+ * Calculates the 2D Gabor convolution of a mapped image of any size, with the
+ * filter truncated to 4 standard deviations, tile by tile by the overlap-save
+ * method, and writes it as raw floats to the output file. The image wraps
+ * around its edges like the Fourier method. The spectra of the filters are
+ * calculated once, and the spectrum of each tile is shared by all
+ * orientations. As the tiles are read and written one after the other and the
+ * rows of the image are released once they are done, the memory does not
+ * depend on the image size. tile must be a power of 2 greater than 2 times
+ * the filter radius. Returns 0 on success.
+ */
+int _fgc2Stream(MappedImage *image, const char *output, float xi, float sigma, float lambda, float theta, int amount, int tile, Arena *arena) {
+
+    int radius = _filterRadius(xi, sigma);
+    int t = tile;
+    int valid = t - 2*radius;
+    int w = 2*radius+1;
+    int width = image->width;
+    int height = image->height;
+    if (t < 2 || (t & (t-1)) || valid < 1) {
+        _error("Error in stream: Tile must be a power of 2 greater than %d.\n", 2*radius);
+        return 1;
+    }
+
+    int fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t) width * height * sizeof(float)) != 0) {
+        _error("Error in stream: Could not write %s.\n", output);
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+
+    size_t mark = _arenaMark(arena);
+    size_t tileSize = (size_t) t * t;
+
+    // Place the filter windows around the origin of a tile and transform them
+    float complex *y2Hats = _arenaAlloc(arena, amount * tileSize * sizeof(float complex));
+    float complex *window = _arenaAlloc(arena, w * w * sizeof(float complex));
+    float complex *block = _arenaAlloc(arena, tileSize * sizeof(float complex));
+    float pi = acos(-1.0);
+    for (int j = 0; j < amount; j++) {
+        _normalizedFilterWindow2(window, radius, xi, sigma, lambda, theta + pi*j/amount);
+        for (size_t k = 0; k < tileSize; k++) {
+            block[k] = 0;
+        }
+        for (int y = 0; y < w; y++) {
+            for (int x = 0; x < w; x++) {
+                block[((y-radius) & (t-1))*t + ((x-radius) & (t-1))] = window[y*w+x];
+            }
+        }
+        _fft2(block, &y2Hats[j * tileSize], t, arena);
+    }
+
+    float complex *blockHat = _arenaAlloc(arena, tileSize * sizeof(float complex));
+    float complex *blockConvHat = _arenaAlloc(arena, tileSize * sizeof(float complex));
+    float complex *blockConv = _arenaAlloc(arena, tileSize * sizeof(float complex));
+    float *row = _arenaAlloc(arena, t * sizeof(float));
+    float *yConvSum = _arenaAlloc(arena, (size_t) valid * valid * sizeof(float));
+
+    int failed = 0;
+    for (int oy = 0; oy < height && !failed; oy += valid) {
+        for (int ox = 0; ox < width && !failed; ox += valid) {
+
+            // Gather the tile with a margin of radius, wrapping around the edges
+            for (int y = 0; y < t; y++) {
+                int imageY = ((oy - radius + y) % height + height) % height;
+                _readMappedRow(image, imageY, ox - radius, t, row);
+                for (int x = 0; x < t; x++) {
+                    block[y*t+x] = row[x];
+                }
+            }
+            _fft2(block, blockHat, t, arena);
+
+            // Keep the values that are not affected by the circular convolution of the tile
+            int rows = height - oy < valid ? height - oy : valid;
+            int cols = width - ox < valid ? width - ox : valid;
+            for (int j = 0; j < amount; j++) {
+                for (size_t k = 0; k < tileSize; k++) {
+                    blockConvHat[k] = blockHat[k] * y2Hats[j * tileSize + k];
+                }
+                _ifft2(blockConvHat, blockConv, t, arena);
+                for (int y = 0; y < rows; y++) {
+                    for (int x = 0; x < cols; x++) {
+                        float yConvAbs = cabsf(blockConv[(y+radius)*t + x+radius]);
+                        if (j == 0) yConvSum[y*cols+x] = yConvAbs;
+                        else yConvSum[y*cols+x] += yConvAbs;
+                    }
+                }
+            }
+
+            failed = _writeTile(fd, yConvSum, ox, oy, cols, rows, width);
+
+        }
+
+        // The rows above the next band of tiles are not needed anymore
+        _releaseMappedRows(image, oy + valid - radius);
+    }
+
+    if (close(fd) != 0 || failed) {
+        _error("Error in stream: Could not write %s.\n", output);
+        failed = 1;
+    }
+
+    _arenaRelease(arena, mark);
+
+    return failed;
+
+}
+
+/**
+ * Gets the arena bytes needed by _fgc2Stream.
+ */
+size_t _fgc2StreamArenaSize(int amount, int radius, int tile) {
+
+    size_t w = 2*radius+1;
+    size_t tileSize = _arenaSize((size_t) tile * tile * sizeof(float complex));
+    size_t valid = tile - 2*radius;
+
+    return amount * _arenaSize((size_t) tile * tile * sizeof(float complex))
+        + _arenaSize(w * w * sizeof(float complex))
+        + 4 * tileSize
+        + _arenaSize(tile * sizeof(float))
+        + _arenaSize(valid * valid * sizeof(float))
+        + _fft2ArenaSize(tile);
+
+}
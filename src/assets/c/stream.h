@@ -0,0 +1,12 @@
+#include <stddef.h>
+#include "arena.h"
+#include "image.h"
+
+#ifndef STREAM_H
+#define STREAM_H
+
+int _fgc2Stream(MappedImage *image, const char *output, float xi, float sigma, float lambda, float theta, int amount, int tile, Arena *arena);
+
+size_t _fgc2StreamArenaSize(int amount, int radius, int tile);
+
+#endif
@@ -0,0 +1,341 @@
+#include <stdlib.h>
+#include <complex.h>
+#include <math.h>
+#include <pthread.h>
+#include "arena.h"
+#include "control.h"
+#include "error.h"
+#include "fourier.h"
+#include "transform.h"
+
+/**
+ * The state of a transform shared by the threads of the pool. The threads take
+ * the rows of the lattice one after the other.
+ */
+typedef struct Transform {
+    Lattice *lattice;
+    float *window;
+    float *f;
+    float complex *coefficients;
+    float *sum;
+    int inverse;
+    Control *control;
+    int next;
+    int failed;
+    pthread_mutex_t lock;
+} Transform;
+
+/**
+ * Wraps a coordinate into [0, n).
+ */
+static inline int _wrap(int v, int n) {
+    v %= n;
+    return v < 0 ? v + n : v;
+}
+
+/**
+ * Gets the lattice of the 2D Gabor transform of an image of width*height with
+ * a Gaussian window of given sigma centered every step pixels. The window is
+ * truncated to 4 standard deviations and its local transforms are of the
+ * smallest power of 2 that holds it. The step must not exceed that radius, so
+ * that every pixel is covered well enough to be reconstructed. Returns 0 on
+ * success.
+ */
+int _fgt2Lattice(Lattice *lattice, int width, int height, float sigma, int step) {
+
+    if (width < 1 || height < 1 || !(sigma > 0)) {
+        _error("Error in fgt2: Image and sigma must not be empty.\n");
+        return 1;
+    }
+
+    int radius = (int) ceilf(4 * sigma);
+    if (step < 1 || step > radius) {
+        _error("Error in fgt2: Step must be between 1 and the radius %d of the window.\n", radius);
+        return 1;
+    }
+
+    int size = 2;
+    while (size <= 2 * radius) size *= 2;
+
+    *lattice = (Lattice) {width, height, sigma, step, radius, size, (height + step - 1) / step, (width + step - 1) / step};
+
+    return 0;
+
+}
+
+/**
+ * Gets the amount of complex coefficients of a lattice.
+ */
+size_t _fgt2Count(Lattice *lattice) {
+    return (size_t) lattice->rows * lattice->cols * lattice->size * lattice->size;
+}
+
+/**
+ * Generates the truncated Gaussian window of a lattice with its center at
+ * index 0, so that the phases of the coefficients refer to the centers of the
+ * windows.
+ */
+static void _fgt2Window(Lattice *lattice, float *window) {
+
+    int size = lattice->size;
+    float r2 = (float) lattice->radius * lattice->radius;
+    float s2 = 2 * lattice->sigma * lattice->sigma;
+
+    for (int y = 0; y < size; y++) {
+        int dy = y < size/2 ? y : y - size;
+        for (int x = 0; x < size; x++) {
+            int dx = x < size/2 ? x : x - size;
+            float d2 = (float) dx * dx + (float) dy * dy;
+            window[y*size+x] = d2 <= r2 ? expf(-d2 / s2) : 0;
+        }
+    }
+
+}
+
+/**
+ * Takes the index of the next row of the lattice. Returns -1 if all rows have
+ * been taken or the transform is cancelled.
+ */
+static int _fgt2Next(Transform *transform) {
+
+    pthread_mutex_lock(&transform->lock);
+    int row = transform->next < transform->lattice->rows && !_controlCancelled(transform->control) ? transform->next++ : -1;
+    pthread_mutex_unlock(&transform->lock);
+
+    return row;
+
+}
+
+/**
+ * Transforms the windows of one row of the lattice, each in place in its
+ * coefficients.
+ */
+static void _fgt2Row(Transform *transform, int p, Arena *arena) {
+
+    Lattice *lattice = transform->lattice;
+    int size = lattice->size;
+    int y0 = p * lattice->step;
+
+    for (int q = 0; q < lattice->cols; q++) {
+
+        int x0 = q * lattice->step;
+        float complex *block = &transform->coefficients[((size_t) p * lattice->cols + q) * size * size];
+        for (int y = 0; y < size; y++) {
+            const float *row = &transform->f[(size_t) _wrap(y0 + (y < size/2 ? y : y - size), lattice->height) * lattice->width];
+            const float *window = &transform->window[y*size];
+            for (int x = 0; x < size; x++) {
+                block[y*size+x] = window[x] != 0 ? window[x] * row[_wrap(x0 + (x < size/2 ? x : x - size), lattice->width)] : 0;
+            }
+        }
+
+        _fft2InPlace(block, size, arena);
+
+    }
+
+}
+
+/**
+ * Transforms back the windows of one row of the lattice and adds them,
+ * weighted by the window once more, to the sum of the thread.
+ */
+static void _ifgt2Row(Transform *transform, int p, float complex *block, float *sum, Arena *arena) {
+
+    Lattice *lattice = transform->lattice;
+    int size = lattice->size;
+    int y0 = p * lattice->step;
+
+    for (int q = 0; q < lattice->cols; q++) {
+
+        int x0 = q * lattice->step;
+        const float complex *coefficients = &transform->coefficients[((size_t) p * lattice->cols + q) * size * size];
+        for (int i = 0; i < size*size; i++) {
+            block[i] = coefficients[i];
+        }
+
+        _ifft2InPlace(block, size, arena);
+
+        for (int y = 0; y < size; y++) {
+            float *row = &sum[(size_t) _wrap(y0 + (y < size/2 ? y : y - size), lattice->height) * lattice->width];
+            const float *window = &transform->window[y*size];
+            for (int x = 0; x < size; x++) {
+                if (window[x] != 0) row[_wrap(x0 + (x < size/2 ? x : x - size), lattice->width)] += window[x] * crealf(block[y*size+x]);
+            }
+        }
+
+    }
+
+}
+
+/**
+ * Transforms rows of the lattice until all rows have been taken. Each thread
+ * has its own arena for the local transforms, which are all of the same size,
+ * and for the inverse its own sum of the windows, which is added to the shared
+ * one at the end.
+ */
+static void *_fgt2Worker(void *argument) {
+
+    Transform *transform = argument;
+    Lattice *lattice = transform->lattice;
+    size_t blockSize = (size_t) lattice->size * lattice->size * sizeof(float complex);
+    size_t imageSize = (size_t) lattice->width * lattice->height;
+
+    Arena arena = {0};
+    size_t inverseSize = transform->inverse ? _arenaSize(blockSize) + _arenaSize(imageSize * sizeof(float)) : 0;
+    if (_arenaReserve(&arena, inverseSize + _fft2InPlaceArenaSize(lattice->size))) {
+        pthread_mutex_lock(&transform->lock);
+        transform->failed = 1;
+        pthread_mutex_unlock(&transform->lock);
+        return NULL;
+    }
+
+    float complex *block = NULL;
+    float *sum = NULL;
+    if (transform->inverse) {
+        block = _arenaAlloc(&arena, blockSize);
+        sum = _arenaAlloc(&arena, imageSize * sizeof(float));
+        for (size_t i = 0; i < imageSize; i++) {
+            sum[i] = 0;
+        }
+    }
+
+    int p;
+    while ((p = _fgt2Next(transform)) >= 0) {
+        if (transform->inverse) _ifgt2Row(transform, p, block, sum, &arena);
+        else _fgt2Row(transform, p, &arena);
+        _controlStep(transform->control);
+    }
+
+    if (transform->inverse) {
+        pthread_mutex_lock(&transform->lock);
+        for (size_t i = 0; i < imageSize; i++) {
+            transform->sum[i] += sum[i];
+        }
+        pthread_mutex_unlock(&transform->lock);
+    }
+
+    _arenaDestroy(&arena);
+
+    return NULL;
+
+}
+
+/**
+ * Runs a transform on a pool of threads, including the calling one. Returns 0
+ * if all rows of the lattice have been transformed.
+ */
+static int _fgt2Run(Transform *transform, int threads) {
+
+    pthread_mutex_init(&transform->lock, NULL);
+    _controlBegin(transform->control, transform->lattice->rows);
+
+    // Start the pool, no more threads than rows
+    threads = threads < transform->lattice->rows ? threads : transform->lattice->rows;
+    pthread_t *pool = malloc((threads > 1 ? threads - 1 : 1) * sizeof(pthread_t));
+    int started = 0;
+    while (started < threads - 1 && pthread_create(&pool[started], NULL, _fgt2Worker, transform) == 0) {
+        started++;
+    }
+
+    _fgt2Worker(transform);
+
+    for (int t = 0; t < started; t++) {
+        pthread_join(pool[t], NULL);
+    }
+    free(pool);
+
+    pthread_mutex_destroy(&transform->lock);
+
+    // Rows are only left if the transform is cancelled or no thread could reserve its arena
+    return transform->failed || transform->next < transform->lattice->rows;
+
+}
+
+/**
+ * Calculates the 2D Gabor transform of a real image f on a lattice, see
+ * _fgt2Lattice. The image is multiplied with the window at each point of the
+ * lattice, wrapping around the edges, and transformed locally. The
+ * coefficients are saved as [rows][cols][size][size] complex values, where
+ * the last two dimensions are the frequencies of the local transform in y and
+ * x. The rows of the lattice are spread over a pool of threads and are the
+ * steps of the control, if given; once it is cancelled, no more rows are
+ * taken. Returns 0 on success.
+ */
+int _fgt2(Lattice *lattice, float *f, float complex *coefficients, int threads, Control *control, Arena *arena) {
+
+    size_t mark = _arenaMark(arena);
+    float *window = _arenaAlloc(arena, (size_t) lattice->size * lattice->size * sizeof(float));
+    _fgt2Window(lattice, window);
+
+    Transform transform = {lattice, window, f, coefficients, NULL, 0, control, 0, 0};
+    int failed = _fgt2Run(&transform, threads);
+
+    _arenaRelease(arena, mark);
+
+    return failed;
+
+}
+
+/**
+ * Calculates the inverse of the 2D Gabor transform _fgt2 and saves the real
+ * image into f. The windows are transformed back, weighted by the window once
+ * more and summed up, and the sum is divided by the sum of the squared windows
+ * at each pixel, which is exact, since each window is no larger than its local
+ * transform. The threads and the control are like in _fgt2. Returns 0 on
+ * success.
+ */
+int _ifgt2(Lattice *lattice, float complex *coefficients, float *f, int threads, Control *control, Arena *arena) {
+
+    int size = lattice->size;
+    size_t imageSize = (size_t) lattice->width * lattice->height;
+    size_t mark = _arenaMark(arena);
+
+    float *window = _arenaAlloc(arena, (size_t) size * size * sizeof(float));
+    float *weight = _arenaAlloc(arena, imageSize * sizeof(float));
+    _fgt2Window(lattice, window);
+
+    // Sum up the squared windows
+    for (size_t i = 0; i < imageSize; i++) {
+        f[i] = 0;
+        weight[i] = 0;
+    }
+    for (int p = 0; p < lattice->rows; p++) {
+        for (int q = 0; q < lattice->cols; q++) {
+            for (int y = 0; y < size; y++) {
+                float *row = &weight[(size_t) _wrap(p * lattice->step + (y < size/2 ? y : y - size), lattice->height) * lattice->width];
+                for (int x = 0; x < size; x++) {
+                    float w = window[y*size+x];
+                    if (w != 0) row[_wrap(q * lattice->step + (x < size/2 ? x : x - size), lattice->width)] += w * w;
+                }
+            }
+        }
+    }
+
+    Transform transform = {lattice, window, NULL, coefficients, f, 1, control, 0, 0};
+    int failed = _fgt2Run(&transform, threads);
+
+    for (size_t i = 0; i < imageSize; i++) {
+        f[i] /= weight[i];
+    }
+
+    _arenaRelease(arena, mark);
+
+    return failed;
+
+}
+
+/**
+ * Gets the arena bytes needed by _fgt2 in the given arena, that is the window.
+ * Each thread reserves its own arena.
+ */
+size_t _fgt2ArenaSize(Lattice *lattice) {
+    return _arenaSize((size_t) lattice->size * lattice->size * sizeof(float));
+}
+
+/**
+ * Gets the arena bytes needed by _ifgt2 in the given arena. Each thread
+ * reserves its own arena.
+ */
+size_t _ifgt2ArenaSize(Lattice *lattice) {
+    size_t imageSize = (size_t) lattice->width * lattice->height;
+    return _fgt2ArenaSize(lattice) + _arenaSize(imageSize * sizeof(float));
+}
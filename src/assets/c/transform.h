@@ -0,0 +1,34 @@
+#include <complex.h>
+#include <stddef.h>
+#include "arena.h"
+#include "control.h"
+
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+/**
+ * Lattice of the 2D Gabor transform of an image of width*height. The windows
+ * are centered every step pixels and cover size*size pixels, of which those
+ * within radius of the center are non-zero. The coefficients are saved as
+ * [rows][cols][size][size] complex values.
+ */
+typedef struct Lattice {
+    int width;
+    int height;
+    float sigma;
+    int step;
+    int radius;
+    int size;
+    int rows;
+    int cols;
+} Lattice;
+
+int _fgt2Lattice(Lattice *lattice, int width, int height, float sigma, int step);
+size_t _fgt2Count(Lattice *lattice);
+int _fgt2(Lattice *lattice, float *f, float complex *coefficients, int threads, Control *control, Arena *arena);
+int _ifgt2(Lattice *lattice, float complex *coefficients, float *f, int threads, Control *control, Arena *arena);
+
+size_t _fgt2ArenaSize(Lattice *lattice);
+size_t _ifgt2ArenaSize(Lattice *lattice);
+
+#endif
@@ -0,0 +1,432 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "arena.h"
+#include "control.h"
+#include "error.h"
+#include "gabor.h"
+#include "tuner.h"
+
+/**
+ * Names of the strategies in the wisdom text, by strategy number.
+ */
+static const char *strategyNames[] = {"fft", "direct", "tiled", "inplace"};
+
+/**
+ * The maximum size of the sample image on which the spatial strategies are
+ * measured. Their time per pixel does not depend on the image size, so the
+ * time for the full image is extrapolated from the sample.
+ */
+static const int sampleSize = 128;
+
+/**
+ * Gets the current time in ms.
+ */
+static double _now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1e3 + time.tv_nsec / 1e6;
+}
+
+/**
+ * Gets the tile sizes worth trying for a filter radius, that is the smallest
+ * power of 2 of which at least half of the rows are valid, and the next one.
+ * Tiles of the image size or more are no better than the plain Fourier method.
+ * Returns the amount of tile sizes.
+ */
+static int _tileSizes(int n, int radius, int *tiles) {
+
+    int tile = 2;
+    while (tile < 4*radius) tile *= 2;
+
+    int count = 0;
+    for (int k = 0; k < 2 && tile < n; k++, tile *= 2) {
+        tiles[count++] = tile;
+    }
+
+    return count;
+
+}
+
+/**
+ * Gets the size of the sample image to measure a tile size on, which holds at
+ * least two tiles per direction.
+ */
+static int _tileSampleSize(int n, int tile) {
+    int size = 2*tile > sampleSize ? 2*tile : sampleSize;
+    return size < n ? size : n;
+}
+
+/**
+ * Gets the amount of tiles of given size for an image of size n*n.
+ */
+static double _tileCount(int n, int radius, int tile) {
+    int valid = tile - 2*radius;
+    double count = (n + valid - 1) / valid;
+    return count * count;
+}
+
+/**
+ * Finds the plan for a shape. Returns NULL if the shape has not been measured.
+ */
+Plan *_wisdomFind(Wisdom *wisdom, int n, int radius, int amount) {
+
+    for (int i = 0; i < wisdom->count; i++) {
+        Plan *plan = &wisdom->plans[i];
+        if (plan->n == n && plan->radius == radius && plan->amount == amount) return plan;
+    }
+
+    return NULL;
+
+}
+
+/**
+ * Adds a plan, replacing the plan of the same shape. If the wisdom is full,
+ * the oldest plan is dropped.
+ */
+void _wisdomAdd(Wisdom *wisdom, Plan plan) {
+
+    Plan *existing = _wisdomFind(wisdom, plan.n, plan.radius, plan.amount);
+    if (existing != NULL) {
+        *existing = plan;
+        return;
+    }
+
+    if (wisdom->count == WISDOM_CAPACITY) {
+        memmove(&wisdom->plans[0], &wisdom->plans[1], (WISDOM_CAPACITY - 1) * sizeof(Plan));
+        wisdom->count--;
+    }
+    wisdom->plans[wisdom->count++] = plan;
+
+}
+
+/**
+ * Checks if an imported plan can be run: n must be a power of 2, and a tile
+ * must be a power of 2 of at most n/2 that leaves valid rows and columns
+ * besides the margins of the filter, like the tiles _fgc2Tune tries.
+ */
+static int _planValid(Plan *plan) {
+
+    int n = plan->n;
+    if (n < 2 || (n & (n-1)) || plan->radius < 0 || plan->amount < 1) return 0;
+    if (plan->strategy != STRATEGY_TILED) return 1;
+
+    int tile = plan->tile;
+    return tile > 2*plan->radius+1 && tile <= n/2 && (tile & (tile-1)) == 0;
+
+}
+
+/**
+ * Adds the plans of a wisdom text, one per line as
+ * "fgc2 <n> <radius> <amount> <strategy> <tile>". Lines that cannot be parsed
+ * and plans that cannot be run are skipped. Returns the amount of plans added.
+ */
+int _wisdomImport(Wisdom *wisdom, const char *text) {
+
+    int count = 0;
+
+    while (text != NULL && *text != '\0') {
+
+        Plan plan;
+        char name[16];
+        if (sscanf(text, "fgc2 %d %d %d %15s %d", &plan.n, &plan.radius, &plan.amount, name, &plan.tile) == 5) {
+            for (int s = 0; s < (int) (sizeof(strategyNames) / sizeof(strategyNames[0])); s++) {
+                if (strcmp(name, strategyNames[s]) == 0) {
+                    plan.strategy = s;
+                    if (!_planValid(&plan)) break;
+                    _wisdomAdd(wisdom, plan);
+                    count++;
+                }
+            }
+        }
+
+        text = strchr(text, '\n');
+        if (text != NULL) text++;
+
+    }
+
+    return count;
+
+}
+
+/**
+ * Writes the wisdom as text of at most length bytes including the terminating
+ * null character. Returns the length of the full text like snprintf, so the
+ * text is complete if the result is less than length.
+ */
+int _wisdomExport(Wisdom *wisdom, char *text, size_t length) {
+
+    int total = 0;
+
+    for (int i = 0; i < wisdom->count; i++) {
+        Plan *plan = &wisdom->plans[i];
+        size_t offset = (size_t) total < length ? (size_t) total : length;
+        total += snprintf(text + offset, length - offset, "fgc2 %d %d %d %s %d\n",
+                          plan->n, plan->radius, plan->amount, strategyNames[plan->strategy], plan->tile);
+    }
+    if (wisdom->count == 0 && length > 0) text[0] = '\0';
+
+    return total;
+
+}
+
+/**
+ * Adds the plans of a wisdom file. A missing file is no error, as it is
+ * written after the first run. Returns 0 on success.
+ */
+int _wisdomLoad(Wisdom *wisdom, const char *path) {
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return 0;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *text = malloc(size + 1);
+    if (text == NULL || fread(text, 1, size, file) != (size_t) size) {
+        _error("Error in wisdom: Could not read %s.\n", path);
+        fclose(file);
+        free(text);
+        return 1;
+    }
+    text[size] = '\0';
+    fclose(file);
+
+    _wisdomImport(wisdom, text);
+    free(text);
+
+    return 0;
+
+}
+
+/**
+ * Writes the wisdom to a file. Returns 0 on success.
+ */
+int _wisdomSave(Wisdom *wisdom, const char *path) {
+
+    int length = _wisdomExport(wisdom, NULL, 0);
+    char *text = malloc(length + 1);
+    _wisdomExport(wisdom, text, length + 1);
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        _error("Error in wisdom: Could not write %s.\n", path);
+        free(text);
+        return 1;
+    }
+
+    size_t written = fwrite(text, 1, length, file);
+    fclose(file);
+    free(text);
+
+    return written != (size_t) length;
+
+}
+
+/**
+ * Measures the time in ms of one orientation of a spatial strategy on the top
+ * left sample*sample pixels of the input.
+ */
+static double _measureSample(Plan *plan, float *y1, int n, int sample, float xi, float sigma, float lambda, float theta, Arena *arena) {
+
+    size_t mark = _arenaMark(arena);
+
+    float *y1Sample = _arenaAlloc(arena, sample * sample * sizeof(float));
+    float *yConvSample = _arenaAlloc(arena, sample * sample * sizeof(float));
+    for (int y = 0; y < sample; y++) {
+        memcpy(&y1Sample[y*sample], &y1[y*n], sample * sizeof(float));
+    }
+
+    Plan samplePlan = *plan;
+    samplePlan.n = sample;
+    double start = _now();
+    _fgc2PlanOrientation(&samplePlan, y1Sample, NULL, yConvSample, sample, xi, sigma, lambda, theta, 0, 1, NULL, arena);
+    double time = _now() - start;
+
+    _arenaRelease(arena, mark);
+
+    return time;
+
+}
+
+/**
+ * Gets the plan for the shape of a 2D Gabor convolution. If the shape has not
+ * been measured yet, one orientation of each strategy is timed on the input,
+ * the time of the whole convolution is estimated from it and the fastest
+ * strategy is added to the wisdom.
+ */
+Plan _fgc2Tune(Wisdom *wisdom, float *y1, int n, float xi, float sigma, float lambda, float theta, int amount, Arena *arena) {
+
+    int radius = _filterRadius(xi, sigma);
+    Plan *known = _wisdomFind(wisdom, n, radius, amount);
+    if (known != NULL) return *known;
+
+    size_t mark = _arenaMark(arena);
+
+    // The Fourier method shares the spectrum of the input between the orientations
+    Plan best = {n, radius, amount, STRATEGY_FFT, 0};
+    float *yConvSum = _arenaAlloc(arena, n * n * sizeof(float));
+    float complex *y1Hat = _arenaAlloc(arena, n * n * sizeof(float complex));
+    double start = _now();
+    _fgc2Spectrum(y1, y1Hat, n, arena);
+    double spectrumTime = _now() - start;
+    start = _now();
+    _fgc2Orientation(y1Hat, yConvSum, n, xi, sigma, lambda, theta, 0, 1, NULL, arena);
+    double bestTime = spectrumTime + amount * (_now() - start);
+    _arenaRelease(arena, mark);
+
+    // The direct method, if the filter fits into the image
+    if (2*radius+1 < n) {
+        Plan plan = {n, radius, amount, STRATEGY_DIRECT, 0};
+        int sample = n < sampleSize ? n : sampleSize;
+        double scale = (double) n * n / ((double) sample * sample);
+        double time = amount * scale * _measureSample(&plan, y1, n, sample, xi, sigma, lambda, theta, arena);
+        if (time < bestTime) {
+            best = plan;
+            bestTime = time;
+        }
+    }
+
+    // The tiled method
+    int tiles[2];
+    int tileCount = _tileSizes(n, radius, tiles);
+    for (int k = 0; k < tileCount; k++) {
+        Plan plan = {n, radius, amount, STRATEGY_TILED, tiles[k]};
+        int sample = _tileSampleSize(n, tiles[k]);
+        double scale = _tileCount(n, radius, tiles[k]) / _tileCount(sample, radius, tiles[k]);
+        double time = amount * scale * _measureSample(&plan, y1, n, sample, xi, sigma, lambda, theta, arena);
+        if (time < bestTime) {
+            best = plan;
+            bestTime = time;
+        }
+    }
+
+    _wisdomAdd(wisdom, best);
+
+    return best;
+
+}
+
+/**
+ * Gets a plan for the shape of a 2D Gabor convolution whose arena fits into
+ * budget bytes, without measuring. The strategies are tried from the fastest
+ * to the one with the least memory: the Fourier method, the Fourier method
+ * with the transforms in place, which needs two matrices of n*n complex
+ * values, and the tiled method with the largest tile that fits. Returns 0 on
+ * success or 1 if not even the smallest tile fits.
+ */
+int _fgc2Budget(Plan *plan, int n, float xi, float sigma, int amount, size_t budget) {
+
+    int radius = _filterRadius(xi, sigma);
+    *plan = (Plan) {n, radius, amount, STRATEGY_FFT, 0};
+    if (_fgc2PlannedArenaSize(plan) <= budget) return 0;
+
+    plan->strategy = STRATEGY_IN_PLACE;
+    if (_fgc2PlannedArenaSize(plan) <= budget) return 0;
+
+    // Each tile needs to leave at least one valid row and column
+    plan->strategy = STRATEGY_TILED;
+    for (int tile = n/2; tile > 2*radius+1; tile /= 2) {
+        plan->tile = tile;
+        if (_fgc2PlannedArenaSize(plan) <= budget) return 0;
+    }
+
+    _error("Error in budget: No strategy for size %d needs at most %zu bytes.\n", n, budget);
+    return 1;
+
+}
+
+/**
+ * Calculates orientation j of amount orientations of the 2D Gabor convolution
+ * with the strategy of a plan and adds its magnitude to yConvSum like
+ * _fgc2Orientation. The Fourier methods need the spectrum y1Hat of the input,
+ * the other strategies the input y1 itself.
+ */
+void _fgc2PlanOrientation(Plan *plan, float *y1, float complex *y1Hat, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int j, int amount, float *minMax, Arena *arena) {
+
+    switch (plan->strategy) {
+        case STRATEGY_DIRECT:
+            _fgc2DirectOrientation(y1, yConvSum, n, xi, sigma, lambda, theta, j, amount, plan->radius, minMax, arena);
+            break;
+        case STRATEGY_TILED:
+            _fgc2TiledOrientation(y1, yConvSum, n, xi, sigma, lambda, theta, j, amount, plan->radius, plan->tile, minMax, arena);
+            break;
+        case STRATEGY_IN_PLACE: {
+            size_t mark = _arenaMark(arena);
+            float complex *yConv = _arenaAlloc(arena, (size_t) n * n * sizeof(float complex));
+            _fgc2InPlaceOrientation(y1Hat, yConv, yConvSum, n, xi, sigma, lambda, theta, j, amount, minMax, arena);
+            _arenaRelease(arena, mark);
+            break;
+        }
+        default:
+            _fgc2Orientation(y1Hat, yConvSum, n, xi, sigma, lambda, theta, j, amount, minMax, arena);
+    }
+
+}
+
+/**
+ * Calculates the 2D Gabor convolution like _fgc2 with the strategy of a plan.
+ * The spatial strategies have no transform of the input, so their steps of
+ * the control, if given, are the orientations only.
+ */
+void _fgc2Planned(Plan *plan, float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int amount, float *minMax, Control *control, Arena *arena) {
+
+    if (plan->strategy == STRATEGY_FFT) {
+        _fgc2(y1, yConvSum, n, xi, sigma, lambda, theta, amount, minMax, control, arena);
+        return;
+    }
+    if (plan->strategy == STRATEGY_IN_PLACE) {
+        _fgc2InPlace(y1, yConvSum, n, xi, sigma, lambda, theta, amount, minMax, control, arena);
+        return;
+    }
+
+    _controlBegin(control, amount);
+    for (int j = 0; j < amount && !_controlCancelled(control); j++) {
+        _fgc2PlanOrientation(plan, y1, NULL, yConvSum, n, xi, sigma, lambda, theta, j, amount, j == amount-1 ? minMax : NULL, arena);
+        _controlStep(control);
+    }
+
+}
+
+/**
+ * Gets the arena bytes needed by _fgc2Tune.
+ */
+size_t _fgc2TuneArenaSize(int n, float xi, float sigma) {
+
+    int radius = _filterRadius(xi, sigma);
+    size_t size = _arenaSize((size_t) n * n * sizeof(float)) + _fgc2ArenaSize(n);
+
+    // The samples of the spatial strategies
+    int sample = n < sampleSize ? n : sampleSize;
+    size_t sampleBytes = 2 * _arenaSize((size_t) sample * sample * sizeof(float)) + _fgc2DirectArenaSize(sample, radius);
+    size = sampleBytes > size ? sampleBytes : size;
+
+    int tiles[2];
+    int tileCount = _tileSizes(n, radius, tiles);
+    for (int k = 0; k < tileCount; k++) {
+        sample = _tileSampleSize(n, tiles[k]);
+        sampleBytes = 2 * _arenaSize((size_t) sample * sample * sizeof(float)) + _fgc2TiledArenaSize(radius, tiles[k]);
+        size = sampleBytes > size ? sampleBytes : size;
+    }
+
+    return size;
+
+}
+
+/**
+ * Gets the arena bytes needed by _fgc2Planned.
+ */
+size_t _fgc2PlannedArenaSize(Plan *plan) {
+    switch (plan->strategy) {
+        case STRATEGY_DIRECT:
+            return _fgc2DirectArenaSize(plan->n, plan->radius);
+        case STRATEGY_TILED:
+            return _fgc2TiledArenaSize(plan->radius, plan->tile);
+        case STRATEGY_IN_PLACE:
+            return _fgc2InPlaceArenaSize(plan->n);
+        default:
+            return _fgc2ArenaSize(plan->n);
+    }
+}
@@ -0,0 +1,53 @@
+#include <stddef.h>
+#include <complex.h>
+#include "arena.h"
+#include "control.h"
+
+#ifndef TUNER_H
+#define TUNER_H
+
+#define STRATEGY_FFT 0
+#define STRATEGY_DIRECT 1
+#define STRATEGY_TILED 2
+#define STRATEGY_IN_PLACE 3
+
+#define WISDOM_CAPACITY 128
+
+/**
+ * The strategy chosen for a shape of the 2D Gabor convolution, that is the
+ * image size n, the radius of the truncated filter and the amount of
+ * orientations. The tile size is only used by the tiled strategy.
+ */
+typedef struct Plan {
+    int n;
+    int radius;
+    int amount;
+    int strategy;
+    int tile;
+} Plan;
+
+/**
+ * The plans measured so far, which can be exported as text to keep them
+ * between runs.
+ */
+typedef struct Wisdom {
+    Plan plans[WISDOM_CAPACITY];
+    int count;
+} Wisdom;
+
+Plan *_wisdomFind(Wisdom *wisdom, int n, int radius, int amount);
+void _wisdomAdd(Wisdom *wisdom, Plan plan);
+int _wisdomImport(Wisdom *wisdom, const char *text);
+int _wisdomExport(Wisdom *wisdom, char *text, size_t length);
+int _wisdomLoad(Wisdom *wisdom, const char *path);
+int _wisdomSave(Wisdom *wisdom, const char *path);
+
+int _fgc2Budget(Plan *plan, int n, float xi, float sigma, int amount, size_t budget);
+Plan _fgc2Tune(Wisdom *wisdom, float *y1, int n, float xi, float sigma, float lambda, float theta, int amount, Arena *arena);
+void _fgc2PlanOrientation(Plan *plan, float *y1, float complex *y1Hat, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int j, int amount, float *minMax, Arena *arena);
+void _fgc2Planned(Plan *plan, float *y1, float *yConvSum, int n, float xi, float sigma, float lambda, float theta, int amount, float *minMax, Control *control, Arena *arena);
+
+size_t _fgc2TuneArenaSize(int n, float xi, float sigma);
+size_t _fgc2PlannedArenaSize(Plan *plan);
+
+#endif
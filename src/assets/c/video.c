@@ -0,0 +1,219 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "arena.h"
+#include "error.h"
+#include "gabor.h"
+#include "video.h"
+
+/**
+ * Opens the state of an incremental convolution of frames of size n*n with
+ * the given filter params. The tile size must be a power of 2 no larger than
+ * n; small tiles find small changes, but each run of tiles costs the overhead
+ * of a region. A tile changed if the mean absolute difference of its values
+ * to the input of the kept result exceeds the threshold, so 0 recalculates
+ * every tile that changed at all. Returns 0 on success.
+ */
+int _videoOpen(Video *video, int n, float xi, float sigma, float lambda, float theta, int amount, int tile, float threshold) {
+
+    *video = (Video) {n, xi, sigma, lambda, theta, amount, tile, 0, threshold, _filterRadius(xi, sigma)};
+
+    if (n < 2 || (n & (n-1)) || tile < 1 || (tile & (tile-1)) || tile > n || amount < 1 || threshold < 0) {
+        _error("Error in video: Frames must be of size n = 2^k with tiles of size 2^j <= n.\n");
+        return 1;
+    }
+
+    size_t size = (size_t) n * n;
+    video->tiles = n / tile;
+    video->input = malloc(size * sizeof(float));
+    video->result = malloc(size * sizeof(float));
+    video->changed = malloc((size_t) video->tiles * video->tiles);
+    video->dirty = malloc((size_t) video->tiles * video->tiles);
+    if (video->input == NULL || video->result == NULL || video->changed == NULL || video->dirty == NULL) {
+        _error("Error in video: Could not allocate the state of frames of size %d.\n", n);
+        _videoClose(video);
+        return 1;
+    }
+
+    return 0;
+
+}
+
+/**
+ * Checks if a tile of a frame differs from the kept input by more than the
+ * threshold on average. The sum stops as soon as it exceeds the threshold.
+ */
+static int _videoTileChanged(Video *video, float *frame, int tx, int ty) {
+
+    int n = video->n;
+    int tile = video->tile;
+    double limit = (double) video->threshold * tile * tile;
+    double sum = 0;
+
+    for (int y = ty * tile; y < (ty+1) * tile; y++) {
+        const float *a = &frame[(size_t) y * n + tx * tile];
+        const float *b = &video->input[(size_t) y * n + tx * tile];
+        for (int x = 0; x < tile; x++) {
+            sum += fabsf(a[x] - b[x]);
+        }
+        if (sum > limit) return 1;
+    }
+
+    return 0;
+
+}
+
+/**
+ * Marks the tiles of the result within the halo of a changed tile as dirty.
+ * The response at a value depends on the input within the radius of the
+ * filter, so the changed tiles are dilated by as many tiles as the radius
+ * spans, wrapping around the edges like the circular convolution.
+ */
+static int _videoDilate(Video *video) {
+
+    int tiles = video->tiles;
+    int halo = (video->radius + video->tile - 1) / video->tile;
+    halo = 2*halo+1 < tiles ? halo : tiles;
+    memset(video->dirty, 0, (size_t) tiles * tiles);
+
+    for (int ty = 0; ty < tiles; ty++) {
+        for (int tx = 0; tx < tiles; tx++) {
+            if (!video->changed[ty*tiles+tx]) continue;
+            for (int dy = -halo; dy <= halo; dy++) {
+                int y = ((ty + dy) % tiles + tiles) % tiles;
+                for (int dx = -halo; dx <= halo; dx++) {
+                    video->dirty[y*tiles + ((tx + dx) % tiles + tiles) % tiles] = 1;
+                }
+            }
+        }
+    }
+
+    int count = 0;
+    for (int i = 0; i < tiles * tiles; i++) {
+        count += video->dirty[i];
+    }
+
+    return count;
+
+}
+
+/**
+ * Recalculates the dirty tiles of the result from a frame. Consecutive dirty
+ * tiles of a row of tiles are calculated as one region.
+ */
+static void _videoRecalculate(Video *video, float *frame, Arena *arena) {
+
+    int n = video->n;
+    int tile = video->tile;
+    int tiles = video->tiles;
+    size_t mark = _arenaMark(arena);
+    float *region = _arenaAlloc(arena, (size_t) n * tile * sizeof(float));
+
+    for (int ty = 0; ty < tiles; ty++) {
+        int tx = 0;
+        while (tx < tiles) {
+
+            if (!video->dirty[ty*tiles+tx]) {
+                tx++;
+                continue;
+            }
+            int start = tx;
+            while (tx < tiles && video->dirty[ty*tiles+tx]) tx++;
+
+            int width = (tx - start) * tile;
+            _fgc2Region(frame, region, n, video->xi, video->sigma, video->lambda, video->theta, video->amount, start * tile, ty * tile, width, tile, NULL, NULL, arena);
+            for (int y = 0; y < tile; y++) {
+                memcpy(&video->result[(size_t) (ty * tile + y) * n + start * tile], &region[(size_t) y * width], width * sizeof(float));
+            }
+
+        }
+    }
+
+    _arenaRelease(arena, mark);
+
+}
+
+/**
+ * Calculates the 2D fast Gabor convolution of the next frame into
+ * video->result. The first frame is calculated as a whole. A later frame
+ * only recalculates the tiles within the filter radius of the tiles that
+ * changed, in the spatial domain with the filter truncated like _fgc2Region,
+ * and keeps the result elsewhere; once that costs more than the Fourier
+ * method, the frame is calculated as a whole again. Only the changed tiles
+ * are kept as input, so that changes below the threshold add up until they
+ * count. Returns the amount of tiles recalculated, or -1 on failure.
+ */
+int _videoFrame(Video *video, float *frame, Arena *arena) {
+
+    int n = video->n;
+    int tiles = video->tiles;
+    size_t size = (size_t) n * n;
+    if (_arenaReserve(arena, _videoArenaSize(video))) return -1;
+
+    int changed = 0;
+    for (int ty = 0; ty < tiles; ty++) {
+        for (int tx = 0; tx < tiles; tx++) {
+            int tileChanged = video->frames == 0 || _videoTileChanged(video, frame, tx, ty);
+            video->changed[ty*tiles+tx] = tileChanged;
+            changed += tileChanged;
+        }
+    }
+
+    int dirty = _videoDilate(video);
+    int area = dirty * video->tile * video->tile;
+    if (video->frames == 0 || !_fgc2RegionIsDirect(n, video->radius, area, 1)) {
+        _fgc2(frame, video->result, n, video->xi, video->sigma, video->lambda, video->theta, video->amount, NULL, NULL, arena);
+        dirty = tiles * tiles;
+    } else if (dirty > 0) {
+        _videoRecalculate(video, frame, arena);
+    }
+    _arenaReset(arena);
+
+    // Keep the input of the changed tiles only
+    int tile = video->tile;
+    if (video->frames == 0) {
+        memcpy(video->input, frame, size * sizeof(float));
+    } else {
+        for (int ty = 0; ty < tiles; ty++) {
+            for (int tx = 0; tx < tiles; tx++) {
+                if (!video->changed[ty*tiles+tx]) continue;
+                for (int y = ty * tile; y < (ty+1) * tile; y++) {
+                    memcpy(&video->input[(size_t) y * n + tx * tile], &frame[(size_t) y * n + tx * tile], tile * sizeof(float));
+                }
+            }
+        }
+    }
+
+    video->frames++;
+    video->dirtyTiles += changed;
+    video->recalculatedTiles += dirty;
+
+    return dirty;
+
+}
+
+/**
+ * Frees the state of an incremental convolution.
+ */
+void _videoClose(Video *video) {
+    free(video->input);
+    free(video->result);
+    free(video->changed);
+    free(video->dirty);
+    video->input = video->result = NULL;
+    video->changed = video->dirty = NULL;
+}
+
+/**
+ * Gets the arena bytes needed by _videoFrame, which is the larger of the
+ * whole convolution and a row of tiles with its region buffer.
+ */
+size_t _videoArenaSize(Video *video) {
+
+    int n = video->n;
+    size_t whole = _fgc2ArenaSize(n);
+    size_t row = _arenaSize((size_t) n * video->tile * sizeof(float)) + _fgc2RegionArenaSize(n, video->xi, video->sigma, n, video->tile);
+
+    return whole > row ? whole : row;
+
+}
@@ -0,0 +1,40 @@
+#include <stddef.h>
+#include "arena.h"
+
+#ifndef VIDEO_H
+#define VIDEO_H
+
+/**
+ * The state of an incremental 2D Gabor convolution of the frames of a video
+ * of size n*n. The frame is split into tiles*tiles tiles of size tile. The
+ * result of the last frame is kept along with the input it was calculated
+ * from, so that a frame only recalculates the tiles that changed by more
+ * than threshold on average, and the tiles within the filter radius of them.
+ */
+typedef struct Video {
+    int n;
+    float xi;
+    float sigma;
+    float lambda;
+    float theta;
+    int amount;
+    int tile;
+    int tiles;
+    float threshold;
+    int radius;
+    float *input;
+    float *result;
+    unsigned char *changed;
+    unsigned char *dirty;
+    int frames;
+    int dirtyTiles;
+    int recalculatedTiles;
+} Video;
+
+int _videoOpen(Video *video, int n, float xi, float sigma, float lambda, float theta, int amount, int tile, float threshold);
+int _videoFrame(Video *video, float *frame, Arena *arena);
+void _videoClose(Video *video);
+
+size_t _videoArenaSize(Video *video);
+
+#endif
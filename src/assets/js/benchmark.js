@@ -0,0 +1,67 @@
+"use strict";
+
+// Usage: node benchmark.js [n] [variant ...]
+// Measures fgc2 on a random image of size n*n (default 512) with each given build, or with each build this Node
+// supports, to compare the variants of compile.sh headless.
+
+const fs = require("fs");
+const path = require("path");
+const wasm = require("./wasmVariant.js");
+
+const n = parseInt(process.argv[2], 10) || 512;
+const amount = 4;
+const runs = 3;
+
+/**
+ * Gets the builds to measure, which are the supported ones that were compiled if none are given.
+ */
+const variants = function() {
+    if (process.argv.length > 3) return process.argv.slice(3);
+    const supported = wasm.wasmVariants.slice(wasm.wasmVariants.indexOf(wasm.wasmVariant()));
+    return supported.filter(function(variant) {
+        return fs.existsSync(path.join(__dirname, "..", "c", variant + ".wasm"));
+    });
+}
+
+/**
+ * Measures the best of some runs of fgc2 in ms.
+ */
+const measure = function(Module) {
+
+    const size = n * n;
+    const buffer1 = Module._malloc(size * Float32Array.BYTES_PER_ELEMENT);
+    const buffer2 = Module._malloc(size * Float32Array.BYTES_PER_ELEMENT);
+    const pixels = new Float32Array(Module.HEAPF32.buffer, buffer1, size);
+    for (let i = 0; i < size; i++) {
+        pixels[i] = Math.random() * 256;
+    }
+
+    var best = Infinity;
+    for (let run = 0; run < runs; run++) {
+        const start = process.hrtime.bigint();
+        Module.ccall(
+            "fgc2",
+            null,
+            ["number", "number", "number", "number", "number", "number", "number", "number"],
+            [buffer1, buffer2, n, 0.5, 1, 4, 0, amount]
+        );
+        best = Math.min(best, Number(process.hrtime.bigint() - start) / 1e6);
+    }
+
+    Module._free(buffer1);
+    Module._free(buffer2);
+
+    return best;
+
+}
+
+const run = async function() {
+    console.log("SIMD " + wasm.simdSupported() + ", threads " + wasm.threadsSupported() + ", n " + n);
+    for (const variant of variants()) {
+        const Module = await wasm.requireWasm(variant, {print: function() {}});
+        console.log(variant + ": " + measure(Module).toFixed(1) + " ms");
+    }
+    process.exit(0);
+}
+
+run();
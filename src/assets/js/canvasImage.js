@@ -0,0 +1,183 @@
+"use strict";
+
+var Module = {
+    locateFile: function (s) {
+        return '../c/' + s;
+    },
+    onRuntimeInitialized: function() {
+        runtimeInitialized = true;
+        canvasImage();
+    }
+};
+
+var runtimeInitialized = false;
+
+// Load the fastest build of the C code the client supports
+importScripts("wasmVariant.js");
+importWasm();
+
+// Requests that arrived before the runtime was initialized
+var requests = [];
+
+var onmessage = function(messageEvent) {
+    requests.push(messageEvent.data);
+    canvasImage();
+}
+
+var canvasImage = function() {
+
+    if (!runtimeInitialized) return;
+
+    while (requests.length > 0) {
+        const request = requests.shift();
+        try {
+            switch (request.operation) {
+                case "toGrayScale":
+                    toGrayScale(request);
+                    break;
+                case "getGrayScalePixels":
+                    getGrayScalePixels(request);
+                    break;
+                case "setGrayScalePixels":
+                    if (request.pixels.levels) {
+                        setLevels(request);
+                    } else {
+                        setPixels(request, "grayScaleToRgba", [request.adjustScale ? 1 : 0]);
+                    }
+                    break;
+                case "setColorScalePixels":
+                    setPixels(request, "colorScaleToRgba", []);
+                    break;
+                default:
+                    throw new Error("Unknown operation " + request.operation + ".");
+            }
+        } catch (e) {
+            console.error(e);
+            postMessage({id: request.id, error: e.message});
+        }
+    }
+
+}
+
+/**
+ * Draws a bitmap to an offscreen canvas and returns the canvas.
+ */
+var drawBitmap = function(bitmap) {
+    const canvas = new OffscreenCanvas(bitmap.width, bitmap.height);
+    canvas.getContext("2d").drawImage(bitmap, 0, 0);
+    bitmap.close();
+    return canvas;
+}
+
+/**
+ * Renders RGBA pixels of the wasm memory and posts them as a bitmap.
+ */
+var postRgba = function(id, buffer, width, height) {
+    const canvas = new OffscreenCanvas(width, height);
+    const rgba = new Uint8ClampedArray(Module.HEAPU8.buffer, buffer, 4 * width * height);
+    canvas.getContext("2d").putImageData(new ImageData(rgba.slice(), width, height), 0, 0);
+    const bitmap = canvas.transferToImageBitmap();
+    postMessage({id: id, bitmap: bitmap}, [bitmap]);
+}
+
+/**
+ * Converts a bitmap to gray scale.
+ */
+var toGrayScale = function(request) {
+
+    const canvas = drawBitmap(request.bitmap);
+    const imageData = canvas.getContext("2d").getImageData(0, 0, canvas.width, canvas.height);
+    const size = canvas.width * canvas.height;
+
+    const buffer = Module._malloc(imageData.data.length);
+    Module.HEAPU8.set(imageData.data, buffer);
+
+    Module.ccall("toGrayScale", null, ["number", "number"], [buffer, size]);
+
+    postRgba(request.id, buffer, canvas.width, canvas.height);
+    Module._free(buffer);
+
+}
+
+/**
+ * Gets the gray values of a bitmap.
+ */
+var getGrayScalePixels = function(request) {
+
+    const canvas = drawBitmap(request.bitmap);
+    const imageData = canvas.getContext("2d").getImageData(0, 0, canvas.width, canvas.height);
+    const size = canvas.width * canvas.height;
+
+    const buffer1 = Module._malloc(imageData.data.length);
+    const buffer2 = Module._malloc(size * Float32Array.BYTES_PER_ELEMENT);
+    Module.HEAPU8.set(imageData.data, buffer1);
+
+    Module.ccall("grayScale", null, ["number", "number", "number"], [buffer1, buffer2, size]);
+
+    const pixels = new Float32Array(Module.HEAPF32.buffer, buffer2, size).slice();
+    Module._free(buffer1);
+    Module._free(buffer2);
+
+    postMessage({id: request.id, pixels: pixels}, [pixels.buffer]);
+
+}
+
+/**
+ * Converts pixel values to RGBA pixels with the given C method and posts them as a bitmap.
+ */
+var setPixels = function(request, method, args) {
+
+    const size = request.width * request.height;
+    if (request.pixels.length !== size) {
+        throw new Error("Pixel data length does not match the canvas size.");
+    }
+
+    const buffer1 = Module._malloc(size * Float32Array.BYTES_PER_ELEMENT);
+    const buffer2 = Module._malloc(4 * size);
+    Module.HEAPF32.set(request.pixels, buffer1 >> 2);
+
+    Module.ccall(
+        method,
+        null,
+        ["number", "number", "number"].concat(args.map(function() { return "number"; })),
+        [buffer1, buffer2, size].concat(args)
+    );
+
+    postRgba(request.id, buffer2, request.width, request.height);
+    Module._free(buffer1);
+    Module._free(buffer2);
+
+}
+
+/**
+ * Converts quantized pixels to gray RGBA pixels and posts them as a bitmap. As the lowest level stands for the minimum,
+ * the gray value is the level times the step between two levels, scaled to the full range if adjustScale is set.
+ */
+var setLevels = function(request) {
+
+    const pixels = request.pixels;
+    const size = request.width * request.height;
+    if (pixels.levels.length !== size) {
+        throw new Error("Pixel data length does not match the canvas size.");
+    }
+
+    const diff = pixels.max - pixels.min;
+    const step = diff / (Math.pow(2, pixels.bits) - 1);
+    const scale = diff > 0 && request.adjustScale ? 256.0 / diff : 1;
+
+    const buffer1 = Module._malloc(pixels.levels.byteLength);
+    const buffer2 = Module._malloc(4 * size);
+    Module.HEAPU8.set(new Uint8Array(pixels.levels.buffer, pixels.levels.byteOffset, pixels.levels.byteLength), buffer1);
+
+    Module.ccall(
+        "levelsToRgba",
+        null,
+        ["number", "number", "number", "number", "number"],
+        [buffer1, pixels.bits, buffer2, size, scale * step]
+    );
+
+    postRgba(request.id, buffer2, request.width, request.height);
+    Module._free(buffer1);
+    Module._free(buffer2);
+
+}
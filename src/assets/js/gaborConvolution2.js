@@ -5,30 +5,109 @@ var Module = {
         return '../c/' + s;
     },
     onRuntimeInitialized: function() {
+        runtimeInitialized = true;
         gaborConvolution2();
     }
 };
 
-importScripts("../c/main.js");
+var runtimeInitialized = false;
 
-var f = [];
+// Load the fastest build of the C code the client supports
+importScripts("wasmVariant.js");
+importWasm();
+
+var f = null;
 var xi =  0;
 var sigma = 0;
 var lambda = 0;
 var theta = 0;
 var amount = 0;
 
+// Progressive mode: a low resolution preview followed by the running sum after the orientations
+var progressive = false;
+
+// Quantization of the result to 8 or 16 bit levels, or 0 for float values
+var bits = 0;
+
+// Relative error of a steerable basis that approximates the orientations, or 0 to calculate each orientation
+var tolerance = 0;
+
+// Control block [steps done, steps total, cancel flag], shared with the caller if possible
+var control = new Int32Array(3);
+
+// The control block in the wasm memory, which the C code updates, and whether it is the one shared with the caller
+var controlBuffer = 0;
+var controlShared = false;
+
+// Images of a batch, calculated instead of f, and the index of the first one in the whole batch
+var images = null;
+var firstIndex = 0;
+
+// Region {x, y, width, height} to calculate instead of the whole image
+var region = null;
+
+// Strategies measured for earlier shapes, as exported by the C code
+var wisdom = null;
+
+// Image {id, f} kept between jobs, so that the caller only posts it once, and the id and buffer of its copy in the wasm
+// memory, whose spectrum the C code keeps as well
+var image = null;
+var residentId = null;
+var residentBuffer = 0;
+
+// Number of the job at hand, which is posted along with its results, and the function that stops it if it is a
+// progressive job that is still in progress
+var job = 0;
+var stopProgressive = null;
+
+// The maximum size of the preview and the minimum time between two partial results in ms
+var previewSize = 128;
+var partialInterval = 250;
+
 var onmessage = function(messageEvent) {
-    f = messageEvent.data.f;
+    if (stopProgressive !== null) stopProgressive();
+    if (messageEvent.data.cancel) {
+        Atomics.store(control, 2, 1);
+        return;
+    }
+    job = messageEvent.data.job || 0;
+    if (messageEvent.data.imageId !== undefined) {
+        if (messageEvent.data.f) image = {id: messageEvent.data.imageId, f: messageEvent.data.f};
+        if (image === null || image.id !== messageEvent.data.imageId) {
+            postMessage({missing: true, job: job});
+            return;
+        }
+        f = image.f;
+    } else {
+        f = messageEvent.data.f || null;
+    }
+    images = messageEvent.data.images || null;
+    firstIndex = messageEvent.data.firstIndex || 0;
     xi =  messageEvent.data.xi;
     sigma = messageEvent.data.sigma;
     lambda = messageEvent.data.lambda;
     theta = messageEvent.data.theta;
     amount = messageEvent.data.amount;
+    progressive = messageEvent.data.progressive === true;
+    bits = messageEvent.data.bits === 8 || messageEvent.data.bits === 16 ? messageEvent.data.bits : 0;
+    tolerance = messageEvent.data.tolerance > 0 ? messageEvent.data.tolerance : 0;
+    if (messageEvent.data.control && !controlShared) control = messageEvent.data.control;
+    Atomics.store(control, 2, 0);
+    if (messageEvent.data.wisdom) wisdom = messageEvent.data.wisdom;
+    region = messageEvent.data.region || null;
+    gaborConvolution2();
 }
 
 var gaborConvolution2 = function() {
 
+    // Wait for both the runtime and the data
+    if (!runtimeInitialized || (f === null && images === null)) return;
+
+    if (images !== null) {
+        batchGaborConvolution2();
+        return;
+    }
+
     // Check size
     if (f.length <= 0) {
         console.error("Input data length is 0.");
@@ -40,31 +119,480 @@ var gaborConvolution2 = function() {
         return f;
     }
 
+    if (wisdom !== null) {
+        Module.ccall("importWisdom", "number", ["string"], [wisdom]);
+        wisdom = null;
+    }
+
+    setupControl();
+    syncControl();
+    makeResident(n);
+
+    if (region !== null) {
+        const fRegion = fgc2Region(f, n);
+        postMessage({fConv: fRegion, job: job}, [fRegion.buffer]);
+        return;
+    }
+
+    // The orientations of a steerable basis are all calculated at once
+    if (progressive && tolerance === 0) {
+        progressiveGaborConvolution2(n);
+        return;
+    }
+
     // Generate float arrays
     var fConv = new Float32Array(f.length); // convoluted image
 
     // Call c code
     try {
-        const buffer1 = Module._malloc(f.length * f.BYTES_PER_ELEMENT);
-        const buffer2 = Module._malloc(fConv.length * fConv.BYTES_PER_ELEMENT);
-        Module.HEAPF32.set(f, buffer1 >> 2);
-        Module.HEAPF32.set(fConv, buffer2 >> 2);
+        fConv = fgc2(f, n, sigma, lambda);
+    } catch (e) {
+        console.error(e);
+    }
+
+    syncControl();
+    if (Atomics.load(control, 2) !== 0) {
+        postMessage({cancelled: true, job: job});
+        return;
+    }
+
+    postMessage({fConv: fConv, wisdom: exportWisdom(), job: job}, [transferable(fConv)]);
+
+}
+
+/**
+ * Copies the kept image to the wasm memory, unless it is there already. The C code keeps it along with its spectrum
+ * until the next image.
+ */
+var makeResident = function(n) {
+
+    if (image === null || f !== image.f || residentId === image.id) return;
+
+    residentBuffer = Module.ccall("setImage", "number", ["number"], [n]);
+    if (residentBuffer === 0) {
+        residentId = null;
+        return;
+    }
+    Module.HEAPF32.set(image.f, residentBuffer >> 2);
+    residentId = image.id;
+
+}
+
+/**
+ * Checks if pixels are those of the image in the wasm memory.
+ */
+var isResident = function(pixels) {
+    return image !== null && pixels === image.f && residentId === image.id;
+}
+
+/**
+ * Gets a buffer in the wasm memory with the pixels, which is the kept image if they are its pixels or a copy
+ * otherwise, which is to be freed by freeInput.
+ */
+var inputBuffer = function(pixels) {
+    if (isResident(pixels)) return residentBuffer;
+    const buffer = Module._malloc(pixels.length * pixels.BYTES_PER_ELEMENT);
+    Module.HEAPF32.set(pixels, buffer >> 2);
+    return buffer;
+}
+
+/**
+ * Frees a buffer of inputBuffer, unless it is the kept image.
+ */
+var freeInput = function(buffer) {
+    if (buffer !== residentBuffer) Module._free(buffer);
+}
+
+/**
+ * Gives the C code a control block in the wasm memory. If the wasm memory is shared, which it is with the threaded
+ * build, the block itself is posted to the caller, who can then read the progress and cancel while the C code runs.
+ * Otherwise it is synchronized with the control block of the caller between the calls.
+ */
+var setupControl = function() {
+
+    if (controlBuffer !== 0) return;
+
+    controlBuffer = Module._malloc(3 * Int32Array.BYTES_PER_ELEMENT);
+    const wasmControl = new Int32Array(Module.HEAP32.buffer, controlBuffer, 3);
+    wasmControl.set([0, 0, Atomics.load(control, 2)]);
+    Module.ccall("setControl", null, ["number"], [controlBuffer]);
+
+    controlShared = typeof SharedArrayBuffer !== "undefined" && Module.HEAP32.buffer instanceof SharedArrayBuffer;
+    if (controlShared) {
+        control = wasmControl;
+        postMessage({control: control});
+    }
+
+}
+
+/**
+ * Copies the progress of the C code to the control block of the caller and the cancel flag back, unless they are the
+ * same block.
+ */
+var syncControl = function() {
+    if (controlShared) return;
+    const wasmControl = new Int32Array(Module.HEAP32.buffer, controlBuffer, 3);
+    Atomics.store(control, 0, wasmControl[0]);
+    Atomics.store(control, 1, wasmControl[1]);
+    wasmControl[2] = Atomics.load(control, 2);
+}
+
+/**
+ * Gets the strategies measured so far, so that the caller can keep them for the next worker.
+ */
+var exportWisdom = function() {
+    return Module.ccall("exportWisdom", "string", [], []);
+}
+
+/**
+ * Gets the buffer of a result to transfer it.
+ */
+var transferable = function(result) {
+    return result.levels ? result.levels.buffer : result.buffer;
+}
+
+/**
+ * Allocates the levels of a quantized result in the wasm memory.
+ */
+var mallocLevels = function(size) {
+    return Module._malloc(size * bits / 8);
+}
+
+/**
+ * Copies quantized levels and their range from the wasm memory.
+ */
+var copyLevels = function(levelsBuffer, scaleBuffer, size) {
+    const levels = bits === 16 ?
+        new Uint16Array(Module.HEAPU16.buffer, levelsBuffer, size).slice() :
+        new Uint8Array(Module.HEAPU8.buffer, levelsBuffer, size).slice();
+    const scale = new Float32Array(Module.HEAPF32.buffer, scaleBuffer, 2);
+    return {levels: levels, bits: bits, min: scale[0], max: scale[1]};
+}
+
+/**
+ * Calls the C method fgc2 for an image of size n*n and returns a copy of the result, which is quantized if bits is set.
+ */
+var fgc2 = function(pixels, n, sigma, lambda) {
+
+    const buffer1 = inputBuffer(pixels);
+
+    if (tolerance > 0) {
+        return fgc2Steerable(buffer1, pixels.length, n, sigma, lambda);
+    }
+
+    if (bits !== 0) {
+        const levelsBuffer = mallocLevels(pixels.length);
+        const scaleBuffer = Module._malloc(2 * Float32Array.BYTES_PER_ELEMENT);
 
         Module.ccall(
-            "fgc2",
+            "fgc2Quantized",
             null,
-            ["number", "number", "number", "number", "number", "number", "number", "number"],
-            [buffer1, buffer2, n, xi, sigma, lambda, theta, amount]
+            ["number", "number", "number", "number", "number", "number", "number", "number", "number", "number"],
+            [buffer1, levelsBuffer, scaleBuffer, n, xi, sigma, lambda, theta, amount, bits]
         );
 
-        fConv = new Float32Array(Module.HEAPF32.buffer, buffer2, fConv.length);
+        const quantized = copyLevels(levelsBuffer, scaleBuffer, pixels.length);
+        freeInput(buffer1);
+        Module._free(levelsBuffer);
+        Module._free(scaleBuffer);
+
+        return quantized;
+    }
+
+    const buffer2 = Module._malloc(pixels.length * pixels.BYTES_PER_ELEMENT);
+
+    Module.ccall(
+        "fgc2",
+        null,
+        ["number", "number", "number", "number", "number", "number", "number", "number"],
+        [buffer1, buffer2, n, xi, sigma, lambda, theta, amount]
+    );
+
+    const fConv = new Float32Array(Module.HEAPF32.buffer, buffer2, pixels.length).slice();
+    freeInput(buffer1);
+    Module._free(buffer2);
+
+    return fConv;
+
+}
+
+/**
+ * Calls the C method fgc2Steerable for an image of size n*n in buffer1 of inputBuffer, which is freed, and returns a copy of the
+ * result, which is quantized if bits is set.
+ */
+var fgc2Steerable = function(buffer1, size, n, sigma, lambda) {
+
+    const buffer2 = Module._malloc(size * Float32Array.BYTES_PER_ELEMENT);
+
+    Module.ccall(
+        "fgc2Steerable",
+        "number",
+        ["number", "number", "number", "number", "number", "number", "number", "number", "number"],
+        [buffer1, buffer2, n, xi, sigma, lambda, theta, amount, tolerance]
+    );
+    freeInput(buffer1);
+
+    var result;
+    if (bits !== 0) {
+        const levelsBuffer = mallocLevels(size);
+        const scaleBuffer = Module._malloc(2 * Float32Array.BYTES_PER_ELEMENT);
+        Module.ccall(
+            "quantize",
+            null,
+            ["number", "number", "number", "number", "number", "number"],
+            [buffer2, levelsBuffer, scaleBuffer, size, bits, 1]
+        );
+        result = copyLevels(levelsBuffer, scaleBuffer, size);
+        Module._free(levelsBuffer);
+        Module._free(scaleBuffer);
+    } else {
+        result = new Float32Array(Module.HEAPF32.buffer, buffer2, size).slice();
+    }
+    Module._free(buffer2);
+
+    return result;
+
+}
+
+/**
+ * Calculates the images of a batch with the spectra of the filters calculated once and posts each result as soon as
+ * it is done, followed by a message that the batch is done. If the spectra cannot be calculated, an error is posted
+ * instead.
+ */
+var batchGaborConvolution2 = function() {
+
+    const n = Math.sqrt(images[0].length);
+    const size = n * n;
+    const buffer1 = Module._malloc(size * Float32Array.BYTES_PER_ELEMENT);
+    const buffer2 = Module._malloc(size * Float32Array.BYTES_PER_ELEMENT);
+
+    const status = Module.ccall(
+        "fgc2BatchBegin",
+        "number",
+        ["number", "number", "number", "number", "number", "number"],
+        [n, xi, sigma, lambda, theta, amount]
+    );
+    if (status !== 0) {
+        Module.ccall("fgc2BatchEnd", null, [], []);
         Module._free(buffer1);
         Module._free(buffer2);
+        postMessage({error: "Could not start the batch of Gabor convolutions."});
+        return;
+    }
 
-    } catch (e) {
-        console.error(e);
+    for (let i = 0; i < images.length; i++) {
+        Module.HEAPF32.set(images[i], buffer1 >> 2);
+        Module.ccall("fgc2BatchImage", null, ["number", "number", "number"], [buffer1, buffer2, 0]);
+        const fConv = new Float32Array(Module.HEAPF32.buffer, buffer2, size).slice();
+        postMessage({index: firstIndex + i, fConv: fConv}, [fConv.buffer]);
+    }
+
+    Module.ccall("fgc2BatchEnd", null, [], []);
+    Module._free(buffer1);
+    Module._free(buffer2);
+
+    postMessage({done: true});
+
+}
+
+/**
+ * Calls the C method fgc2Region for an image of size n*n and returns a copy of the region, row by row.
+ */
+var fgc2Region = function(pixels, n) {
+
+    const size = region.width * region.height;
+    const buffer1 = inputBuffer(pixels);
+    const buffer2 = Module._malloc(size * pixels.BYTES_PER_ELEMENT);
+
+    Module.ccall(
+        "fgc2Region",
+        null,
+        ["number", "number", "number", "number", "number", "number", "number", "number", "number", "number", "number", "number"],
+        [buffer1, buffer2, n, xi, sigma, lambda, theta, amount, region.x, region.y, region.width, region.height]
+    );
+
+    const fRegion = new Float32Array(Module.HEAPF32.buffer, buffer2, size).slice();
+    freeInput(buffer1);
+    Module._free(buffer2);
+
+    return fRegion;
+
+}
+
+/**
+ * Posts a low resolution preview first and then calculates one orientation after the other. The running sum is
+ * posted at most every partialInterval ms and the job is cancelled between two orientations if requested, or stopped
+ * by the next job. The spectrum of the kept image is only calculated by its first job.
+ */
+var progressiveGaborConvolution2 = function(n) {
+
+    const progressiveJob = job;
+
+    // Calculate the preview on a downsampled image with a filter scaled accordingly, which is not counted as progress
+    const m = Math.min(n, previewSize);
+    if (m < n) {
+        Module.ccall("setControl", null, ["number"], [0]);
+        try {
+            const preview = fgc2(downsample(f, n, m), m, sigma * m / n, lambda * m / n);
+            if (preview.levels) preview.levels = upsample(preview.levels, m, n);
+            const result = preview.levels ? preview : upsample(preview, m, n);
+            postMessage({preview: result, progress: 0, job: progressiveJob}, [transferable(result)]);
+        } catch (e) {
+            console.error(e);
+        }
+        Module.ccall("setControl", null, ["number"], [controlBuffer]);
+    }
+
+    const buffer2 = Module._malloc(f.length * f.BYTES_PER_ELEMENT);
+    const levelsBuffer = bits !== 0 ? mallocLevels(f.length) : 0;
+    const scaleBuffer = Module._malloc(2 * Float32Array.BYTES_PER_ELEMENT);
+
+    // The status is 0 on success, otherwise the C code printed the error and nothing was calculated
+    var status;
+    if (isResident(f)) {
+        status = Module.ccall(
+            "fgc2BeginImage",
+            "number",
+            ["number", "number", "number", "number", "number"],
+            [xi, sigma, lambda, theta, amount]
+        );
+    } else {
+        const buffer1 = inputBuffer(f);
+        status = Module.ccall(
+            "fgc2Begin",
+            "number",
+            ["number", "number", "number", "number", "number", "number", "number"],
+            [buffer1, n, xi, sigma, lambda, theta, amount]
+        );
+        freeInput(buffer1);
+    }
+    syncControl();
+
+    var j = 0;
+    var lastPost = Date.now();
+
+    const quantize = function(track) {
+        Module.ccall(
+            "quantize",
+            null,
+            ["number", "number", "number", "number", "number", "number"],
+            [buffer2, levelsBuffer, scaleBuffer, f.length, bits, track ? 1 : 0]
+        );
+        return copyLevels(levelsBuffer, scaleBuffer, f.length);
+    };
+
+    const end = function() {
+        stopProgressive = null;
+        Module.ccall("fgc2End", null, [], []);
+        Module._free(buffer2);
+        Module._free(scaleBuffer);
+        if (levelsBuffer !== 0) Module._free(levelsBuffer);
+    };
+
+    if (status !== 0) {
+        end();
+        postMessage({error: "Could not start the Gabor convolution.", job: progressiveJob});
+        return;
+    }
+
+    var stopped = false;
+    stopProgressive = function() {
+        stopped = true;
+        end();
+        postMessage({cancelled: true, job: progressiveJob});
+    };
+
+    const step = function() {
+
+        if (stopped) return;
+
+        syncControl();
+        if (Atomics.load(control, 2) !== 0) {
+            end();
+            postMessage({cancelled: true, job: progressiveJob});
+            return;
+        }
+
+        // Track the range of the last orientation, if the result is quantized
+        const last = j === amount - 1;
+        Module.ccall(
+            "fgc2Orientation",
+            null,
+            ["number", "number", "number", "number", "number", "number", "number", "number", "number"],
+            [buffer2, n, xi, sigma, lambda, theta, j, amount, last && bits !== 0 ? scaleBuffer : 0]
+        );
+        j++;
+        syncControl();
+
+        if (last) {
+            const fConv = bits !== 0 ? quantize(false) : new Float32Array(Module.HEAPF32.buffer, buffer2, f.length).slice();
+            end();
+            postMessage({fConv: fConv, progress: 1, wisdom: exportWisdom(), job: progressiveJob}, [transferable(fConv)]);
+            return;
+        }
+
+        // Post the running sum scaled to the brightness of the full sum
+        if (Date.now() - lastPost >= partialInterval) {
+            const scale = amount / j;
+            var partial;
+            if (bits !== 0) {
+                partial = quantize(true);
+                partial.min *= scale;
+                partial.max *= scale;
+            } else {
+                partial = new Float32Array(Module.HEAPF32.buffer, buffer2, f.length).slice();
+                for (let i = 0; i < partial.length; i++) {
+                    partial[i] *= scale;
+                }
+            }
+            postMessage({partial: partial, progress: j / amount, job: progressiveJob}, [transferable(partial)]);
+            lastPost = Date.now();
+        }
+
+        // Yield, so that a cancel message can be received
+        setTimeout(step, 0);
+
+    };
+
+    step();
+
+}
+
+/**
+ * Downsamples an image of size n*n to m*m by averaging blocks.
+ */
+var downsample = function(pixels, n, m) {
+
+    const k = n / m;
+    const result = new Float32Array(m * m);
+
+    for (let y = 0; y < n; y++) {
+        for (let x = 0; x < n; x++) {
+            result[Math.floor(y / k) * m + Math.floor(x / k)] += pixels[y * n + x];
+        }
+    }
+    for (let i = 0; i < m * m; i++) {
+        result[i] /= k * k;
+    }
+
+    return result;
+
+}
+
+/**
+ * Upsamples an image of size m*m to n*n by repeating pixels.
+ */
+var upsample = function(pixels, m, n) {
+
+    const k = n / m;
+    const result = new pixels.constructor(n * n);
+
+    for (let y = 0; y < n; y++) {
+        for (let x = 0; x < n; x++) {
+            result[y * n + x] = pixels[Math.floor(y / k) * m + Math.floor(x / k)];
+        }
     }
 
-    postMessage({fConv: Array.from(fConv)});
+    return result;
 
 }
@@ -9,7 +9,9 @@ var Module = {
     }
 };
 
-importScripts("../c/main.js");
+// Load the fastest build of the C code the client supports
+importScripts("wasmVariant.js");
+importWasm();
 
 var n = 0;
 var xi =  0;
@@ -52,8 +54,8 @@ var normalizedFilter2 = function() {
             [buffer1, buffer2, n, xi, sigma, lambda, theta]
         );
 
-        gReal = new Float32Array(Module.HEAPF32.buffer, buffer1, gReal.length);
-        gImag = new Float32Array(Module.HEAPF32.buffer, buffer2, gImag.length);
+        gReal = new Float32Array(Module.HEAPF32.buffer, buffer1, gReal.length).slice();
+        gImag = new Float32Array(Module.HEAPF32.buffer, buffer2, gImag.length).slice();
         Module._free(buffer1);
         Module._free(buffer2);
 
@@ -61,6 +63,6 @@ var normalizedFilter2 = function() {
         console.error(e);
     }
 
-    postMessage({gReal: Array.from(gReal), gImag: Array.from(gImag)});
+    postMessage({gReal: gReal, gImag: gImag}, [gReal.buffer, gImag.buffer]);
 
 }
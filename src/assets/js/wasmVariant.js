@@ -0,0 +1,92 @@
+"use strict";
+
+// Builds of the C code from the fastest to the most compatible one, see compile.sh
+var wasmVariants = ["main-simd-threads", "main-simd", "main"];
+
+/**
+ * Checks if WebAssembly SIMD is supported by validating a function that splats a constant to a v128 value and counts
+ * its bits.
+ */
+var simdSupported = function() {
+    return typeof WebAssembly === "object" && WebAssembly.validate(new Uint8Array([
+        0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0, 10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11
+    ]));
+}
+
+/**
+ * Checks if WebAssembly threads are supported, that is shared memory, which browsers only allow on cross-origin
+ * isolated pages. Node has no such restriction.
+ */
+var threadsSupported = function() {
+    if (typeof WebAssembly !== "object" || typeof SharedArrayBuffer === "undefined") return false;
+    if (typeof crossOriginIsolated !== "undefined" && !crossOriginIsolated) return false;
+    try {
+        return new WebAssembly.Memory({initial: 1, maximum: 1, shared: true}).buffer instanceof SharedArrayBuffer;
+    } catch (e) {
+        return false;
+    }
+}
+
+/**
+ * Gets the name of the fastest build the client supports.
+ */
+var wasmVariant = function() {
+    if (simdSupported()) {
+        return threadsSupported() ? "main-simd-threads" : "main-simd";
+    }
+    return "main";
+}
+
+/**
+ * Loads the fastest build into a worker, which has defined Module before. If that build was not compiled, the next
+ * one is tried. The threads of the threaded build load the same script, which is thus given as absolute URL.
+ */
+var importWasm = function() {
+    const variants = wasmVariants.slice(wasmVariants.indexOf(wasmVariant()));
+    for (let i = 0; i < variants.length; i++) {
+        const url = new URL("../c/" + variants[i] + ".js", self.location.href).href;
+        Module.mainScriptUrlOrBlob = variants[i] === "main-simd-threads" ? url : undefined;
+        try {
+            importScripts(url);
+            return;
+        } catch (e) {
+            if (i === variants.length - 1) throw e;
+        }
+    }
+}
+
+/**
+ * Loads a build in Node, the fastest one if no variant is given, and resolves to its module as soon as the runtime is
+ * initialized. Like in a worker, Module is defined before the script runs, with the wasm binary read from the file and
+ * the given overrides, e.g. print.
+ */
+var requireWasm = function(variant, overrides) {
+
+    const fs = require("fs");
+    const path = require("path");
+    const file = path.join(__dirname, "..", "c", (variant || wasmVariant()) + ".js");
+
+    return new Promise(function(resolve) {
+        const Module = {
+            wasmBinary: fs.readFileSync(file.replace(/\.js$/, ".wasm")),
+            mainScriptUrlOrBlob: file,
+            onRuntimeInitialized: function() {
+                resolve(Module);
+            }
+        };
+        Object.assign(Module, overrides);
+        const script = new Function("Module", "require", "__dirname", "__filename", "module", fs.readFileSync(file, "utf8"));
+        script(Module, require, path.dirname(file), file, {});
+    });
+
+}
+
+if (typeof module !== "undefined" && module.exports) {
+    module.exports = {
+        wasmVariants: wasmVariants,
+        simdSupported: simdSupported,
+        threadsSupported: threadsSupported,
+        wasmVariant: wasmVariant,
+        requireWasm: requireWasm
+    };
+}